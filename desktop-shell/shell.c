@@ -779,14 +779,14 @@ animate_focus_change(struct desktop_shell *shell, struct workspace *ws,
 		ws->fsurf_front = create_focus_surface(shell->compositor, output);
 		if (ws->fsurf_front == NULL)
 			return;
-		ws->fsurf_front->view->alpha = 0.0;
+		weston_view_set_alpha(ws->fsurf_front->view, 0.0);
 
 		ws->fsurf_back = create_focus_surface(shell->compositor, output);
 		if (ws->fsurf_back == NULL) {
 			focus_surface_destroy(ws->fsurf_front);
 			return;
 		}
-		ws->fsurf_back->view->alpha = 0.0;
+		weston_view_set_alpha(ws->fsurf_back->view, 0.0);
 
 		focus_surface_created = true;
 	} else {
@@ -4234,9 +4234,9 @@ surface_opacity_binding(struct weston_seat *seat, uint32_t time, uint32_t axis,
 	shsurf->view->alpha -= wl_fixed_to_double(value) * step;
 
 	if (shsurf->view->alpha > 1.0)
-		shsurf->view->alpha = 1.0;
+		weston_view_set_alpha(shsurf->view, 1.0);
 	if (shsurf->view->alpha < step)
-		shsurf->view->alpha = step;
+		weston_view_set_alpha(shsurf->view, step);
 
 	weston_view_geometry_dirty(shsurf->view);
 	weston_surface_damage(surface);
@@ -4755,7 +4755,7 @@ shell_fade(struct desktop_shell *shell, enum fade_type type)
 		if (!shell->fade.view)
 			return;
 
-		shell->fade.view->alpha = 1.0 - tint;
+		weston_view_set_alpha(shell->fade.view, 1.0 - tint);
 		weston_view_update_transform(shell->fade.view);
 	}
 
@@ -5403,13 +5403,13 @@ switcher_next(struct switcher *switcher)
 			if (prev == switcher->current)
 				next = view->surface;
 			prev = view->surface;
-			view->alpha = 0.25;
+			weston_view_set_alpha(view, 0.25);
 			weston_view_geometry_dirty(view);
 			weston_surface_damage(view->surface);
 		}
 
 		if (is_black_surface(view->surface, NULL)) {
-			view->alpha = 0.25;
+			weston_view_set_alpha(view, 0.25);
 			weston_view_geometry_dirty(view);
 			weston_surface_damage(view->surface);
 		}
@@ -5426,11 +5426,11 @@ switcher_next(struct switcher *switcher)
 
 	switcher->current = next;
 	wl_list_for_each(view, &next->views, surface_link)
-		view->alpha = 1.0;
+		weston_view_set_alpha(view, 1.0);
 
 	shsurf = get_shell_surface(switcher->current);
 	if (shsurf && shsurf->state.fullscreen)
-		shsurf->fullscreen.black_view->alpha = 1.0;
+		weston_view_set_alpha(shsurf->fullscreen.black_view, 1.0);
 }
 
 static void
@@ -5453,7 +5453,7 @@ switcher_destroy(struct switcher *switcher)
 		if (is_focus_view(view))
 			continue;
 
-		view->alpha = 1.0;
+		weston_view_set_alpha(view, 1.0);
 		weston_surface_damage(view->surface);
 	}
 
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include "hmi-controller-layout.h"
+
+void
+hmi_layout_geometry_init(struct hmi_layout_geometry *geometry)
+{
+    geometry->x = NULL;
+    geometry->y = NULL;
+    geometry->width = NULL;
+    geometry->height = NULL;
+    geometry->visible = NULL;
+    geometry->count = 0;
+    geometry->capacity = 0;
+}
+
+void
+hmi_layout_geometry_release(struct hmi_layout_geometry *geometry)
+{
+    /* all fields share one allocation */
+    free(geometry->x);
+    hmi_layout_geometry_init(geometry);
+}
+
+int32_t
+hmi_layout_geometry_reserve(struct hmi_layout_geometry *geometry,
+                            int32_t count)
+{
+    int32_t capacity = geometry->capacity;
+    int32_t *data = NULL;
+
+    if (count <= capacity) {
+        geometry->count = count;
+        return 0;
+    }
+
+    if (capacity == 0) {
+        capacity = 16;
+    }
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    data = malloc(5 * capacity * sizeof *data);
+    if (data == NULL) {
+        return -1;
+    }
+
+    free(geometry->x);
+    geometry->x       = data;
+    geometry->y       = data + capacity;
+    geometry->width   = data + capacity * 2;
+    geometry->height  = data + capacity * 3;
+    geometry->visible = data + capacity * 4;
+    geometry->capacity = capacity;
+    geometry->count = count;
+
+    return 0;
+}
+
+void
+hmi_layout_compute_tiling(struct hmi_layout_geometry *geometry,
+                          int32_t width, int32_t height)
+{
+    const float surface_width  = (float)width * 0.25;
+    const float surface_height = (float)height * 0.5;
+    int32_t *restrict x = geometry->x;
+    int32_t *restrict y = geometry->y;
+    int32_t *restrict w = geometry->width;
+    int32_t *restrict h = geometry->height;
+    int32_t *restrict visible = geometry->visible;
+    const int32_t count = geometry->count;
+    int32_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        x[i] = (int32_t)((i & 3) * surface_width);
+        y[i] = (int32_t)(((i >> 2) & 1) * surface_height);
+        w[i] = (int32_t)surface_width;
+        h[i] = (int32_t)surface_height;
+        visible[i] = i < 8;
+    }
+}
+
+void
+hmi_layout_compute_sidebyside(struct hmi_layout_geometry *geometry,
+                              int32_t width, int32_t height)
+{
+    const int32_t surface_width  = width / 2;
+    const int32_t surface_height = height;
+    int32_t *restrict x = geometry->x;
+    int32_t *restrict y = geometry->y;
+    int32_t *restrict w = geometry->width;
+    int32_t *restrict h = geometry->height;
+    int32_t *restrict visible = geometry->visible;
+    const int32_t count = geometry->count;
+    int32_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        x[i] = (i & 1) * surface_width;
+        y[i] = 0;
+        w[i] = surface_width;
+        h[i] = surface_height;
+        visible[i] = i < 2;
+    }
+}
+
+void
+hmi_layout_compute_fullscreen(struct hmi_layout_geometry *geometry,
+                              int32_t width, int32_t height)
+{
+    int32_t *restrict x = geometry->x;
+    int32_t *restrict y = geometry->y;
+    int32_t *restrict w = geometry->width;
+    int32_t *restrict h = geometry->height;
+    int32_t *restrict visible = geometry->visible;
+    const int32_t count = geometry->count;
+    int32_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        x[i] = 0;
+        y[i] = 0;
+        w[i] = width;
+        h[i] = height;
+        visible[i] = 1;
+    }
+}
+
+void
+hmi_layout_compute_random(struct hmi_layout_geometry *geometry,
+                          int32_t width, int32_t height)
+{
+    const int32_t surface_width  = (int32_t)(width * 0.25f);
+    const int32_t surface_height = (int32_t)(height * 0.25f);
+    int32_t i = 0;
+
+    for (i = 0; i < geometry->count; i++) {
+        geometry->x[i] = rand() % (width - surface_width);
+        geometry->y[i] = rand() % (height - surface_height);
+        geometry->width[i] = surface_width;
+        geometry->height[i] = surface_height;
+        geometry->visible[i] = 1;
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _HMI_CONTROLLER_LAYOUT_H_
+#define _HMI_CONTROLLER_LAYOUT_H_
+
+#include <stdint.h>
+
+/**
+ * Geometry of application surfaces for a layout mode of hmi-controller.
+ * Entry i is for the i-th surface passed to ivi-layout. Each field is an
+ * array of its own, so that a mode is computed by a single loop without
+ * branches the compiler can vectorize.
+ */
+struct hmi_layout_geometry {
+    int32_t *x;
+    int32_t *y;
+    int32_t *width;
+    int32_t *height;
+    int32_t *visible;
+    int32_t count;
+    int32_t capacity;
+};
+
+void
+hmi_layout_geometry_init(struct hmi_layout_geometry *geometry);
+
+void
+hmi_layout_geometry_release(struct hmi_layout_geometry *geometry);
+
+/**
+ * \brief Make room for count surfaces. Memory is kept over calls.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+hmi_layout_geometry_reserve(struct hmi_layout_geometry *geometry,
+                            int32_t count);
+
+/**
+ * 4x2 tiles. Surfaces after the eighth are hidden.
+ */
+void
+hmi_layout_compute_tiling(struct hmi_layout_geometry *geometry,
+                          int32_t width, int32_t height);
+
+/**
+ * Two surfaces side by side. The rest is hidden.
+ */
+void
+hmi_layout_compute_sidebyside(struct hmi_layout_geometry *geometry,
+                              int32_t width, int32_t height);
+
+/**
+ * All surfaces cover the whole area.
+ */
+void
+hmi_layout_compute_fullscreen(struct hmi_layout_geometry *geometry,
+                              int32_t width, int32_t height);
+
+/**
+ * Quarter sized surfaces at random positions, by rand().
+ */
+void
+hmi_layout_compute_random(struct hmi_layout_geometry *geometry,
+                          int32_t width, int32_t height);
+
+#endif /* _HMI_CONTROLLER_LAYOUT_H_ */
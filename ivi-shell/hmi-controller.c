@@ -52,10 +52,12 @@
 #include <linux/input.h>
 #include <assert.h>
 #include <time.h>
+#include <math.h>
 
 #include "ivi-layout-export.h"
 #include "ivi-hmi-controller-server-protocol.h"
 #include "ivi-layout-transition.h"
+#include "hmi-controller-layout.h"
 
 /*****************************************************************************
  *  structure, globals
@@ -79,6 +81,22 @@ struct hmi_controller_fade {
     struct wl_list layer_list;
 };
 
+/**
+ * Workspace layer follows pointer/touch motion and flicks by a spring.
+ * Both are applied to ivi-layout once per frame of output.
+ */
+struct hmi_workspace_scroll {
+    struct weston_animation animation;
+    struct weston_output *output;
+    struct wl_listener output_destroy_listener;
+    struct ivi_layout_layer *layer;
+    int32_t width;                  /* width of a workspace page */
+    struct weston_spring spring;    /* scroll position in pages */
+    int32_t is_flicking;
+    int32_t has_motion;             /* pos waits for the next frame */
+    int32_t pos[2];
+};
+
 struct
 hmi_server_setting {
     uint32_t    base_layer_id;
@@ -100,9 +118,15 @@ struct hmi_controller
     enum ivi_hmi_controller_layout_mode layout_mode;
 
     struct hmi_controller_fade              workspace_fade;
+    struct hmi_workspace_scroll             workspace_scroll;
 
     int32_t                                 workspace_count;
     struct wl_array                     ui_widgets;
+    struct wl_array                     surfaces; /* struct hmi_surface */
+    struct wl_array                     app_surfaces; /* order of surfaces */
+    struct wl_array                     app_batch; /* visible, then hidden */
+    struct wl_array                     app_properties; /* of app_batch */
+    struct hmi_layout_geometry          geometry;
     int32_t                             is_initialized;
 
     struct weston_compositor           *compositor;
@@ -110,6 +134,18 @@ struct hmi_controller
     struct wl_listener                  destroy_listener;
 };
 
+/**
+ * Surfaces in order of creation. UI widgets are flagged when they are
+ * created or registered, so that layout modes do not need to look up
+ * ui_widgets for each surface. Layout modes take them newest first, as
+ * ivi_layout_getSurfaces returns them.
+ */
+struct hmi_surface {
+    struct ivi_layout_surface *ivisurf;
+    uint32_t id_surface;
+    int32_t is_ui_widget;
+};
+
 struct launcher_info
 {
     uint32_t surface_id;
@@ -181,209 +217,206 @@ compare_launcher_info(const void *lhs, const void *rhs)
 }
 
 /**
- * Internal methods called by mainly ivi_hmi_controller_switch_mode
- * This reference shows 4 examples how to use ivi_layout APIs.
+ * Register id_surface as UI widget. The surface may be created before or
+ * after its registration.
  */
 static void
-mode_divided_into_tiling(struct hmi_controller *hmi_ctrl,
-                        struct ivi_layout_surface **ppSurface,
-                        int32_t surface_length,
-                        struct hmi_controller_layer *layer)
+add_ui_widget(struct hmi_controller *hmi_ctrl, uint32_t id_surface)
 {
-    const float surface_width  = (float)layer->width * 0.25;
-    const float surface_height = (float)layer->height * 0.5;
-    int32_t surface_x = 0;
-    int32_t surface_y = 0;
-    struct ivi_layout_surface *ivisurf  = NULL;
-
-    struct ivi_layout_surface *surfaces[1024] = {}; //FIXME
-    struct ivi_layout_surface *new_order[1024] = {}; //FIXME
-
-    const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
-
-    int32_t i = 0;
-    int32_t surf_num = 0;
-    for (i = 0; i < surface_length; i++) {
-        ivisurf = ppSurface[i];
+    struct hmi_surface *surface = NULL;
+    uint32_t *add_surface_id = wl_array_add(&hmi_ctrl->ui_widgets,
+                                            sizeof(*add_surface_id));
+    *add_surface_id = id_surface;
 
-        /* skip ui widgets */
-        if (is_surf_in_uiWidget(hmi_ctrl, ivisurf)) {
-            continue;
+    wl_array_for_each(surface, &hmi_ctrl->surfaces) {
+        if (surface->id_surface == id_surface) {
+            surface->is_ui_widget = 1;
         }
-
-        surfaces[surf_num++] = ivisurf;
     }
+}
 
-    static uint32_t si = 0;
-    uint32_t num = 1;
-    for(i=0; i < surf_num; i++){
+/**
+ * Collect application surfaces into hmi_ctrl->app_surfaces, newest first
+ * and rotated so that the first-th one is at the head, and size their
+ * geometry.
+ * The buffers are kept in hmi_controller, so this does not allocate once
+ * they are large enough.
+ */
+static int32_t
+collect_application_surfaces(struct hmi_controller *hmi_ctrl, uint32_t first)
+{
+    struct wl_array *array = &hmi_ctrl->app_surfaces;
+    struct hmi_surface *surface = NULL;
+    struct ivi_layout_surface **order = NULL;
+    struct ivi_layout_surface **collected = NULL;
+    int32_t length = hmi_ctrl->surfaces.size / sizeof(*surface);
+    int32_t count = 0;
+    int32_t i = 0;
+    struct ivi_layout_SurfaceProperties *properties = NULL;
 
-        ivisurf = surfaces[(i + si) % surf_num];
-        new_order[i] = ivisurf;
+    array->size = 0;
+    order = wl_array_add(array, 2 * length * sizeof(*order));
+    if (order == NULL) {
+        return 0;
+    }
+    collected = order + length;
 
-        if (num <= 8) {
-            if (num < 5) {
-                surface_x = (int32_t)((num - 1) * (surface_width));
-                surface_y = 0;
-            }
-            else {
-                surface_x = (int32_t)((num - 5) * (surface_width));
-                surface_y = (int32_t)surface_height;
-            }
+    surface = hmi_ctrl->surfaces.data;
+    for (i = length - 1; i >= 0; i--) {
+        if (!surface[i].is_ui_widget) {
+            collected[count++] = surface[i].ivisurf;
+        }
+    }
 
-            ivi_layout_surfaceSetTransition(ivisurf,IVI_LAYOUT_TRANSITION_VIEW_DEFAULT, duration);
-            ivi_layout_surfaceSetVisibility(ivisurf, 1);
-            ivi_layout_surfaceSetDestinationRectangle(ivisurf, surface_x, surface_y,
-                    (uint32_t)surface_width, (uint32_t)surface_height);
+    array->size = count * sizeof(*order);
+    if (count == 0 ||
+        hmi_layout_geometry_reserve(&hmi_ctrl->geometry, count) != 0) {
+        return 0;
+    }
 
-            num++;
-            continue;
-        }
-        ivi_layout_surfaceSetVisibility(ivisurf, 0);
+    hmi_ctrl->app_batch.size = 0;
+    hmi_ctrl->app_properties.size = 0;
+    if (wl_array_add(&hmi_ctrl->app_batch, count * sizeof(*order)) == NULL) {
+        return 0;
     }
+    properties = wl_array_add(&hmi_ctrl->app_properties,
+                              count * sizeof(*properties));
+    if (properties == NULL) {
+        return 0;
+    }
+    memset(properties, 0, count * sizeof(*properties));
 
-    if(surf_num > 0){
-        ivi_layout_layerSetTransition(layer->ivilayer,IVI_LAYOUT_TRANSITION_LAYER_VIEW_ORDER,duration);
-        //TODO: implement IVI_LAYOUT_TRANSITION_LAYER_VIEW_ORDER later.
-        ivi_layout_transition_layer_render_order(layer->ivilayer,
-                                                    new_order,
-                                                    surf_num,
-                                                    duration);
+    first %= count;
+    for (i = 0; i < count; i++) {
+        order[i] = collected[(i + first) % count];
     }
 
-    si++;
+    return count;
 }
 
+/**
+ * Apply geometry computed by hmi_layout_compute_* to application surfaces.
+ * Visible surfaces get their destination rectangle and hidden ones their
+ * visibility by one batched setter each, so hidden surfaces keep their
+ * destination rectangle. Transitions have no batched setter.
+ */
 static void
-mode_divided_into_sidebyside(struct hmi_controller *hmi_ctrl,
-                      struct ivi_layout_surface **ppSurface,
-                      int32_t surface_length,
-                      struct hmi_controller_layer *layer)
+apply_geometry(struct hmi_controller *hmi_ctrl,
+               enum ivi_layout_transition_type hidden_transition)
 {
-    int32_t surface_width  = layer->width / 2;
-    int32_t surface_height = layer->height;
-    struct ivi_layout_surface *ivisurf  = NULL;
-    int32_t ret = 0;
-
+    struct ivi_layout_surface **order = hmi_ctrl->app_surfaces.data;
+    struct ivi_layout_surface **batch = hmi_ctrl->app_batch.data;
+    struct ivi_layout_SurfaceProperties *prop = hmi_ctrl->app_properties.data;
+    struct hmi_layout_geometry *geometry = &hmi_ctrl->geometry;
     const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
+    int32_t visible = 0;
+    int32_t hidden = 0;
     int32_t i = 0;
-    int32_t num = 1;
-    for (i = 0; i < surface_length; i++) {
-        ivisurf = ppSurface[i];
 
-        /* skip ui widgets */
-        if (is_surf_in_uiWidget(hmi_ctrl, ivisurf)) {
+    for (i = 0; i < geometry->count; i++) {
+        if (!geometry->visible[i]) {
             continue;
         }
 
-        if (num == 1) {
-            ivi_layout_surfaceSetTransition(ivisurf,IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,duration);
-            ivi_layout_surfaceSetVisibility(ivisurf, 1);
-            ivi_layout_surfaceSetDestinationRectangle(ivisurf, 0, 0,
-                    (uint32_t)surface_width, (uint32_t)surface_height);
+        ivi_layout_surfaceSetTransition(order[i],
+                                        IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,
+                                        duration);
+        batch[visible] = order[i];
+        prop[visible].destX = geometry->x[i];
+        prop[visible].destY = geometry->y[i];
+        prop[visible].destWidth = geometry->width[i];
+        prop[visible].destHeight = geometry->height[i];
+        prop[visible].visibility = 1;
+        visible++;
+    }
 
-            num++;
+    for (i = 0; i < geometry->count; i++) {
+        if (geometry->visible[i]) {
             continue;
         }
-        else if (num == 2) {
-            ivi_layout_surfaceSetTransition(ivisurf,IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,duration);
-            ivi_layout_surfaceSetVisibility(ivisurf, 1);
-            ivi_layout_surfaceSetDestinationRectangle(ivisurf, surface_width, 0,
-                    (uint32_t)surface_width, (uint32_t)surface_height);
 
-            num++;
-            continue;
+        if (hidden_transition != IVI_LAYOUT_TRANSITION_NONE) {
+            ivi_layout_surfaceSetTransition(order[i], hidden_transition,
+                                            duration);
         }
-        ivi_layout_surfaceSetTransition(ivisurf,IVI_LAYOUT_TRANSITION_VIEW_FADE_ONLY,duration);
-        ivi_layout_surfaceSetVisibility(ivisurf, 0);
-
-        assert(!ret);
+        batch[visible + hidden] = order[i];
+        prop[visible + hidden].visibility = 0;
+        hidden++;
     }
+
+    ivi_layout_surfaceSetPropertiesArray(batch, prop, visible,
+                                         IVI_NOTIFICATION_DEST_RECT |
+                                         IVI_NOTIFICATION_VISIBILITY);
+    ivi_layout_surfaceSetPropertiesArray(batch + visible, prop + visible,
+                                         hidden,
+                                         IVI_NOTIFICATION_VISIBILITY);
 }
 
+/**
+ * Internal methods called by mainly ivi_hmi_controller_switch_mode
+ * This reference shows 4 examples how to use ivi_layout APIs.
+ */
 static void
-mode_fullscreen_someone(struct hmi_controller *hmi_ctrl,
-                      struct ivi_layout_surface **ppSurface,
-                      int32_t surface_length,
-                      struct hmi_controller_layer *layer)
+mode_divided_into_tiling(struct hmi_controller *hmi_ctrl,
+                         struct hmi_controller_layer *layer)
 {
-    const int32_t  surface_width  = layer->width;
-    const int32_t  surface_height = layer->height;
-    struct ivi_layout_surface *ivisurf  = NULL;
-
-    int32_t i = 0;
     const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
-    for (i = 0; i < surface_length; i++) {
-        ivisurf = ppSurface[i];
+    static uint32_t si = 0;
+    int32_t surf_num = collect_application_surfaces(hmi_ctrl, si);
 
-        /* skip ui widgets */
-        if (is_surf_in_uiWidget(hmi_ctrl, ivisurf)) {
-            continue;
-        }
-        ivi_layout_surfaceSetTransition(ivisurf,IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,duration);
-        ivi_layout_surfaceSetVisibility(ivisurf, 1);
-        ivi_layout_surfaceSetDestinationRectangle(ivisurf, 0, 0,
-                (uint32_t)surface_width, (uint32_t)surface_height);
+    if (surf_num > 0) {
+        hmi_layout_compute_tiling(&hmi_ctrl->geometry,
+                                  layer->width, layer->height);
+        apply_geometry(hmi_ctrl, IVI_LAYOUT_TRANSITION_NONE);
+
+        ivi_layout_layerSetTransition(layer->ivilayer,IVI_LAYOUT_TRANSITION_LAYER_VIEW_ORDER,duration);
+        //TODO: implement IVI_LAYOUT_TRANSITION_LAYER_VIEW_ORDER later.
+        ivi_layout_transition_layer_render_order(layer->ivilayer,
+                                                    hmi_ctrl->app_surfaces.data,
+                                                    surf_num,
+                                                    duration);
     }
 
+    si++;
 }
 
 static void
-mode_random_replace(struct hmi_controller *hmi_ctrl,
-                    struct ivi_layout_surface **ppSurface,
-                    int32_t surface_length,
-                    struct hmi_controller_layer *layer)
+mode_divided_into_sidebyside(struct hmi_controller *hmi_ctrl,
+                             struct hmi_controller_layer *layer)
 {
-    const int32_t surface_width  = (int32_t)(layer->width * 0.25f);
-    const int32_t surface_height = (int32_t)(layer->height * 0.25f);
-    int32_t surface_x = 0;
-    int32_t surface_y = 0;
-
-
-    struct ivi_layout_surface *ivisurf  = NULL;
-
-    const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
-
-    int32_t i = 0;
-    for (i = 0; i < surface_length; i++) {
-        ivisurf = ppSurface[i];
-
-        /* skip ui widgets */
-        if (is_surf_in_uiWidget(hmi_ctrl, ivisurf)) {
-            continue;
-        }
-
-        ivi_layout_surfaceSetTransition(ivisurf,IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,duration);
-        ivi_layout_surfaceSetVisibility(ivisurf, 1);
-        surface_x = rand() % (layer->width - surface_width);
-        surface_y = rand() % (layer->height - surface_height);
-
-        ivi_layout_surfaceSetDestinationRectangle(ivisurf, surface_x, surface_y,
-                surface_width, surface_height);
+    if (collect_application_surfaces(hmi_ctrl, 0) == 0) {
+        return;
     }
 
+    hmi_layout_compute_sidebyside(&hmi_ctrl->geometry,
+                                  layer->width, layer->height);
+    apply_geometry(hmi_ctrl, IVI_LAYOUT_TRANSITION_VIEW_FADE_ONLY);
 }
 
-static int32_t
-has_applicatipn_surface(struct hmi_controller *hmi_ctrl,
-                        struct ivi_layout_surface **ppSurface,
-                        int32_t surface_length)
+static void
+mode_fullscreen_someone(struct hmi_controller *hmi_ctrl,
+                        struct hmi_controller_layer *layer)
 {
-    struct ivi_layout_surface *ivisurf  = NULL;
-    int32_t i = 0;
-
-    for (i = 0; i < surface_length; i++) {
-        ivisurf = ppSurface[i];
+    if (collect_application_surfaces(hmi_ctrl, 0) == 0) {
+        return;
+    }
 
-        /* skip ui widgets */
-        if (is_surf_in_uiWidget(hmi_ctrl, ivisurf)) {
-            continue;
-        }
+    hmi_layout_compute_fullscreen(&hmi_ctrl->geometry,
+                                  layer->width, layer->height);
+    apply_geometry(hmi_ctrl, IVI_LAYOUT_TRANSITION_NONE);
+}
 
-        return 1;
+static void
+mode_random_replace(struct hmi_controller *hmi_ctrl,
+                    struct hmi_controller_layer *layer)
+{
+    if (collect_application_surfaces(hmi_ctrl, 0) == 0) {
+        return;
     }
 
-    return 0;
+    hmi_layout_compute_random(&hmi_ctrl->geometry,
+                              layer->width, layer->height);
+    apply_geometry(hmi_ctrl, IVI_LAYOUT_TRANSITION_NONE);
 }
 
 /**
@@ -399,39 +432,25 @@ switch_mode(struct hmi_controller *hmi_ctrl,
     }
 
     struct hmi_controller_layer *layer = &hmi_ctrl->application_layer;
-    struct ivi_layout_surface **ppSurface = NULL;
-    int32_t surface_length = 0;
-    int32_t ret = 0;
 
     hmi_ctrl->layout_mode = layout_mode;
 
-    ret = ivi_layout_getSurfaces(&surface_length, &ppSurface);
-    assert(!ret);
-
-    if (!has_applicatipn_surface(hmi_ctrl, ppSurface, surface_length)) {
-        free(ppSurface);
-        ppSurface = NULL;
-        return;
-    }
-
     switch (layout_mode) {
     case IVI_HMI_CONTROLLER_LAYOUT_MODE_TILING:
-        mode_divided_into_tiling(hmi_ctrl, ppSurface, surface_length, layer);
+        mode_divided_into_tiling(hmi_ctrl, layer);
         break;
     case IVI_HMI_CONTROLLER_LAYOUT_MODE_SIDE_BY_SIDE:
-        mode_divided_into_sidebyside(hmi_ctrl, ppSurface, surface_length, layer);
+        mode_divided_into_sidebyside(hmi_ctrl, layer);
         break;
     case IVI_HMI_CONTROLLER_LAYOUT_MODE_FULL_SCREEN:
-        mode_fullscreen_someone(hmi_ctrl, ppSurface, surface_length, layer);
+        mode_fullscreen_someone(hmi_ctrl, layer);
         break;
     case IVI_HMI_CONTROLLER_LAYOUT_MODE_RANDOM:
-        mode_random_replace(hmi_ctrl, ppSurface, surface_length, layer);
+        mode_random_replace(hmi_ctrl, layer);
         break;
     }
 
     ivi_layout_commitChanges();
-    free(ppSurface);
-    ppSurface = NULL;
 
     return;
 }
@@ -488,10 +507,20 @@ set_notification_create_surface(struct ivi_layout_surface *ivisurf,
 {
     struct hmi_controller* hmi_ctrl = userdata;
     struct ivi_layout_layer *application_layer = hmi_ctrl->application_layer.ivilayer;
+    struct hmi_surface *surface = NULL;
     int32_t ret = 0;
 
+    surface = wl_array_add(&hmi_ctrl->surfaces, sizeof(*surface));
+    if (surface == NULL) {
+        weston_log("fails to allocate memory\n");
+        return;
+    }
+    surface->ivisurf = ivisurf;
+    surface->id_surface = ivi_layout_getIdOfSurface(ivisurf);
+    surface->is_ui_widget = is_surf_in_uiWidget(hmi_ctrl, ivisurf);
+
     /* skip ui widgets */
-    if (is_surf_in_uiWidget(hmi_ctrl, ivisurf)) {
+    if (surface->is_ui_widget) {
         return;
     }
 
@@ -503,8 +532,19 @@ static void
 set_notification_remove_surface(struct ivi_layout_surface *ivisurf,
                                 void *userdata)
 {
-    (void)ivisurf;
     struct hmi_controller* hmi_ctrl = userdata;
+    struct hmi_surface *surface = NULL;
+    char *end = (char *)hmi_ctrl->surfaces.data + hmi_ctrl->surfaces.size;
+
+    /* order of surfaces is kept */
+    wl_array_for_each(surface, &hmi_ctrl->surfaces) {
+        if (surface->ivisurf == ivisurf) {
+            memmove(surface, surface + 1, end - (char *)(surface + 1));
+            hmi_ctrl->surfaces.size -= sizeof(*surface);
+            break;
+        }
+    }
+
     switch_mode(hmi_ctrl, hmi_ctrl->layout_mode);
 }
 
@@ -559,6 +599,159 @@ hmi_server_setting_create(void)
     return setting;
 }
 
+/**
+ * Spring of workspace scroll. Scroll settles in about 350 msec with
+ * slight overshoot.
+ */
+#define WORKSPACE_SCROLL_SPRING_K        300.0
+#define WORKSPACE_SCROLL_SPRING_FRICTION 900.0
+
+static void
+workspace_scroll_frame(struct weston_animation *animation,
+                       struct weston_output *output, uint32_t msecs)
+{
+    struct hmi_workspace_scroll *scroll =
+        container_of(animation, struct hmi_workspace_scroll, animation);
+
+    if (scroll->is_flicking) {
+        if (animation->frame_counter <= 1) {
+            scroll->spring.timestamp = msecs;
+        }
+
+        weston_spring_update(&scroll->spring, msecs);
+
+        if (weston_spring_done(&scroll->spring)) {
+            scroll->spring.current = scroll->spring.target;
+            scroll->is_flicking = 0;
+        }
+
+        scroll->pos[0] = (int32_t)floor(-scroll->spring.current *
+                                         scroll->width + 0.5);
+        scroll->has_motion = 1;
+    }
+
+    if (scroll->has_motion) {
+        scroll->has_motion = 0;
+        ivi_layout_layerSetPosition(scroll->layer, scroll->pos);
+        ivi_layout_commitChanges();
+    }
+
+    if (!scroll->is_flicking) {
+        wl_list_remove(&animation->link);
+        wl_list_init(&animation->link);
+        return;
+    }
+
+    weston_output_schedule_repaint(output);
+}
+
+static void
+workspace_scroll_schedule(struct hmi_workspace_scroll *scroll)
+{
+    if (scroll->output == NULL) {
+        /* no frame clock, apply at once */
+        if (scroll->is_flicking) {
+            scroll->pos[0] = -scroll->spring.target * scroll->width;
+            scroll->is_flicking = 0;
+        }
+        scroll->has_motion = 0;
+        ivi_layout_layerSetPosition(scroll->layer, scroll->pos);
+        ivi_layout_commitChanges();
+        return;
+    }
+
+    if (wl_list_empty(&scroll->animation.link)) {
+        wl_list_insert(&scroll->output->animation_list,
+                       &scroll->animation.link);
+    }
+
+    weston_output_schedule_repaint(scroll->output);
+}
+
+static void
+workspace_scroll_move(struct hmi_workspace_scroll *scroll, int32_t pos[2])
+{
+    scroll->pos[0] = pos[0];
+    scroll->pos[1] = pos[1];
+    scroll->has_motion = 1;
+    workspace_scroll_schedule(scroll);
+}
+
+/**
+ * Flick from pos with velocity v, pixel per msec, to page_no.
+ */
+static void
+workspace_scroll_flick(struct hmi_workspace_scroll *scroll, int32_t pos[2],
+                       double v, int32_t page_no)
+{
+    double current = -(double)pos[0] / scroll->width;
+
+    weston_spring_init(&scroll->spring, WORKSPACE_SCROLL_SPRING_K,
+                       current, page_no);
+    scroll->spring.friction = WORKSPACE_SCROLL_SPRING_FRICTION;
+
+    /* the spring is stepped every 4 msec */
+    scroll->spring.previous = current + v * 4.0 / scroll->width;
+
+    scroll->pos[0] = pos[0];
+    scroll->pos[1] = pos[1];
+    scroll->is_flicking = 1;
+    scroll->animation.frame_counter = 0;
+    workspace_scroll_schedule(scroll);
+}
+
+static void
+workspace_scroll_stop(struct hmi_workspace_scroll *scroll)
+{
+    if (scroll->has_motion) {
+        scroll->has_motion = 0;
+        ivi_layout_layerSetPosition(scroll->layer, scroll->pos);
+        ivi_layout_commitChanges();
+    }
+
+    scroll->is_flicking = 0;
+    wl_list_remove(&scroll->animation.link);
+    wl_list_init(&scroll->animation.link);
+}
+
+static void
+workspace_scroll_handle_output_destroy(struct wl_listener *listener,
+                                       void *data)
+{
+    struct hmi_workspace_scroll *scroll =
+        container_of(listener, struct hmi_workspace_scroll,
+                     output_destroy_listener);
+
+    wl_list_remove(&scroll->animation.link);
+    wl_list_init(&scroll->animation.link);
+    wl_list_remove(&scroll->output_destroy_listener.link);
+    scroll->output = NULL;
+
+    if (scroll->is_flicking || scroll->has_motion) {
+        workspace_scroll_schedule(scroll);
+    }
+}
+
+static void
+workspace_scroll_init(struct hmi_workspace_scroll *scroll,
+                      struct ivi_layout_screen *iviscrn,
+                      struct hmi_controller_layer *layer)
+{
+    scroll->layer = layer->ivilayer;
+    scroll->width = layer->width;
+    scroll->pos[0] = layer->x;
+    scroll->pos[1] = layer->y;
+
+    scroll->animation.frame = workspace_scroll_frame;
+    wl_list_init(&scroll->animation.link);
+
+    scroll->output = ivi_layout_screenGetOutput(iviscrn);
+    scroll->output_destroy_listener.notify =
+        workspace_scroll_handle_output_destroy;
+    wl_signal_add(&scroll->output->destroy_signal,
+                  &scroll->output_destroy_listener);
+}
+
 /**
  * This is a starting method called from module_init.
  * This sets up scene graph of layers; base, application, workspace background,
@@ -586,6 +779,11 @@ hmi_controller_create(struct weston_compositor *ec)
 
     struct hmi_controller *hmi_ctrl = MEM_ALLOC(sizeof(*hmi_ctrl));
     wl_array_init(&hmi_ctrl->ui_widgets);
+    wl_array_init(&hmi_ctrl->surfaces);
+    wl_array_init(&hmi_ctrl->app_surfaces);
+    wl_array_init(&hmi_ctrl->app_batch);
+    wl_array_init(&hmi_ctrl->app_properties);
+    hmi_layout_geometry_init(&hmi_ctrl->geometry);
     hmi_ctrl->layout_mode = IVI_HMI_CONTROLLER_LAYOUT_MODE_TILING;
     hmi_ctrl->hmi_setting = hmi_server_setting_create();
 
@@ -641,6 +839,9 @@ hmi_controller_create(struct weston_compositor *ec)
     ivi_layout_layerSetOpacity(hmi_ctrl->workspace_layer.ivilayer, 0);
     ivi_layout_layerSetVisibility(hmi_ctrl->workspace_layer.ivilayer, 0);
 
+    workspace_scroll_init(&hmi_ctrl->workspace_scroll, iviscrn,
+                          &hmi_ctrl->workspace_layer);
+
     wl_list_init(&hmi_ctrl->workspace_fade.layer_list);
     tmp_link_layer = MEM_ALLOC(sizeof(*tmp_link_layer));
     tmp_link_layer->layout_layer = hmi_ctrl->workspace_layer.ivilayer;
@@ -684,9 +885,7 @@ ivi_hmi_controller_set_background(struct wl_resource *resource,
     const int32_t height = hmi_ctrl->application_layer.height;
     int32_t ret = 0;
 
-    uint32_t *add_surface_id = wl_array_add(&hmi_ctrl->ui_widgets,
-                                            sizeof(*add_surface_id));
-    *add_surface_id = id_surface;
+    add_ui_widget(hmi_ctrl, id_surface);
 
     ivisurf = ivi_layout_getSurfaceFromId(id_surface);
     assert(ivisurf != NULL);
@@ -721,9 +920,7 @@ ivi_hmi_controller_set_panel(struct wl_resource *resource,
     const int32_t width  = hmi_ctrl->base_layer.width;
     int32_t ret = 0;
 
-    uint32_t *add_surface_id = wl_array_add(&hmi_ctrl->ui_widgets,
-                                            sizeof(*add_surface_id));
-    *add_surface_id = id_surface;
+    add_ui_widget(hmi_ctrl, id_surface);
 
     ivisurf = ivi_layout_getSurfaceFromId(id_surface);
     assert(ivisurf != NULL);
@@ -765,9 +962,7 @@ ivi_hmi_controller_set_button(struct wl_resource *resource,
     const int32_t height = 48;
     int32_t ret = 0;
 
-    uint32_t *add_surface_id = wl_array_add(&hmi_ctrl->ui_widgets,
-                                            sizeof(*add_surface_id));
-    *add_surface_id = id_surface;
+    add_ui_widget(hmi_ctrl, id_surface);
 
     ivisurf = ivi_layout_getSurfaceFromId(id_surface);
     assert(ivisurf != NULL);
@@ -810,9 +1005,7 @@ ivi_hmi_controller_set_home_button(struct wl_resource *resource,
     const int32_t dstx = (hmi_ctrl->base_layer.width - size) / 2;
     const int32_t dsty = (hmi_ctrl->base_layer.height - panel_height) + 5;
 
-    uint32_t *add_surface_id = wl_array_add(&hmi_ctrl->ui_widgets,
-                                            sizeof(*add_surface_id));
-    *add_surface_id = id_surface;
+    add_ui_widget(hmi_ctrl, id_surface);
 
     ivisurf = ivi_layout_getSurfaceFromId(id_surface);
     assert(ivisurf != NULL);
@@ -847,9 +1040,7 @@ ivi_hmi_controller_set_workspacebackground(struct wl_resource *resource,
     struct ivi_layout_layer   *ivilayer = NULL;
     ivilayer = hmi_ctrl->workspace_background_layer.ivilayer;
 
-    uint32_t *add_surface_id = wl_array_add(&hmi_ctrl->ui_widgets,
-                                            sizeof(*add_surface_id));
-    *add_surface_id = id_surface;
+    add_ui_widget(hmi_ctrl, id_surface);
 
     const int32_t width  = hmi_ctrl->workspace_background_layer.width;
     const int32_t height = hmi_ctrl->workspace_background_layer.height;
@@ -955,9 +1146,7 @@ ivi_hmi_controller_add_launchers(struct wl_resource *resource,
     struct launcher_info *data = NULL;
     wl_array_for_each(data, &launchers)
     {
-        uint32_t *add_surface_id = wl_array_add(&hmi_ctrl->ui_widgets,
-                                                sizeof(*add_surface_id));
-        *add_surface_id = data->surface_id;
+        add_ui_widget(hmi_ctrl, data->surface_id);
 
         if (0 > prev || (uint32_t)prev != data->workspace_id) {
             nx = 0;
@@ -1102,6 +1291,14 @@ struct touch_grab {
     struct wl_resource *resource;
 };
 
+#define MOVE_GRAB_SAMPLE_COUNT 16
+#define MOVE_GRAB_SAMPLE_WINDOW 100 /* msec used to estimate velocity */
+
+struct move_grab_sample {
+    double time; /* msec from start_time */
+    wl_fixed_t pos[2];
+};
+
 struct move_grab {
     wl_fixed_t dst[2];
     wl_fixed_t rgn[2][2];
@@ -1111,6 +1308,9 @@ struct move_grab {
     wl_fixed_t start_pos[2];
     wl_fixed_t pos[2];
     int32_t is_moved;
+    struct move_grab_sample samples[MOVE_GRAB_SAMPLE_COUNT];
+    int32_t sample_head;
+    int32_t sample_count;
 };
 
 struct pointer_move_grab {
@@ -1185,8 +1385,9 @@ move_workspace_grab_end(struct move_grab *move, struct wl_resource* resource,
     int32_t is_flick = grab_time < 400 &&
                        0.4 < fabs(pointer_v);
 
-    int32_t pos[2] = {0};
-    ivi_layout_layerGetPosition(layer, pos);
+    /* motion not yet committed is taken into account */
+    int32_t pos[2] = {wl_fixed_to_int(move->pos[0]),
+                      wl_fixed_to_int(move->pos[1])};
 
     int page_no = 0;
 
@@ -1204,34 +1405,9 @@ move_workspace_grab_end(struct move_grab *move, struct wl_resource* resource,
     }
 
     page_no = range_val(page_no, 0, hmi_ctrl->workspace_count - 1);
-    double end_pos = -page_no * width;
 
-/*
-    double dst = fabs(end_pos - pos[0]);
-    double max_time = 0.5 * 1e+3;
-    double v = dst / max_time;
-
-    double vmin = 1000 * 1e-3;
-    if (v < vmin ) {
-        v = vmin;
-    }
-
-    double v0 = 0.0;
-    if (pos[0] < end_pos) {
-        v0 = v;
-    } else {
-        v0 = -v;
-    }
-*/
-
-    const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
     ivi_hmi_controller_send_workspace_end_control(resource, move->is_moved);
-    ivi_layout_layerSetTransition(layer,IVI_LAYOUT_TRANSITION_LAYER_MOVE,duration);
-    ivi_layout_layerSetDestinationRectangle(layer,
-            end_pos, pos[1],
-            hmi_ctrl->workspace_background_layer.width,
-            hmi_ctrl->workspace_background_layer.height);
-    ivi_layout_commitChanges();
+    workspace_scroll_flick(&hmi_ctrl->workspace_scroll, pos, pointer_v, page_no);
 }
 
 static void
@@ -1263,24 +1439,62 @@ pointer_noop_grab_focus(struct weston_pointer_grab *grab)
 {
 }
 
+/**
+ * Velocity is estimated from the oldest motion in the last
+ * MOVE_GRAB_SAMPLE_WINDOW msec instead of the last two motions, because
+ * high rate devices report motions too close in time to be stable.
+ */
 static void
-move_grab_update(struct move_grab *move, wl_fixed_t pointer[2])
+move_grab_track_velocity(struct move_grab *move, double time)
 {
-    struct timespec timestamp = {0};
-    clock_gettime(CLOCK_MONOTONIC, &timestamp);
+    struct move_grab_sample *sample = NULL;
+    struct move_grab_sample *oldest = NULL;
+    int32_t ii = 0;
 
-    double dt = (1e+3 * (timestamp.tv_sec  - move->pre_time.tv_sec) +
-                 1e-6 * (timestamp.tv_nsec - move->pre_time.tv_nsec));
+    move->sample_head = (move->sample_head + 1) % MOVE_GRAB_SAMPLE_COUNT;
+    sample = &move->samples[move->sample_head];
+    sample->time = time;
+    sample->pos[0] = move->pos[0];
+    sample->pos[1] = move->pos[1];
+
+    if (move->sample_count < MOVE_GRAB_SAMPLE_COUNT) {
+        move->sample_count++;
+    }
+
+    for (ii = 1; ii < move->sample_count; ii++) {
+        struct move_grab_sample *older =
+            &move->samples[(move->sample_head - ii + MOVE_GRAB_SAMPLE_COUNT) %
+                           MOVE_GRAB_SAMPLE_COUNT];
+
+        if (MOVE_GRAB_SAMPLE_WINDOW < time - older->time && oldest != NULL) {
+            break;
+        }
+        oldest = older;
+    }
+
+    if (oldest == NULL || time - oldest->time < 1e-6) {
+        return;
+    }
 
-    if (dt < 1e-6) {
-        dt = 1e-6;
+    for (ii = 0; ii < 2; ii++) {
+        move->v[ii] = wl_fixed_to_double(sample->pos[ii] - oldest->pos[ii]) /
+                      (time - oldest->time);
     }
+}
+
+static void
+move_grab_update(struct move_grab *move, wl_fixed_t pointer[2])
+{
+    struct timespec timestamp = {0};
+    clock_gettime(CLOCK_MONOTONIC, &timestamp);
 
     move->pre_time = timestamp;
 
+    double time = 1e+3 * (timestamp.tv_sec  - move->start_time.tv_sec) +
+                  1e-6 * (timestamp.tv_nsec - move->start_time.tv_nsec);
+
     int32_t ii = 0;
     for (ii = 0; ii < 2; ii++) {
-        wl_fixed_t prepos = move->pos[ii];
         move->pos[ii] = pointer[ii] + move->dst[ii];
 
         if (move->pos[ii] < move->rgn[0][ii]) {
@@ -1291,23 +1505,22 @@ move_grab_update(struct move_grab *move, wl_fixed_t pointer[2])
             move->dst[ii] = move->pos[ii] - pointer[ii];
         }
 
-        move->v[ii] = wl_fixed_to_double(move->pos[ii] - prepos) / dt;
-
         if (!move->is_moved &&
             0 < wl_fixed_to_int(move->pos[ii] - move->start_pos[ii])) {
             move->is_moved = 1;
         }
     }
+
+    move_grab_track_velocity(move, time);
 }
 
 static void
-layer_set_pos(struct ivi_layout_layer *layer, wl_fixed_t pos[2])
+layer_set_pos(struct hmi_workspace_scroll *scroll, wl_fixed_t pos[2])
 {
     int32_t layout_pos[2] = {0};
     layout_pos[0] = wl_fixed_to_int(pos[0]);
     layout_pos[1] = wl_fixed_to_int(pos[1]);
-    ivi_layout_layerSetPosition(layer, layout_pos);
-    ivi_layout_commitChanges();
+    workspace_scroll_move(scroll, layout_pos);
 }
 
 static void
@@ -1316,8 +1529,10 @@ pointer_move_grab_motion(struct weston_pointer_grab *grab, uint32_t time,
 {
     struct pointer_move_grab *pnt_move_grab = (struct pointer_move_grab *) grab;
     wl_fixed_t pointer_pos[2] = {x, y};
+    struct hmi_controller *hmi_ctrl =
+        wl_resource_get_user_data(pnt_move_grab->base.resource);
     move_grab_update(&pnt_move_grab->move, pointer_pos);
-    layer_set_pos(pnt_move_grab->base.layer, pnt_move_grab->move.pos);
+    layer_set_pos(&hmi_ctrl->workspace_scroll, pnt_move_grab->move.pos);
     weston_pointer_move(pnt_move_grab->base.grab.pointer, x, y);
 }
 
@@ -1331,9 +1546,11 @@ touch_move_grab_motion(struct weston_touch_grab *grab, uint32_t time,
         return;
     }
 
+    struct hmi_controller *hmi_ctrl =
+        wl_resource_get_user_data(tch_move_grab->base.resource);
     wl_fixed_t pointer_pos[2] = {grab->touch->grab_x, grab->touch->grab_y};
     move_grab_update(&tch_move_grab->move, pointer_pos);
-    layer_set_pos(tch_move_grab->base.layer, tch_move_grab->move.pos);
+    layer_set_pos(&hmi_ctrl->workspace_scroll, tch_move_grab->move.pos);
 }
 
 static void
@@ -1440,6 +1657,11 @@ move_grab_init(struct move_grab* move, wl_fixed_t start_pos[2],
     move->dst[0] = start_pos[0] - grab_pos[0];
     move->dst[1] = start_pos[1] - grab_pos[1];
     memcpy(move->rgn, rgn, sizeof(move->rgn));
+    move->samples[0].time = 0.0;
+    move->samples[0].pos[0] = start_pos[0];
+    move->samples[0].pos[1] = start_pos[1];
+    move->sample_head = 0;
+    move->sample_count = 1;
 }
 
 static void
@@ -1514,6 +1736,7 @@ ivi_hmi_controller_workspace_control(struct wl_client *client,
     struct touch_move_grab *tch_move_grab = NULL;
 
     ivi_layout_transition_move_layer_cancel(layer);
+    workspace_scroll_stop(&hmi_ctrl->workspace_scroll);
 
     switch (device) {
     case HMI_GRAB_DEVICE_POINTER:
@@ -67,9 +67,27 @@ enum ivi_layout_notification_mask {
     IVI_NOTIFICATION_PIXELFORMAT = (1 << 8),
     IVI_NOTIFICATION_ADD         = (1 << 9),
     IVI_NOTIFICATION_REMOVE      = (1 << 10),
+    IVI_NOTIFICATION_CHROMA_KEY  = (1 << 11),
     IVI_NOTIFICATION_ALL         = 0xFFFF
 };
 
+enum ivi_layout_optimization {
+    IVI_LAYOUT_OPTIMIZATION_HARDWARE_PLANE = 0,
+    IVI_LAYOUT_OPTIMIZATION_MAX
+};
+
+/**
+ * IVI_LAYOUT_OPTIMIZATION_HARDWARE_PLANE:
+ *  FORCE_OFF: no view is offered to hardware planes by ivi-layout
+ *  FORCE_ON:  views of pinned layers and of layers covering a whole screen
+ *  HEURISTIC: views of pinned layers only (default)
+ */
+enum ivi_layout_optimization_mode {
+    IVI_LAYOUT_OPTIMIZATION_MODE_FORCE_OFF = 0,
+    IVI_LAYOUT_OPTIMIZATION_MODE_FORCE_ON,
+    IVI_LAYOUT_OPTIMIZATION_MODE_HEURISTIC
+};
+
 enum ivi_layout_transition_type{
     IVI_LAYOUT_TRANSITION_NONE,
     IVI_LAYOUT_TRANSITION_VIEW_DEFAULT,
@@ -114,6 +132,65 @@ typedef void(*ivi_controller_surface_content_callback)(struct ivi_layout_surface
                                             int32_t content,
                                             void *userdata);
 
+/**
+ * A layer or a surface whose properties were changed since the last
+ * delivery, with the masks of all commits in between combined.
+ */
+struct ivi_layout_property_change {
+    struct ivi_layout_layer *ivilayer;  /* NULL if ivisurf was changed */
+    struct ivi_layout_surface *ivisurf; /* NULL if ivilayer was changed */
+    enum ivi_layout_notification_mask mask;
+};
+
+typedef void(*propertyBatchNotificationFunc)(const struct ivi_layout_property_change *changes,
+                                            int32_t count,
+                                            void *userdata);
+
+struct ivi_layout_commit_statistics {
+    uint32_t executed;          /* commits applying pending changes */
+    uint32_t skipped;           /* commits without any pending change */
+    uint32_t view_list_rebuilt; /* executed commits rebuilding view lists */
+    uint32_t view_list_kept;    /* executed commits keeping view lists */
+};
+
+/**
+ * Frame statistics of a surface over its last commits. The window starts
+ * at the oldest commit kept and ends now, so the rates drop once the
+ * client stops committing. Latency is the time from a commit until the
+ * frame of an output showing it was presented. Commits made while the
+ * surface is in no view list are never presented and have no latency.
+ */
+struct ivi_layout_surface_frame_statistics {
+    uint32_t update_count;  /* ivi-layout commits updating the surface */
+    uint32_t commit_count;  /* wl_surface commits, in total */
+    uint32_t window;        /* usec covered by the rates */
+    float    commit_rate;   /* commits per second */
+    float    damage_rate;   /* damaged pixels per second */
+    uint32_t latency_count; /* commits in the window having a latency */
+    uint32_t latency_p50;   /* usec */
+    uint32_t latency_p90;   /* usec */
+    uint32_t latency_p99;   /* usec */
+    uint32_t latency_max;   /* usec */
+};
+
+struct ivi_layout_release_statistics {
+    uint32_t released_surfaces; /* releases of hidden surfaces */
+    uint64_t released_bytes;    /* renderer memory freed by them */
+};
+
+/**
+ * Visitors of ivi_layout_forEach* APIs. Return 0 to continue the walk,
+ * otherwise the walk is stopped.
+ */
+typedef int32_t(*surfaceVisitorFunc)(struct ivi_layout_surface *ivisurf,
+                                     void *userdata);
+
+typedef int32_t(*layerVisitorFunc)(struct ivi_layout_layer *ivilayer,
+                                   void *userdata);
+
+typedef int32_t(*screenVisitorFunc)(struct ivi_layout_screen *iviscrn,
+                                    void *userdata);
+
 int32_t
 ivi_layout_addNotificationShellWarning(shellWarningNotificationFunc callback,
                                        void *userdata);
@@ -194,6 +271,22 @@ void
 ivi_layout_removeNotificationConfigureSurface(surfaceConfigureNotificationFunc callback,
                                               void *userdata);
 
+/**
+ * \brief register for notification of all property changes in a batch
+ *
+ * Changes of layers and surfaces are delivered as an array, instead of a
+ * callback per object, once the compositor returns to its event loop
+ * after the commits. The callback must not remove layers or surfaces in
+ * the array.
+ */
+int32_t
+ivi_layout_addNotificationPropertyBatch(propertyBatchNotificationFunc callback,
+                                        void *userdata);
+
+void
+ivi_layout_removeNotificationPropertyBatch(propertyBatchNotificationFunc callback,
+                                           void *userdata);
+
 /**
  * \brief get id of surface from ivi_layout_surface
  *
@@ -360,7 +453,8 @@ ivi_layout_getPropertiesOfLayer(struct ivi_layout_layer *ivilayer,
                 struct ivi_layout_LayerProperties *pLayerProperties);
 
 /**
- * \brief  Get the number of hardware layers of a screen
+ * \brief  Get the number of hardware layers of a screen, i.e. the planes of
+ * its output including the primary plane
  *
  * \return  0 if the method call was successful
  * \return -1 if the method call was failed
@@ -369,6 +463,61 @@ int32_t
 ivi_layout_getNumberOfHardwareLayers(uint32_t id_screen,
                                         int32_t *pNumberOfHardwareLayers);
 
+/**
+ * \brief  Get the number of views left out of the view lists of all screens
+ * at the last commit, because opaque views above them cover them entirely
+ *
+ * Culled views are not drawn, but their clients still get frame callbacks
+ * each time the output presents a frame.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_getNumberOfCulledViews(int32_t *pNumberOfCulledViews);
+
+/**
+ * \brief  Get the counters of ivi_layout_commitChanges
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_getCommitStatistics(struct ivi_layout_commit_statistics *pStatistics);
+
+/**
+ * \brief  Get the frame statistics of a surface
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_surfaceGetFrameStatistics(struct ivi_layout_surface *ivisurf,
+                struct ivi_layout_surface_frame_statistics *pStatistics);
+
+/**
+ * \brief  Release the renderer state of surfaces which are invisible, on
+ * invisible layers only, or on no screen for delay msec. Surfaces which are
+ * visible but covered by opaque surfaces keep it. Their content is uploaded
+ * again at their next commit.
+ * 0 disables the release. The default is hidden-surface-release-delay of
+ * [ivi-shell] in weston.ini, or 0.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_setHiddenSurfaceReleaseDelay(uint32_t delay);
+
+/**
+ * \brief  Get the counters of releases of hidden surfaces
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_getReleaseStatistics(struct ivi_layout_release_statistics *pStatistics);
+
 /**
  * \brief Get the screens
  *
@@ -440,6 +589,127 @@ ivi_layout_getSurfacesOnLayer(struct ivi_layout_layer *ivilayer,
                                  int32_t *pLength,
                                  struct ivi_layout_surface ***ppArray);
 
+/**
+ * \brief Call visitor for each screen without allocation
+ *
+ * The visitor must not create or remove screens, layers or surfaces.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_forEachScreen(screenVisitorFunc visitor, void *userdata);
+
+/**
+ * \brief Call visitor for each layer without allocation
+ *
+ * The visitor must not create or remove screens, layers or surfaces.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_forEachLayer(layerVisitorFunc visitor, void *userdata);
+
+/**
+ * \brief Call visitor for each layer of the given screen in render order
+ *
+ * The visitor must not create or remove screens, layers or surfaces.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_forEachLayerOnScreen(struct ivi_layout_screen *iviscrn,
+                                layerVisitorFunc visitor, void *userdata);
+
+/**
+ * \brief Call visitor for each surface without allocation
+ *
+ * The visitor must not create or remove screens, layers or surfaces.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_forEachSurface(surfaceVisitorFunc visitor, void *userdata);
+
+/**
+ * \brief Call visitor for each surface of the given layer in render order
+ *
+ * The visitor must not create or remove screens, layers or surfaces.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_forEachSurfaceOnLayer(struct ivi_layout_layer *ivilayer,
+                                 surfaceVisitorFunc visitor, void *userdata);
+
+/**
+ * \brief Copy the screens into a buffer of caller
+ *
+ * At most capacity screens are copied to pArray. pLength is set to the
+ * number of all screens, so capacity < *pLength means the copy was cut.
+ * pArray may be NULL when capacity is 0, to get only the number.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_getScreensSnapshot(struct ivi_layout_screen **pArray,
+                              int32_t capacity, int32_t *pLength);
+
+/**
+ * \brief Copy the layers into a buffer of caller
+ *
+ * See ivi_layout_getScreensSnapshot for pArray, capacity and pLength.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_getLayersSnapshot(struct ivi_layout_layer **pArray,
+                             int32_t capacity, int32_t *pLength);
+
+/**
+ * \brief Copy the layers of the given screen into a buffer of caller
+ *
+ * See ivi_layout_getScreensSnapshot for pArray, capacity and pLength.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_getLayersOnScreenSnapshot(struct ivi_layout_screen *iviscrn,
+                                     struct ivi_layout_layer **pArray,
+                                     int32_t capacity, int32_t *pLength);
+
+/**
+ * \brief Copy the surfaces into a buffer of caller
+ *
+ * See ivi_layout_getScreensSnapshot for pArray, capacity and pLength.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_getSurfacesSnapshot(struct ivi_layout_surface **pArray,
+                               int32_t capacity, int32_t *pLength);
+
+/**
+ * \brief Copy the surfaces of the given layer into a buffer of caller
+ *
+ * See ivi_layout_getScreensSnapshot for pArray, capacity and pLength.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_getSurfacesOnLayerSnapshot(struct ivi_layout_layer *ivilayer,
+                                      struct ivi_layout_surface **pArray,
+                                      int32_t capacity, int32_t *pLength);
+
 /**
  * \brief Create a layer which should be managed by the service
  *
@@ -491,6 +761,28 @@ int32_t
 ivi_layout_layerGetVisibility(struct ivi_layout_layer *ivilayer,
                                  int32_t *pVisibility);
 
+/**
+ * \brief Pin a layer to a hardware plane. Views of surfaces on a pinned
+ * layer are put on an overlay or scanout plane by the backend whenever
+ * buffer format and transform allow it, otherwise they are composited.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_layerSetHardwarePlane(struct ivi_layout_layer *ivilayer,
+                                 int32_t pinned);
+
+/**
+ * \brief Get whether a layer is pinned to a hardware plane
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_layerGetHardwarePlane(struct ivi_layout_layer *ivilayer,
+                                 int32_t *pPinned);
+
 /**
  * \brief Set the opacity of a layer.
  *
@@ -595,6 +887,10 @@ ivi_layout_layerGetOrientation(struct ivi_layout_layer *ivilayer,
 
 /**
  * \brief Sets the color value which defines the transparency value.
+ * pColor is an array of red, green and blue from 0 to 255. Pixels of this
+ * color are not drawn for all surfaces of the layer. NULL disables the
+ * chroma key. A layer with chroma key is put on a hardware plane doing
+ * the keying if there is such one.
  *
  * \return  0 if the method call was successful
  * \return -1 if the method call was failed
@@ -790,6 +1086,8 @@ ivi_layout_surfaceGetPixelformat(struct ivi_layout_layer *ivisurf,
 
 /**
  * \brief Sets the color value which defines the transparency value of a surface.
+ * pColor is an array of red, green and blue from 0 to 255, or NULL to
+ * disable the chroma key. It takes precedence over the one of the layer.
  *
  * \return  0 if the method call was successful
  * \return -1 if the method call was failed
@@ -898,6 +1196,60 @@ ivi_layout_surfaceSetSourceRectangle(struct ivi_layout_surface *ivisurf,
                                         int32_t x, int32_t y,
                                         int32_t width, int32_t height);
 
+/**
+ * \brief Set the properties of a surface selected by mask, a combination of
+ * IVI_NOTIFICATION_OPACITY, SOURCE_RECT, DEST_RECT, DIMENSION, POSITION,
+ * ORIENTATION and VISIBILITY. The other fields of pProperties are ignored.
+ * It is the same as calling the setter of each selected property.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_surfaceSetProperties(struct ivi_layout_surface *ivisurf,
+                        const struct ivi_layout_SurfaceProperties *pProperties,
+                        uint32_t mask);
+
+/**
+ * \brief Set the properties selected by mask of length surfaces,
+ * pProperties[i] to ppSurface[i]. If one of surfaces is NULL, no
+ * property is set.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_surfaceSetPropertiesArray(struct ivi_layout_surface **ppSurface,
+                        const struct ivi_layout_SurfaceProperties *pProperties,
+                        int32_t length,
+                        uint32_t mask);
+
+/**
+ * \brief Set the properties of a layer selected by mask, like
+ * ivi_layout_surfaceSetProperties
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_layerSetProperties(struct ivi_layout_layer *ivilayer,
+                        const struct ivi_layout_LayerProperties *pProperties,
+                        uint32_t mask);
+
+/**
+ * \brief Set the properties selected by mask of length layers,
+ * pProperties[i] to ppLayer[i]. If one of layers is NULL, no property
+ * is set.
+ *
+ * \return  0 if the method call was successful
+ * \return -1 if the method call was failed
+ */
+int32_t
+ivi_layout_layerSetPropertiesArray(struct ivi_layout_layer **ppLayer,
+                        const struct ivi_layout_LayerProperties *pProperties,
+                        int32_t length,
+                        uint32_t mask);
+
 /**
  * \brief get weston_output from ivi_layout_screen.
  *
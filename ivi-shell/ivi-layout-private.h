@@ -24,9 +24,39 @@
 #define _ivi_layout_PRIVATE_H_
 
 #include "compositor.h"
+#include "id-map.h"
 #include "ivi-layout.h"
+#include "ivi-layout-export.h"
 #include "ivi-layout-transition.h"
 
+/**
+ * Derived states of ivi_layout_surface which have to be rebuilt at the next
+ * commit. They are computed from the notification masks of the surface and
+ * of its layer, see get_dirty_flags.
+ */
+enum ivi_layout_dirty_flag {
+    IVI_LAYOUT_DIRTY_OPACITY             = (1 << 0),
+    IVI_LAYOUT_DIRTY_LAYER_ORIENTATION   = (1 << 1), /* layer transform */
+    IVI_LAYOUT_DIRTY_LAYER_POSITION      = (1 << 2), /* layer transform */
+    IVI_LAYOUT_DIRTY_SURFACE_POSITION    = (1 << 3),
+    IVI_LAYOUT_DIRTY_SURFACE_ORIENTATION = (1 << 4),
+    IVI_LAYOUT_DIRTY_SCALE               = (1 << 5),
+    IVI_LAYOUT_DIRTY_VISIBILITY          = (1 << 6),
+    IVI_LAYOUT_DIRTY_CHROMA_KEY          = (1 << 7),
+    IVI_LAYOUT_DIRTY_TRANSFORM           = 0x3e,
+    IVI_LAYOUT_DIRTY_ALL                 = 0xff
+};
+
+/* commits kept per surface for frame statistics, a power of two */
+#define IVI_LAYOUT_FRAME_RECORD_COUNT 64
+
+struct ivi_layout_frame_record {
+    uint64_t commit_time; /* usec of the presentation clock */
+    uint32_t damage;      /* pixels damaged by the commit */
+    uint32_t latency;     /* usec until the frame showing it was presented */
+    uint32_t dropped;     /* committed while not shown, has no latency */
+};
+
 struct ivi_layout_surface {
     struct wl_list link;
     struct wl_signal property_changed;
@@ -38,14 +68,15 @@ struct ivi_layout_surface {
     struct weston_surface *surface;
 
     struct wl_listener surface_destroy_listener;
-    struct weston_transform surface_rotation;
-    struct weston_transform layer_rotation;
-    struct weston_transform surface_pos;
-    struct weston_transform layer_pos;
-    struct weston_transform scaling;
+    struct wl_listener surface_commit_listener;
+    struct weston_matrix surface_rotation;
+    struct weston_matrix surface_pos;
+    struct weston_matrix scaling;
+    struct weston_transform transform; /* surface and layer matrices composed */
     struct ivi_layout_SurfaceProperties prop;
     int32_t pixelformat;
     uint32_t event_mask;
+    uint32_t dirty; /* enum ivi_layout_dirty_flag not tied to event_mask */
 
     struct {
         struct ivi_layout_SurfaceProperties prop;
@@ -57,10 +88,39 @@ struct ivi_layout_surface {
         struct wl_list list_layer;
     } order;
 
+    struct {
+        struct wl_list link; /* ivi_layout notification.list_surface */
+        uint32_t pending;    /* masks of commits not notified yet */
+        uint32_t mask;       /* mask being notified */
+    } notification;
+
+    struct {
+        uint32_t serial;          /* build of view list placing the view */
+        int32_t occluding;        /* opaque area hides views below */
+        int32_t culled;           /* left out of the view list */
+        pixman_region32_t opaque; /* surface opaque when occluding was set */
+    } culling;
+
     struct {
         ivi_controller_surface_content_callback callback;
         void* userdata;
     } content_observer;
+
+    /* ring of the last commits of the weston_surface */
+    struct {
+        struct ivi_layout_frame_record records[IVI_LAYOUT_FRAME_RECORD_COUNT];
+        uint32_t count;     /* commits recorded */
+        uint32_t repainted; /* commits before this one are in a frame */
+        uint32_t presented; /* commits before this one have a latency */
+        uint32_t repaint_mask; /* outputs repainting the pending frame */
+    } frame_stats;
+
+    struct {
+        int32_t hidden;   /* invisible, on an invisible layer or no screen */
+        int32_t released; /* renderer state was released while hidden */
+        uint32_t since;   /* msec when hidden or committed while hidden */
+        uint32_t serial;  /* build of view lists reaching the surface */
+    } hidden;
 };
 
 struct ivi_layout_layer {
@@ -72,11 +132,14 @@ struct ivi_layout_layer {
 
     struct ivi_layout *layout;
 
+    struct weston_matrix transform; /* orientation and position of layer */
     struct ivi_layout_LayerProperties prop;
+    int32_t plane_pinned;
     uint32_t event_mask;
 
     struct {
         struct ivi_layout_LayerProperties prop;
+        int32_t plane_pinned;
         struct wl_list list_surface;
         struct wl_list link;
     } pending;
@@ -84,7 +147,15 @@ struct ivi_layout_layer {
     struct {
         struct wl_list list_surface;
         struct wl_list link;
+        int32_t surface_count;  /* valid while serial is order_serial */
+        uint32_t serial;
     } order;
+
+    struct {
+        struct wl_list link; /* ivi_layout notification.list_layer */
+        uint32_t pending;    /* masks of commits not notified yet */
+        uint32_t mask;       /* mask being notified */
+    } notification;
 };
 
 /*
@@ -159,6 +230,13 @@ struct ivi_layout {
     struct wl_list list_surface;
     struct wl_list list_layer;
     struct wl_list list_screen;
+    int32_t surface_count;
+    int32_t layer_count;
+    int32_t screen_count;
+    uint32_t order_serial; /* bumped when an order list is changed */
+
+    struct id_map surface_map; /* id_surface -> ivi_layout_surface */
+    struct id_map layer_map;   /* id_layer -> ivi_layout_layer */
 
     struct {
         struct wl_signal created;
@@ -171,9 +249,48 @@ struct ivi_layout {
         struct wl_signal configure_changed;
     } surface_notification;
 
-    struct weston_layer layout_layer;
     struct wl_signal warning_signal;
 
+    int32_t optimization_mode[IVI_LAYOUT_OPTIMIZATION_MAX];
+
+    /* occlusion culling of view lists */
+    struct {
+        uint32_t serial;            /* bumped at each build of view lists */
+        int32_t culled_view_count;  /* views culled by the last build */
+        struct wl_event_source *idle; /* checks occluders after commits */
+        int32_t occluder_count;     /* views with opaque area at last build */
+    } culling;
+
+    /* a commit is skipped while no setter is called since the last one */
+    struct {
+        uint32_t generation;           /* bumped by every setter */
+        uint32_t committed_generation; /* generation at the last commit */
+        uint32_t order_serial;         /* order_serial at the last build */
+        int32_t view_list_dirty;       /* view lists need to be rebuilt */
+        struct ivi_layout_commit_statistics stats;
+    } commit;
+
+    /* property changes are notified once the event loop is idle */
+    struct {
+        struct wl_list list_layer;
+        struct wl_list list_surface;
+        struct wl_event_source *idle; /* flush is scheduled */
+        struct wl_signal batch;
+        struct wl_array changes; /* struct ivi_layout_property_change */
+    } notification;
+
+    /* renderer state of surfaces hidden for delay msec is released */
+    struct {
+        uint32_t delay;                /* 0 disables the release */
+        struct wl_event_source *timer;
+        int32_t armed;
+        uint32_t serial;               /* builds of view lists */
+        struct ivi_layout_release_statistics stats;
+    } hidden;
+
+    /* layer transforms follow outputs of screens when they move */
+    struct wl_listener output_moved_listener;
+
     struct ivi_layout_transition_set* transitions;
     struct wl_list pending_transition_list;
 };
@@ -204,4 +321,6 @@ struct ivi_layout {
 */
 struct ivi_layout *get_instance(void);
 
+void ivi_layout_mark_pending(void);
+
 #endif
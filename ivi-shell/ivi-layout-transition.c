@@ -20,7 +20,6 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
-#include <time.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -30,24 +29,76 @@
 #include "ivi-layout-transition.h"
 #include "ivi-layout-private.h"
 
+#define IVI_LAYOUT_TRANSITION_POOL_SIZE 64
+
 struct ivi_layout_transition;
 typedef void (*ivi_layout_transition_frame_func)(struct ivi_layout_transition *transition);
 typedef void (*ivi_layout_transition_destroy_func)(struct ivi_layout_transition* transition);
-typedef int32_t (*ivi_layout_transition_identifire_func)(void* private_data, void* id);
-
-enum ivi_layout_inner_transition_type{
-    IVI_LAYOUT_INNER_TRANSITION_NONE,
-    IVI_LAYOUT_INNER_TRANSITION_VIEW_MOVE_RESIZE,
-    IVI_LAYOUT_INNER_TRANSITION_VIEW_RESIZE,
-    IVI_LAYOUT_INNER_TRANSITION_VIEW_FADE,
-    IVI_LAYOUT_INNER_TRANSITION_LAYER_FADE,
-    IVI_LAYOUT_INNER_TRANSITION_LAYER_MOVE,
-    IVI_LAYOUT_INNER_TRANSITION_LAYER_VIEW_ORDER,
-    IVI_LAYOUT_INNER_TRANSITION_MAX,
+
+struct move_resize_view_data {
+    struct ivi_layout_surface* surface;
+    int32_t start_x;
+    int32_t start_y;
+    int32_t end_x;
+    int32_t end_y;
+    uint32_t start_width;
+    uint32_t start_height;
+    uint32_t end_width;
+    uint32_t end_height;
+};
+
+struct fade_view_data {
+    struct ivi_layout_surface* surface;
+    float start_alpha;
+    float end_alpha;
+};
+
+struct store_alpha{
+    float alpha;
+};
+
+struct move_layer_data {
+    struct ivi_layout_layer* layer;
+    int32_t start_x;
+    int32_t start_y;
+    int32_t end_x;
+    int32_t end_y;
+    ivi_layout_transition_destroy_user_func destroy_func;
+};
+
+struct fade_layer_data {
+    struct ivi_layout_layer* layer;
+    int32_t is_fade_in;
+    double start_alpha;
+    double end_alpha;
+    ivi_layout_transition_destroy_user_func destroy_func;
+};
+
+struct surface_reorder{
+    struct ivi_layout_surface* surface; /* NULL once it is removed */
+    uint32_t new_index;
+};
+
+struct change_order_data{
+    struct ivi_layout_layer* layer;
+    uint32_t surface_num;
+    uint32_t capacity;
+
+    /* buffers below are allocated at the start of transition, so that
+     * frames do not allocate */
+    struct surface_reorder* reorder; /* indexed by old index */
+    struct surface_reorder* pending; /* reorder being set up by retarget */
+    float* position;                 /* position of frame, by old index */
+    uint32_t* order;                 /* old indices sorted by position */
+    struct ivi_layout_surface** surfaces; /* render order of frame */
+
+    struct wl_listener surface_removed;
 };
 
 struct ivi_layout_transition {
     enum ivi_layout_inner_transition_type type;
+    void *target;          /* ivi_layout_surface or ivi_layout_layer */
+    uint32_t target_id;    /* key of transitions->index[type] */
     void *private_data;
     void *user_data;
 
@@ -55,29 +106,54 @@ struct ivi_layout_transition {
     uint32_t time_duration;
     uint32_t time_elapsed;
     uint32_t  is_done;
-    ivi_layout_transition_identifire_func id_func;
+    uint32_t is_pooled;
     ivi_layout_transition_frame_func frame_func;
     ivi_layout_transition_destroy_func destroy_func;
-};
 
-struct transition_node {
-    struct ivi_layout_transition *transition;
+    /* in transition_list, pending_transition_list of ivi_layout or
+     * free_list of transitions */
     struct wl_list link;
+
+    /* private_data points one of them */
+    union {
+        struct move_resize_view_data move_resize_view;
+        struct fade_view_data fade_view;
+        struct move_layer_data move_layer;
+        struct fade_layer_data fade_layer;
+        struct change_order_data change_order;
+    } data;
+    struct store_alpha store_alpha;
 };
 
 static void layout_transition_destroy(struct ivi_layout_transition* transition);
 
 static struct ivi_layout_transition*
-get_transition_from_type_and_id(enum ivi_layout_inner_transition_type type, void* id_data)
+get_transition(enum ivi_layout_inner_transition_type type,
+               void *target, uint32_t target_id)
 {
     struct ivi_layout* layout = get_instance();
-    struct transition_node *node=NULL;
-    wl_list_for_each(node, &layout->transitions->transition_list, link){
-        if(node->transition->type == type)
-            if(node->transition->id_func(node->transition->private_data, id_data))
-                return node->transition;
+    struct ivi_layout_transition *transition = NULL;
+
+    transition = id_map_lookup(&layout->transitions->index[type], target_id);
+    if (transition == NULL || transition->target != target) {
+        return NULL;
     }
-    return NULL;
+
+    return transition;
+}
+
+static struct ivi_layout_transition*
+get_surface_transition(enum ivi_layout_inner_transition_type type,
+                       struct ivi_layout_surface *surface)
+{
+    return get_transition(type, surface, surface->id_surface);
+}
+
+static struct ivi_layout_transition*
+get_layer_transition(enum ivi_layout_inner_transition_type type,
+                     struct ivi_layout_layer *layer)
+{
+    return get_transition(type, layer, layer->id_layer);
 }
 
 static void
@@ -114,45 +190,116 @@ do_transition_frame(
     }
 }
 
-static int32_t
-layout_transition_frame(void* data)
+/**
+ * Transitions are stepped from the animation_list of an output, like
+ * weston_view_animation. So they are stepped once per frame presented on
+ * the output, with its frame time, and nothing runs while no transition is
+ * active.
+ */
+static void
+layout_transition_frame(struct weston_animation *animation,
+                        struct weston_output *output, uint32_t msecs)
 {
-    struct ivi_layout_transition_set *transitions = data;
-    uint32_t fps = 30;
+    struct ivi_layout_transition_set *transitions =
+        container_of(animation, struct ivi_layout_transition_set, animation);
+    struct ivi_layout_transition *transition = NULL;
+    struct ivi_layout_transition *next = NULL;
+
+    wl_list_for_each_safe(transition, next, &transitions->transition_list, link) {
+        do_transition_frame(transition, msecs);
+    }
+
+    ivi_layout_commitChanges();
 
     if (wl_list_empty(&transitions->transition_list)) {
-        wl_event_source_timer_update(transitions->event_source, 0);
-        return 1;
+        wl_list_remove(&animation->link);
+        wl_list_init(&animation->link);
+        return;
     }
 
-    wl_event_source_timer_update(transitions->event_source, 1000 / fps);
+    /* keep frames coming even if nothing was damaged on this output */
+    weston_output_schedule_repaint(output);
+}
 
-    struct timespec timestamp = {0};
-    clock_gettime(CLOCK_MONOTONIC, &timestamp);
-    uint32_t msec = (1e+3 * timestamp.tv_sec + 1e-6 * timestamp.tv_nsec);
+WL_EXPORT void
+ivi_layout_transition_set_schedule(struct ivi_layout_transition_set *transitions)
+{
+    struct weston_compositor *ec = transitions->compositor;
 
-    struct transition_node *node = NULL;
-    struct transition_node *next = NULL;
+    if (wl_list_empty(&transitions->transition_list)) {
+        return;
+    }
 
-    wl_list_for_each_safe(node, next, &transitions->transition_list, link) {
-        do_transition_frame(node->transition, msec);
+    if (!wl_list_empty(&transitions->animation.link)) {
+        return;
     }
 
-    ivi_layout_commitChanges();
-    return 1;
+    if (wl_list_empty(&ec->output_list)) {
+        return;
+    }
+
+    transitions->output = container_of(ec->output_list.next,
+                                       struct weston_output, link);
+    transitions->animation.frame_counter = 0;
+    wl_list_insert(&transitions->output->animation_list,
+                   &transitions->animation.link);
+
+    weston_output_schedule_repaint(transitions->output);
+}
+
+static void
+transition_set_handle_output_destroy(struct wl_listener *listener, void *data)
+{
+    struct ivi_layout_transition_set *transitions =
+        container_of(listener, struct ivi_layout_transition_set,
+                     output_destroy_listener);
+    struct weston_output *output = data;
+
+    if (transitions->output != output) {
+        return;
+    }
+
+    wl_list_remove(&transitions->animation.link);
+    wl_list_init(&transitions->animation.link);
+    transitions->output = NULL;
+
+    ivi_layout_transition_set_schedule(transitions);
 }
 
 WL_EXPORT struct ivi_layout_transition_set *
 ivi_layout_transition_set_create(struct weston_compositor* ec)
 {
     struct ivi_layout_transition_set *transitions = malloc(sizeof(*transitions));
+    uint32_t i;
     assert(transitions);
 
     wl_list_init(&transitions->transition_list);
 
-    struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
-    transitions->event_source = wl_event_loop_add_timer(loop, layout_transition_frame, transitions);
-    wl_event_source_timer_update(transitions->event_source, 0);
+    for (i = 0; i < IVI_LAYOUT_INNER_TRANSITION_MAX; i++) {
+        id_map_init(&transitions->index[i]);
+    }
+
+    /* transitions are taken from the pool instead of being allocated
+     * one by one, a swipe starts dozens of them at once */
+    wl_list_init(&transitions->free_list);
+    transitions->pool = calloc(IVI_LAYOUT_TRANSITION_POOL_SIZE,
+                               sizeof(*transitions->pool));
+    assert(transitions->pool);
+    for (i = 0; i < IVI_LAYOUT_TRANSITION_POOL_SIZE; i++) {
+        transitions->pool[i].is_pooled = 1;
+        wl_list_insert(&transitions->free_list, &transitions->pool[i].link);
+    }
+
+    transitions->compositor = ec;
+    transitions->output = NULL;
+    transitions->animation.frame = layout_transition_frame;
+    transitions->animation.frame_counter = 0;
+    wl_list_init(&transitions->animation.link);
+
+    transitions->output_destroy_listener.notify =
+        transition_set_handle_output_destroy;
+    wl_signal_add(&ec->output_destroyed_signal,
+                  &transitions->output_destroy_listener);
 
     return transitions;
 }
@@ -161,39 +308,35 @@ static void
 layout_transition_register(struct ivi_layout_transition *trans)
 {
     struct ivi_layout* layout = get_instance();
-    struct transition_node *node = NULL;
+    struct id_map *index = &layout->transitions->index[trans->type];
+    struct ivi_layout_transition *stale = NULL;
+
+    /* an entry left for a removed object whose id was reused */
+    stale = id_map_lookup(index, trans->target_id);
+    if (stale != NULL) {
+        id_map_remove(index, trans->target_id);
+    }
 
-    node = malloc(sizeof(*node));
-    assert(node);
+    if (id_map_insert(index, trans->target_id, trans) != 0) {
+        weston_log("layout_transition_register: failed to index transition\n");
+    }
 
-    node->transition = trans;
-    wl_list_insert(&layout->pending_transition_list, &node->link);
+    wl_list_insert(&layout->pending_transition_list, &trans->link);
 }
 
 static void
 remove_transition(struct ivi_layout* layout,
                  struct ivi_layout_transition *trans)
 {
-    struct transition_node *node = NULL;
-    struct transition_node *next = NULL;
+    struct id_map *index = &layout->transitions->index[trans->type];
 
-    wl_list_for_each_safe(node, next, &layout->transitions->transition_list, link) {
-        if (node->transition == trans) {
-            wl_list_remove(&node->link);
-            free(node);
-            return;
-        }
+    if (id_map_lookup(index, trans->target_id) == trans) {
+        id_map_remove(index, trans->target_id);
     }
 
-    wl_list_for_each_safe(node, next, &layout->pending_transition_list, link) {
-        if (node->transition == trans) {
-            wl_list_remove(&node->link);
-            free(node);
-            return;
-        }
-    }
-
-    return;
+    /* it is in either transition_list or pending_transition_list */
+    wl_list_remove(&trans->link);
+    wl_list_init(&trans->link);
 }
 
 static void
@@ -204,16 +347,37 @@ layout_transition_destroy(struct ivi_layout_transition *transition)
     remove_transition(layout, transition);
     if(transition->destroy_func)
         transition->destroy_func(transition);
-    free(transition);
+
+    if (transition->is_pooled) {
+        wl_list_insert(&layout->transitions->free_list, &transition->link);
+    } else {
+        free(transition);
+    }
 }
 
 static struct ivi_layout_transition*
-create_layout_transition(void)
+create_layout_transition(enum ivi_layout_inner_transition_type type,
+                         void *target, uint32_t target_id)
 {
-    struct ivi_layout_transition* transition = malloc(sizeof(*transition));
-    assert(transition);
+    struct ivi_layout* layout = get_instance();
+    struct wl_list *free_list = &layout->transitions->free_list;
+    struct ivi_layout_transition* transition = NULL;
 
-    transition->type = IVI_LAYOUT_INNER_TRANSITION_MAX;
+    if (!wl_list_empty(free_list)) {
+        transition = container_of(free_list->next,
+                                  struct ivi_layout_transition, link);
+        wl_list_remove(&transition->link);
+    } else {
+        /* pool is exhausted */
+        transition = malloc(sizeof(*transition));
+        assert(transition);
+        transition->is_pooled = 0;
+    }
+    wl_list_init(&transition->link);
+
+    transition->type = type;
+    transition->target = target;
+    transition->target_id = target_id;
     transition->time_start   = 0;
     transition->time_duration     = 300; // 300ms
     transition->time_elapsed = 0;
@@ -231,25 +395,10 @@ create_layout_transition(void)
 
 /* move and resize view transition */
 
-struct move_resize_view_data {
-    struct ivi_layout_surface* surface;
-    int32_t start_x;
-    int32_t start_y;
-    int32_t end_x;
-    int32_t end_y;
-    uint32_t start_width;
-    uint32_t start_height;
-    uint32_t end_width;
-    uint32_t end_height;
-};
-
 static void
 transition_move_resize_view_destroy(struct ivi_layout_transition* transition)
 {
-    if(transition->private_data){
-        free(transition->private_data);
-        transition->private_data = NULL;
-    }
+    transition->private_data = NULL;
 }
 
 static void
@@ -272,13 +421,6 @@ transition_move_resize_view_user_frame(struct ivi_layout_transition *transition)
                                                  destx, desty, dest_width, dest_height);
 }
 
-static int32_t
-transition_move_resize_view_identifire(struct move_resize_view_data* data,
-                                      struct ivi_layout_surface* view)
-{
-    return data->surface == view;
-}
-
 static struct ivi_layout_transition *
 create_move_resize_view_transition(
     struct ivi_layout_surface* surface,
@@ -290,11 +432,11 @@ create_move_resize_view_transition(
     ivi_layout_transition_destroy_func destroy_func,
     uint32_t duration)
 {
-    struct ivi_layout_transition* transition = create_layout_transition();
-    struct move_resize_view_data* data = malloc(sizeof(*data));
+    struct ivi_layout_transition* transition =
+        create_layout_transition(IVI_LAYOUT_INNER_TRANSITION_VIEW_MOVE_RESIZE,
+                                 surface, surface->id_surface);
+    struct move_resize_view_data* data = &transition->data.move_resize_view;
 
-    transition->type = IVI_LAYOUT_INNER_TRANSITION_VIEW_MOVE_RESIZE;
-    transition->id_func = (ivi_layout_transition_identifire_func)transition_move_resize_view_identifire;
 
     transition->frame_func = frame_func;
     transition->destroy_func = destroy_func;
@@ -330,8 +472,8 @@ ivi_layout_transition_move_resize_view(struct ivi_layout_surface* surface,
 
     struct ivi_layout_transition* transition = NULL;
 
-    transition = get_transition_from_type_and_id(IVI_LAYOUT_INNER_TRANSITION_VIEW_MOVE_RESIZE,
-                                                 surface);
+    transition = get_surface_transition(IVI_LAYOUT_INNER_TRANSITION_VIEW_MOVE_RESIZE,
+                                        surface);
     if(transition){
 
         transition->time_start = 0;
@@ -365,16 +507,6 @@ ivi_layout_transition_move_resize_view(struct ivi_layout_surface* surface,
 }
 
 /* fade transition */
-struct fade_view_data {
-    struct ivi_layout_surface* surface;
-    float start_alpha;
-    float end_alpha;
-};
-
-struct store_alpha{
-    float alpha;
-};
-
 static void
 fade_view_user_frame(struct ivi_layout_transition *transition)
 {
@@ -388,30 +520,22 @@ fade_view_user_frame(struct ivi_layout_transition *transition)
     ivi_layout_surfaceSetVisibility(surface, 1);
 }
 
-static int32_t
-transition_fade_view_identifire(struct fade_view_data* data,
-                               struct ivi_layout_surface* view)
-{
-    return data->surface == view;
-}
-
 static struct ivi_layout_transition*
 create_fade_view_transition(
     struct ivi_layout_surface* surface,
     float start_alpha, float end_alpha,
     ivi_layout_transition_frame_func frame_func,
-    void* user_data,
+    float user_alpha,
     ivi_layout_transition_destroy_func destroy_func,
     uint32_t duration)
 {
-    struct ivi_layout_transition* transition = create_layout_transition();
-    struct fade_view_data* data = malloc(sizeof(*data));
-    assert(data);
-
-    transition->type = IVI_LAYOUT_INNER_TRANSITION_VIEW_FADE;
-    transition->id_func = (ivi_layout_transition_identifire_func)transition_fade_view_identifire;
+    struct ivi_layout_transition* transition =
+        create_layout_transition(IVI_LAYOUT_INNER_TRANSITION_VIEW_FADE,
+                                 surface, surface->id_surface);
+    struct fade_view_data* data = &transition->data.fade_view;
 
-    transition->user_data = user_data;
+    transition->user_data = &transition->store_alpha;
+    transition->store_alpha.alpha = user_alpha;
     transition->private_data = data;
     transition->frame_func = frame_func;
     transition->destroy_func = destroy_func;
@@ -431,7 +555,7 @@ static void
 create_visibility_transition(struct ivi_layout_surface* surface,
                             float start_alpha,
                             float dest_alpha,
-                            void* user_data,
+                            float user_alpha,
                              ivi_layout_transition_destroy_func destroy_func,
                              uint32_t duration)
 {
@@ -441,7 +565,7 @@ create_visibility_transition(struct ivi_layout_surface* surface,
         surface,
         start_alpha, dest_alpha,
         fade_view_user_frame,
-        user_data,
+        user_alpha,
         destroy_func,
         duration);
 
@@ -455,12 +579,7 @@ visibility_on_transition_destroy(struct ivi_layout_transition* transition)
     struct fade_view_data *data = transition->private_data;
     ivi_layout_surfaceSetVisibility(data->surface, 1);
 
-    free(data);
     transition->private_data = NULL;
-
-    struct store_alpha *user_data = transition->user_data;
-
-    free(user_data);
     transition->user_data = NULL;
 
 }
@@ -472,8 +591,8 @@ ivi_layout_transition_visibility_on(struct ivi_layout_surface* surface,
 
     struct ivi_layout_transition* transition = NULL;
 
-    transition = get_transition_from_type_and_id(IVI_LAYOUT_INNER_TRANSITION_VIEW_FADE,
-                                                 surface);
+    transition = get_surface_transition(IVI_LAYOUT_INNER_TRANSITION_VIEW_FADE,
+                                        surface);
     if(transition){
         transition->time_start = 0;
         transition->time_duration = duration;
@@ -498,13 +617,10 @@ ivi_layout_transition_visibility_on(struct ivi_layout_surface* surface,
     float dest_alpha = 0;
     ivi_layout_surfaceGetOpacity(surface, &dest_alpha);
 
-    struct store_alpha* user_data = malloc(sizeof(*user_data));
-    user_data->alpha = wl_fixed_to_double(dest_alpha);
-
     create_visibility_transition(surface,
                                  0.0, // start_alpha
                                  wl_fixed_to_double(dest_alpha),
-                                 user_data,
+                                 wl_fixed_to_double(dest_alpha),
                                  visibility_on_transition_destroy,
                                  duration);
 }
@@ -519,10 +635,7 @@ visibility_off_transition_destroy(struct ivi_layout_transition* transition)
     struct store_alpha* user_data = transition->user_data;
     ivi_layout_surfaceSetOpacity(data->surface, wl_fixed_from_double(user_data->alpha));
 
-    free(data);
     transition->private_data = NULL;
-
-    free(user_data);
     transition->user_data= NULL;
 
 }
@@ -534,8 +647,8 @@ ivi_layout_transition_visibility_off(struct ivi_layout_surface* surface,
 
     struct ivi_layout_transition* transition = NULL;
 
-    transition = get_transition_from_type_and_id(IVI_LAYOUT_INNER_TRANSITION_VIEW_FADE,
-                                                 surface);
+    transition = get_surface_transition(IVI_LAYOUT_INNER_TRANSITION_VIEW_FADE,
+                                        surface);
     if(transition){
         transition->time_start = 0;
         transition->time_duration = duration;
@@ -553,28 +666,16 @@ ivi_layout_transition_visibility_off(struct ivi_layout_surface* surface,
     float start_alpha=0;
     ivi_layout_surfaceGetOpacity(surface, &start_alpha);
 
-    struct store_alpha* user_data = malloc(sizeof(*user_data));
-    user_data->alpha = wl_fixed_to_double(start_alpha);
-
     create_visibility_transition(surface,
                                  wl_fixed_to_double(start_alpha),
                                  0.0f, // dest_alpha
-                                 user_data,
+                                 wl_fixed_to_double(start_alpha),
                                  visibility_off_transition_destroy,
                                  duration);
 }
 
 /* move layer transition */
 
-struct move_layer_data {
-    struct ivi_layout_layer* layer;
-    int32_t start_x;
-    int32_t start_y;
-    int32_t end_x;
-    int32_t end_y;
-    ivi_layout_transition_destroy_user_func destroy_func;
-};
-
 static void
 transition_move_layer_user_frame(struct ivi_layout_transition* transition)
 {
@@ -601,18 +702,10 @@ transition_move_layer_destroy(struct ivi_layout_transition* transition)
     if(data->destroy_func)
         data->destroy_func(transition->user_data);
 
-    free(data);
     transition->private_data = NULL;
 
 }
 
-static int32_t
-transition_move_layer_identifire(struct move_layer_data* data, struct ivi_layout_layer* layer)
-{
-    return data->layer == layer;
-}
-
-
 static struct ivi_layout_transition*
 create_move_layer_transition(
     struct ivi_layout_layer* layer,
@@ -622,11 +715,11 @@ create_move_layer_transition(
     ivi_layout_transition_destroy_user_func destroy_user_func,
     uint32_t duration)
 {
-    struct ivi_layout_transition* transition = create_layout_transition();
-    struct move_layer_data* data = malloc(sizeof(*data));
+    struct ivi_layout_transition* transition =
+        create_layout_transition(IVI_LAYOUT_INNER_TRANSITION_LAYER_MOVE,
+                                 layer, layer->id_layer);
+    struct move_layer_data* data = &transition->data.move_layer;
 
-    transition->type = IVI_LAYOUT_INNER_TRANSITION_LAYER_MOVE;
-    transition->id_func = (ivi_layout_transition_identifire_func)transition_move_layer_identifire;
 
     transition->frame_func = transition_move_layer_user_frame;
     transition->destroy_func = transition_move_layer_destroy;
@@ -655,6 +748,25 @@ ivi_layout_transition_move_layer(struct ivi_layout_layer* layer,
     ivi_layout_layerGetPosition(layer, start_pos);
 
     struct ivi_layout_transition* transition = NULL;
+
+    transition = get_layer_transition(IVI_LAYOUT_INNER_TRANSITION_LAYER_MOVE,
+                                      layer);
+    if(transition){
+        /* retarget from the current position */
+        struct move_layer_data* data = transition->private_data;
+
+        transition->time_start = 0;
+        transition->time_elapsed = 0;
+        if(duration != 0)
+            transition->time_duration = duration;
+
+        data->start_x = start_pos[0];
+        data->start_y = start_pos[1];
+        data->end_x   = dest_x;
+        data->end_y   = dest_y;
+        return;
+    }
+
     transition = create_move_layer_transition(
         layer,
         start_pos[0], start_pos[1],
@@ -671,28 +783,17 @@ WL_EXPORT void
 ivi_layout_transition_move_layer_cancel(struct ivi_layout_layer* layer)
 {
     struct ivi_layout_transition* transition =
-        get_transition_from_type_and_id(IVI_LAYOUT_INNER_TRANSITION_LAYER_MOVE, layer);
+        get_layer_transition(IVI_LAYOUT_INNER_TRANSITION_LAYER_MOVE, layer);
     if(transition){
         layout_transition_destroy(transition);
     }
 }
 
 /* fade layer transition */
-struct fade_layer_data {
-    struct ivi_layout_layer* layer;
-    int32_t is_fade_in;
-    double start_alpha;
-    double end_alpha;
-    ivi_layout_transition_destroy_user_func destroy_func;
-};
-
 static void
 transition_fade_layer_destroy(struct ivi_layout_transition* transition)
 {
-    struct fade_layer_data* data = transition->private_data;
     transition->private_data = NULL;
-
-    free(data);
 }
 
 static void
@@ -710,12 +811,6 @@ transition_fade_layer_user_frame(struct ivi_layout_transition *transition)
     ivi_layout_layerSetVisibility(data->layer, is_visible);
 }
 
-static int32_t
-transition_fade_layer_identifire(struct fade_layer_data* data, struct ivi_layout_layer* layer)
-{
-    return data->layer == layer;
-}
-
 WL_EXPORT void
 ivi_layout_transition_fade_layer(struct ivi_layout_layer* layer,
                                     int32_t is_fade_in,
@@ -726,7 +821,7 @@ ivi_layout_transition_fade_layer(struct ivi_layout_layer* layer,
 {
     struct ivi_layout_transition* transition = NULL;
 
-    transition = get_transition_from_type_and_id(IVI_LAYOUT_INNER_TRANSITION_LAYER_FADE, layer);
+    transition = get_layer_transition(IVI_LAYOUT_INNER_TRANSITION_LAYER_FADE, layer);
     if(transition){
         /* transition update */
         struct fade_layer_data* data = transition->private_data;
@@ -747,12 +842,9 @@ ivi_layout_transition_fade_layer(struct ivi_layout_layer* layer,
         return;
     }
 
-    transition = create_layout_transition();
-    struct fade_layer_data* data = malloc(sizeof(*data));
-    assert(data);
-
-    transition->type = IVI_LAYOUT_INNER_TRANSITION_LAYER_FADE;
-    transition->id_func = (ivi_layout_transition_identifire_func)transition_fade_layer_identifire;
+    transition = create_layout_transition(IVI_LAYOUT_INNER_TRANSITION_LAYER_FADE,
+                                          layer, layer->id_layer);
+    struct fade_layer_data* data = &transition->data.fade_layer;
 
     transition->private_data = data;
     transition->user_data = user_data;
@@ -776,26 +868,6 @@ ivi_layout_transition_fade_layer(struct ivi_layout_layer* layer,
 }
 
 /* render order transition */
-struct surface_reorder{
-    uint32_t id_surface;
-    uint32_t new_index;
-};
-
-struct change_order_data{
-    struct ivi_layout_layer* layer;
-    uint32_t surface_num;
-    struct surface_reorder* reorder;
-};
-
-struct surf_with_index{
-    uint32_t id_surface;
-    float surface_index;
-};
-
-static int cmp_order_asc(const void* lhs, const void* rhs)
-{
-    return ((struct surf_with_index*)lhs)->surface_index > ((struct surf_with_index*)rhs)->surface_index;
-}
 
 /*
 render oerder transition
@@ -814,44 +886,98 @@ after 50% of time elapsed
       surfB, surfA, surfC
 */
 
+static int32_t
+is_before(const struct change_order_data* data, uint32_t lhs, uint32_t rhs)
+{
+    if (data->position[lhs] != data->position[rhs])
+        return data->position[lhs] < data->position[rhs];
+
+    return data->reorder[lhs].new_index < data->reorder[rhs].new_index;
+}
+
 static void
 transition_change_order_user_frame(struct ivi_layout_transition *transition)
 {
-    uint32_t i, old_index;
+    uint32_t i, j, old_index;
     double current = time_to_nowpos(transition);
     struct change_order_data* data = transition->private_data;
-
-    struct surf_with_index* swi = malloc(sizeof(*swi)*data->surface_num);
+    uint32_t surface_num = 0;
 
     for(old_index=0; old_index<data->surface_num; old_index++){
-        swi[old_index].id_surface = data->reorder[old_index].id_surface;
-        swi[old_index].surface_index = (float)old_index +
+        data->position[old_index] = (float)old_index +
             ((float)data->reorder[old_index].new_index - (float)old_index) * current;
     }
 
-    qsort(swi, data->surface_num, sizeof(*swi), cmp_order_asc);
+    /*
+     * Positions move monotonically from the old index to the new one, so
+     * order of previous frame is almost sorted. Insertion sort fixes it
+     * with a few swaps.
+     */
+    for(i=1; i<data->surface_num; i++){
+        const uint32_t idx = data->order[i];
 
-/*
-    fprintf(stderr, "=========\n");
-    for(i=0; i<data->surface_num;i++){
-        fprintf(stderr, "surface %d: %f\n", swi[i].id_surface, swi[i].surface_index);
+        for(j=i; j>0 && is_before(data, idx, data->order[j-1]); j--){
+            data->order[j] = data->order[j-1];
+        }
+        data->order[j] = idx;
     }
-*/
 
-    struct ivi_layout_surface** new_surface_order =
-        malloc(sizeof(*new_surface_order) * data->surface_num);
-
-    uint32_t surface_num = 0;
     for(i=0; i<data->surface_num; i++){
-        struct ivi_layout_surface* surf = ivi_layout_getSurfaceFromId(swi[i].id_surface);
+        struct ivi_layout_surface* surf = data->reorder[data->order[i]].surface;
         if(surf)
-            new_surface_order[surface_num++] = surf;
+            data->surfaces[surface_num++] = surf;
+    }
+
+    ivi_layout_layerSetRenderOrder(data->layer, data->surfaces, surface_num);
+}
+
+static void
+change_order_handle_surface_removed(struct wl_listener *listener, void *data)
+{
+    struct change_order_data* order_data =
+        container_of(listener, struct change_order_data, surface_removed);
+    struct ivi_layout_surface* surface = data;
+    uint32_t i;
+
+    for(i=0; i<order_data->surface_num; i++){
+        if(order_data->reorder[i].surface == surface)
+            order_data->reorder[i].surface = NULL;
     }
+}
 
-    ivi_layout_layerSetRenderOrder(data->layer, new_surface_order, surface_num);
+static int32_t
+change_order_reserve(struct change_order_data* data, uint32_t surface_num)
+{
+    struct surface_reorder* reorder = NULL;
+    struct surface_reorder* pending = NULL;
+    float* position = NULL;
+    uint32_t* order = NULL;
+    struct ivi_layout_surface** surfaces = NULL;
+
+    if(surface_num <= data->capacity)
+        return 0;
+
+    reorder  = realloc(data->reorder, sizeof(*reorder) * surface_num);
+    if(reorder)
+        data->reorder = reorder;
+    pending  = realloc(data->pending, sizeof(*pending) * surface_num);
+    if(pending)
+        data->pending = pending;
+    position = realloc(data->position, sizeof(*position) * surface_num);
+    if(position)
+        data->position = position;
+    order    = realloc(data->order, sizeof(*order) * surface_num);
+    if(order)
+        data->order = order;
+    surfaces = realloc(data->surfaces, sizeof(*surfaces) * surface_num);
+    if(surfaces)
+        data->surfaces = surfaces;
+
+    if(!reorder || !pending || !position || !order || !surfaces)
+        return -1;
 
-    free(new_surface_order);
-    free(swi);
+    data->capacity = surface_num;
+    return 0;
 }
 
 static void
@@ -859,8 +985,16 @@ transition_change_order_destroy(struct ivi_layout_transition* transition)
 {
     struct change_order_data* data = transition->private_data;
 
+    wl_list_remove(&data->surface_removed.link);
+
     free(data->reorder);
-    free(data);
+    free(data->pending);
+    free(data->position);
+    free(data->order);
+    free(data->surfaces);
+    data->reorder = NULL;
+    data->pending = NULL;
+    transition->private_data = NULL;
 }
 
 static int32_t find_surface(struct ivi_layout_surface** surfaces,
@@ -876,72 +1010,110 @@ static int32_t find_surface(struct ivi_layout_surface** surfaces,
     return -1;
 }
 
+/**
+ * Precompute the permutation from current render order of layer to
+ * new_order. Returns the number of surfaces, or -1 on error. The
+ * permutation is built aside and only replaces the one of a running
+ * transition on success.
+ */
 static int32_t
-transition_change_order_identifire(struct change_order_data* data, struct ivi_layout_layer* layer)
+change_order_setup(struct change_order_data* data,
+                   struct ivi_layout_layer* layer,
+                   struct ivi_layout_surface** new_order,
+                   uint32_t surface_num)
 {
-    return data->layer == layer;
-}
-
-WL_EXPORT void
-ivi_layout_transition_layer_render_order(struct ivi_layout_layer* layer,
-                                            struct ivi_layout_surface** new_order,
-                                            uint32_t surface_num,
-                                            uint32_t duration)
-{
-    struct surface_reorder* reorder = malloc(sizeof(*reorder)*surface_num);
     struct ivi_layout_surface* surf=NULL;
+    struct surface_reorder* reorder = NULL;
     uint32_t old_index = 0;
+    uint32_t i = 0;
+
+    if(change_order_reserve(data, surface_num) != 0){
+        weston_log("fails to allocate memory\n");
+        return -1;
+    }
 
     wl_list_for_each(surf, &layer->order.list_surface, order.link){
         int32_t new_index = find_surface(new_order, surface_num, surf);
-        if(new_index < 0){
+        if(new_index < 0 || old_index >= surface_num){
             fprintf(stderr, "invalid render order!!!\n");
-            return;
+            return -1;
         }
 
-        const uint32_t id = ivi_layout_getIdOfSurface(surf);
-
-        reorder[old_index].id_surface = id;
-        reorder[old_index].new_index = new_index;
+        data->pending[old_index].surface = surf;
+        data->pending[old_index].new_index = new_index;
         old_index++;
     }
 
+    reorder = data->reorder;
+    data->reorder = data->pending;
+    data->pending = reorder;
+
+    for(i=0; i<old_index; i++){
+        data->order[i] = i;
+    }
+
+    return old_index;
+}
+
+WL_EXPORT void
+ivi_layout_transition_layer_render_order(struct ivi_layout_layer* layer,
+                                            struct ivi_layout_surface** new_order,
+                                            uint32_t surface_num,
+                                            uint32_t duration)
+{
+    struct ivi_layout* layout = get_instance();
     struct ivi_layout_transition* transition = NULL;
+    int32_t num = 0;
 
-    transition = get_transition_from_type_and_id(IVI_LAYOUT_INNER_TRANSITION_LAYER_VIEW_ORDER, layer);
+    transition = get_layer_transition(IVI_LAYOUT_INNER_TRANSITION_LAYER_VIEW_ORDER, layer);
     if(transition){
         /* update transition */
+        struct change_order_data* data = transition->private_data;
+
+        num = change_order_setup(data, layer, new_order, surface_num);
+        if(num < 0)
+            return;
+
         transition->time_start = 0; /* timer reset */
 
         if(duration != 0){
             transition->time_duration = duration;
         }
 
-        struct change_order_data* data = transition->private_data;
-        free(data->reorder);
-        data->reorder = reorder;
+        data->surface_num = num;
         return;
     }
 
-    transition = create_layout_transition();
-    struct change_order_data* data = malloc(sizeof(*data));
-    assert(data);
+    transition = create_layout_transition(IVI_LAYOUT_INNER_TRANSITION_LAYER_VIEW_ORDER,
+                                          layer, layer->id_layer);
+    struct change_order_data* data = &transition->data.change_order;
 
-    transition->type = IVI_LAYOUT_INNER_TRANSITION_LAYER_VIEW_ORDER;
-    transition->id_func = (ivi_layout_transition_identifire_func)transition_change_order_identifire;
+    data->layer = layer;
+    data->capacity = 0;
+    data->reorder = NULL;
+    data->pending = NULL;
+    data->position = NULL;
+    data->order = NULL;
+    data->surfaces = NULL;
+    data->surface_removed.notify = change_order_handle_surface_removed;
+    wl_signal_add(&layout->surface_notification.removed,
+                  &data->surface_removed);
 
     transition->private_data = data;
     transition->frame_func = transition_change_order_user_frame;
     transition->destroy_func = transition_change_order_destroy;
 
+    num = change_order_setup(data, layer, new_order, surface_num);
+    if(num < 0){
+        layout_transition_destroy(transition);
+        return;
+    }
+    data->surface_num = num;
+
     if(duration != 0){
         transition->time_duration = duration;
     }
 
-    data->layer = layer;
-    data->reorder = reorder;
-    data->surface_num = old_index;
-
     layout_transition_register(transition);
 
 }
@@ -961,6 +1133,8 @@ ivi_layout_surfaceSetTransition(struct ivi_layout_surface *ivisurf,
 	prop = &ivisurf->pending.prop;
 	prop->transitionType = type;
 	prop->transitionDuration = duration;
+
+	ivi_layout_mark_pending();
 	return 0;
 }
 
@@ -976,6 +1150,8 @@ ivi_layout_surfaceSetTransitionDuration(struct ivi_layout_surface *ivisurf,uint3
 
     prop = &ivisurf->pending.prop;
     prop->transitionDuration = duration*10;
+
+    ivi_layout_mark_pending();
     return 0;
 }
 
@@ -991,6 +1167,7 @@ ivi_layout_layerSetTransition(struct ivi_layout_layer *ivilayer,
 
     ivilayer->pending.prop.transitionType = type;
     ivilayer->pending.prop.transitionDuration = duration;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -1008,6 +1185,7 @@ ivi_layout_layerSetFadeInfo(struct ivi_layout_layer* ivilayer,
     ivilayer->pending.prop.isFadeIn = is_fade_in;
     ivilayer->pending.prop.startAlpha = start_alpha;
     ivilayer->pending.prop.endAlpha = end_alpha;
+    ivi_layout_mark_pending();
 
     return 0;
 }
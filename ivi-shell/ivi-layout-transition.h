@@ -24,12 +24,33 @@
 #define _WESTON_LAYOUT_TRANSITION_H_
 
 #include "ivi-layout.h"
+#include "id-map.h"
 
 struct ivi_layout_transition;
 
+enum ivi_layout_inner_transition_type{
+    IVI_LAYOUT_INNER_TRANSITION_NONE,
+    IVI_LAYOUT_INNER_TRANSITION_VIEW_MOVE_RESIZE,
+    IVI_LAYOUT_INNER_TRANSITION_VIEW_RESIZE,
+    IVI_LAYOUT_INNER_TRANSITION_VIEW_FADE,
+    IVI_LAYOUT_INNER_TRANSITION_LAYER_FADE,
+    IVI_LAYOUT_INNER_TRANSITION_LAYER_MOVE,
+    IVI_LAYOUT_INNER_TRANSITION_LAYER_VIEW_ORDER,
+    IVI_LAYOUT_INNER_TRANSITION_MAX,
+};
+
 struct ivi_layout_transition_set {
-    struct wl_event_source  *event_source;
-    struct wl_list          transition_list;
+    struct weston_compositor *compositor;
+    struct weston_animation  animation; /* linked while transitions run */
+    struct weston_output     *output;   /* output whose frame drives them */
+    struct wl_listener       output_destroy_listener;
+    struct wl_list           transition_list;
+
+    /* id of target surface/layer -> transition, one map per type */
+    struct id_map            index[IVI_LAYOUT_INNER_TRANSITION_MAX];
+
+    struct ivi_layout_transition *pool;
+    struct wl_list           free_list; /* unused transitions of pool */
 };
 
 typedef void (*ivi_layout_transition_destroy_user_func)(void* user_data);
@@ -37,6 +58,9 @@ typedef void (*ivi_layout_transition_destroy_user_func)(void* user_data);
 struct ivi_layout_transition_set *
 ivi_layout_transition_set_create(struct weston_compositor* ec);
 
+void
+ivi_layout_transition_set_schedule(struct ivi_layout_transition_set *transitions);
+
 void
 ivi_layout_transition_move_resize_view(struct ivi_layout_surface* surface,
                                           int32_t dest_x, int32_t dest_y,
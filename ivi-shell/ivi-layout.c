@@ -40,7 +40,8 @@
  * 5/ Set damage and trigger transform by using weston_view_geometry_dirty and
  *    weston_view_geometry_dirty.
  * 6/ Notify update of properties.
- * 7/ Trigger composition by weston_compositor_schedule_repaint.
+ * 7/ Trigger composition by weston_output_schedule_repaint of the outputs
+ *    whose view list or views were changed.
  *
  */
 
@@ -49,6 +50,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <linux/input.h>
 
 #include "compositor.h"
@@ -101,6 +103,17 @@ struct ivi_layout_screen {
 
     struct ivi_layout *layout;
     struct weston_output *output;
+    struct weston_layer weston_layer; /* views shown on output */
+    int32_t culled_view_count; /* views occluded at the last build */
+    struct wl_listener frame_listener; /* frame statistics of surfaces */
+    struct wl_listener present_listener;
+    struct wl_listener culled_frame_listener; /* frames of culled views */
+
+    /* geometry of output which layer transforms are built for */
+    struct {
+        int32_t x, y;
+        int32_t width, height;
+    } geometry;
 
     uint32_t event_mask;
 
@@ -112,6 +125,8 @@ struct ivi_layout_screen {
     struct {
         struct wl_list list_layer;
         struct wl_list link;
+        int32_t layer_count;  /* valid while serial is order_serial */
+        uint32_t serial;
     } order;
 };
 
@@ -133,6 +148,12 @@ get_instance(void)
     return &ivilayout;
 }
 
+void
+ivi_layout_mark_pending(void)
+{
+    ivilayout.commit.generation++;
+}
+
 static void
 ivi_layout_emitWarningSignal(uint32_t id_surface,
                              enum ivi_layout_warning_flag flag)
@@ -284,34 +305,233 @@ remove_orderlayer_from_screen(struct ivi_layout_layer *ivilayer)
 }
 
 /**
- * Internal API to add/remove a layer from screen.
+ * Internal API to look up surface/layer by id.
+ * Both are indexed in a hash map maintained at creation and removal.
  */
 static struct ivi_layout_surface *
-get_surface(struct wl_list *list_surf, uint32_t id_surface)
+get_surface(struct ivi_layout *layout, uint32_t id_surface)
 {
-    struct ivi_layout_surface *ivisurf;
+    return id_map_lookup(&layout->surface_map, id_surface);
+}
 
-    wl_list_for_each(ivisurf, list_surf, link) {
-        if (ivisurf->id_surface == id_surface) {
-            return ivisurf;
-        }
+static struct ivi_layout_layer *
+get_layer(struct ivi_layout *layout, uint32_t id_layer)
+{
+    return id_map_lookup(&layout->layer_map, id_layer);
+}
+
+/**
+ * Internal API to get the number of elements of order lists. The count is
+ * cached on the owner of list and is recounted only when an order list
+ * was changed since the last call.
+ */
+static int32_t
+get_surface_count_on_layer(struct ivi_layout_layer *ivilayer)
+{
+    struct ivi_layout *layout = ivilayer->layout;
+
+    if (ivilayer->order.serial != layout->order_serial) {
+        ivilayer->order.surface_count =
+            wl_list_length(&ivilayer->order.list_surface);
+        ivilayer->order.serial = layout->order_serial;
     }
 
-    return NULL;
+    return ivilayer->order.surface_count;
 }
 
-static struct ivi_layout_layer *
-get_layer(struct wl_list *list_layer, uint32_t id_layer)
+static int32_t
+get_layer_count_on_screen(struct ivi_layout_screen *iviscrn)
 {
-    struct ivi_layout_layer *ivilayer;
+    struct ivi_layout *layout = iviscrn->layout;
+
+    if (iviscrn->order.serial != layout->order_serial) {
+        iviscrn->order.layer_count =
+            wl_list_length(&iviscrn->order.list_layer);
+        iviscrn->order.serial = layout->order_serial;
+    }
+
+    return iviscrn->order.layer_count;
+}
+
+/**
+ * Internal APIs for frame statistics of surfaces. Every commit of the
+ * weston_surface is recorded in a ring. It is marked as repainted at the next
+ * frame of an output showing the view of the surface, and gets its latency
+ * when that frame is presented. Commits of a surface which is in no view list
+ * are never presented, so they are dropped instead.
+ */
+static uint64_t
+frame_stats_usec(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+static uint64_t
+frame_stats_now(struct weston_compositor *compositor)
+{
+    struct timespec ts;
+
+    weston_compositor_read_presentation_clock(compositor, &ts);
+
+    return frame_stats_usec(&ts);
+}
+
+static uint32_t
+region_area(pixman_region32_t *region)
+{
+    pixman_box32_t *boxes = NULL;
+    uint32_t area = 0;
+    int32_t n = 0;
+    int32_t i = 0;
+
+    boxes = pixman_region32_rectangles(region, &n);
+    for (i = 0; i < n; i++) {
+        area += (boxes[i].x2 - boxes[i].x1) * (boxes[i].y2 - boxes[i].y1);
+    }
+
+    return area;
+}
+
+static void
+frame_stats_record_commit(struct ivi_layout_surface *ivisurf,
+                          struct weston_surface *surface)
+{
+    struct ivi_layout_frame_record *record = NULL;
+
+    record = &ivisurf->frame_stats.records[ivisurf->frame_stats.count %
+                                           IVI_LAYOUT_FRAME_RECORD_COUNT];
+    record->commit_time = frame_stats_now(surface->compositor);
+    record->damage = region_area(&surface->pending.damage);
+    record->latency = 0;
+    record->dropped = 0;
+    ivisurf->frame_stats.count++;
+
+    /* the oldest record was overwritten before it was presented */
+    if (ivisurf->frame_stats.count - ivisurf->frame_stats.presented >
+        IVI_LAYOUT_FRAME_RECORD_COUNT) {
+        ivisurf->frame_stats.presented =
+            ivisurf->frame_stats.count - IVI_LAYOUT_FRAME_RECORD_COUNT;
+    }
+    if (ivisurf->frame_stats.repainted - ivisurf->frame_stats.presented >
+        IVI_LAYOUT_FRAME_RECORD_COUNT) {
+        ivisurf->frame_stats.repainted = ivisurf->frame_stats.presented;
+    }
+}
+
+static void
+frame_stats_drop_pending(struct ivi_layout_surface *ivisurf)
+{
+    struct ivi_layout_frame_record *record = NULL;
+    uint32_t i = 0;
+
+    for (i = ivisurf->frame_stats.repainted;
+         i != ivisurf->frame_stats.count; i++) {
+        record = &ivisurf->frame_stats.records[
+            i % IVI_LAYOUT_FRAME_RECORD_COUNT];
+        record->dropped = 1;
+    }
+
+    ivisurf->frame_stats.repainted = ivisurf->frame_stats.count;
+    if (ivisurf->frame_stats.repaint_mask == 0) {
+        ivisurf->frame_stats.presented = ivisurf->frame_stats.count;
+    }
+}
+
+static void
+frame_stats_handle_frame(struct wl_listener *listener, void *data)
+{
+    struct ivi_layout_screen *iviscrn =
+        container_of(listener, struct ivi_layout_screen, frame_listener);
+    struct weston_output *output = data;
+    struct ivi_layout_surface *ivisurf = NULL;
+    struct weston_view *view = NULL;
+
+    wl_list_for_each(ivisurf, &iviscrn->layout->list_surface, link) {
+        if (ivisurf->surface == NULL ||
+            wl_list_empty(&ivisurf->surface->views) ||
+            ivisurf->frame_stats.repainted == ivisurf->frame_stats.count) {
+            continue;
+        }
 
-    wl_list_for_each(ivilayer, list_layer, link) {
-        if (ivilayer->id_layer == id_layer) {
-            return ivilayer;
+        view = container_of(ivisurf->surface->views.next,
+                            struct weston_view, surface_link);
+        if (wl_list_empty(&view->layer_link)) {
+            frame_stats_drop_pending(ivisurf);
+            continue;
+        }
+
+        if (!(view->output_mask & (1u << output->id))) {
+            continue;
         }
+
+        ivisurf->frame_stats.repainted = ivisurf->frame_stats.count;
+        ivisurf->frame_stats.repaint_mask |= 1u << output->id;
     }
+}
 
-    return NULL;
+static void
+frame_stats_handle_present(struct wl_listener *listener, void *data)
+{
+    struct ivi_layout_screen *iviscrn =
+        container_of(listener, struct ivi_layout_screen, present_listener);
+    const struct timespec *stamp = data;
+    struct ivi_layout_surface *ivisurf = NULL;
+    struct ivi_layout_frame_record *record = NULL;
+    uint32_t mask = 1u << iviscrn->output->id;
+    uint64_t now = frame_stats_usec(stamp);
+    uint64_t latency = 0;
+
+    wl_list_for_each(ivisurf, &iviscrn->layout->list_surface, link) {
+        if (!(ivisurf->frame_stats.repaint_mask & mask)) {
+            continue;
+        }
+
+        while (ivisurf->frame_stats.presented !=
+               ivisurf->frame_stats.repainted) {
+            record = &ivisurf->frame_stats.records[
+                ivisurf->frame_stats.presented % IVI_LAYOUT_FRAME_RECORD_COUNT];
+            if (!record->dropped) {
+                latency = now > record->commit_time ?
+                          now - record->commit_time : 0;
+                record->latency = latency > UINT32_MAX ? UINT32_MAX : latency;
+            }
+            ivisurf->frame_stats.presented++;
+        }
+        ivisurf->frame_stats.repaint_mask = 0;
+    }
+}
+
+/**
+ * Culled views are not in the view list of the compositor, which only sends
+ * frame callbacks of surfaces in it. Clients of culled views are paced by
+ * the frames of the output instead, as if their views were repainted.
+ */
+static void
+send_culled_frame_callbacks(struct wl_listener *listener, void *data)
+{
+    struct ivi_layout_screen *iviscrn =
+        container_of(listener, struct ivi_layout_screen,
+                     culled_frame_listener);
+    struct ivi_layout *layout = iviscrn->layout;
+    const struct timespec *stamp = data;
+    struct ivi_layout_surface *ivisurf = NULL;
+    uint32_t msecs = stamp->tv_sec * 1000 + stamp->tv_nsec / 1000000;
+
+    if (iviscrn->culled_view_count == 0) {
+        return;
+    }
+
+    wl_list_for_each(ivisurf, &layout->list_surface, link) {
+        /* hidden.serial is only current for surfaces on screens */
+        if (!ivisurf->culling.culled ||
+            ivisurf->hidden.serial != layout->hidden.serial ||
+            ivisurf->surface == NULL ||
+            ivisurf->surface->output != iviscrn->output) {
+            continue;
+        }
+
+        weston_surface_send_frame_callbacks(ivisurf->surface, msecs);
+    }
 }
 
 /**
@@ -325,11 +545,7 @@ westonsurface_destroy_from_ivisurface(struct wl_listener *listener, void *data)
     ivisurf = container_of(listener, struct ivi_layout_surface,
                            surface_destroy_listener);
 
-    wl_list_init(&ivisurf->surface_rotation.link);
-    wl_list_init(&ivisurf->layer_rotation.link);
-    wl_list_init(&ivisurf->surface_pos.link);
-    wl_list_init(&ivisurf->layer_pos.link);
-    wl_list_init(&ivisurf->scaling.link);
+    wl_list_init(&ivisurf->transform.link);
 
     ivisurf->surface = NULL;
     ivi_layout_surfaceRemove(ivisurf);
@@ -397,6 +613,14 @@ create_screen(struct weston_compositor *ec)
         iviscrn->output = output;
         iviscrn->event_mask = 0;
 
+        iviscrn->frame_listener.notify = frame_stats_handle_frame;
+        wl_signal_add(&output->frame_signal, &iviscrn->frame_listener);
+        iviscrn->present_listener.notify = frame_stats_handle_present;
+        wl_signal_add(&output->present_signal, &iviscrn->present_listener);
+        iviscrn->culled_frame_listener.notify = send_culled_frame_callbacks;
+        wl_signal_add(&output->present_signal,
+                      &iviscrn->culled_frame_listener);
+
         wl_list_init(&iviscrn->pending.list_layer);
         wl_list_init(&iviscrn->pending.link);
 
@@ -405,7 +629,11 @@ create_screen(struct weston_compositor *ec)
 
         wl_list_init(&iviscrn->link_to_layer);
 
+        /* Add the layer of screen at the last of weston_compositor.layer_list */
+        weston_layer_init(&iviscrn->weston_layer, ec->layer_list.prev);
+
         wl_list_insert(&layout->list_screen, &iviscrn->link);
+        layout->screen_count++;
     }
 }
 
@@ -434,23 +662,234 @@ init_surfaceProperties(struct ivi_layout_SurfaceProperties *prop)
 /**
  * Internal APIs to be called from ivi_layout_commitChanges.
  */
+static struct weston_view *
+get_weston_view(struct ivi_layout_surface *ivisurf)
+{
+    if (ivisurf->surface == NULL ||
+        wl_list_empty(&ivisurf->surface->views)) {
+        return NULL;
+    }
+
+    return container_of(ivisurf->surface->views.next,
+                        struct weston_view, surface_link);
+}
+
+/**
+ * Internal APIs to release the renderer state of surfaces which are hidden
+ * for layout->hidden.delay msec. A surface is hidden when it is invisible, or
+ * on no visible layer of a screen; a culled view is visible, and will be shown
+ * as soon as the views above it move. A surface committed while hidden gets a
+ * renderer state again, so it waits for the delay again.
+ */
+static int32_t
+surface_is_shown(struct ivi_layout_surface *ivisurf)
+{
+    return ivisurf->hidden.serial == ivisurf->layout->hidden.serial;
+}
+
+static int
+release_hidden_surfaces(void *data)
+{
+    struct ivi_layout *layout = data;
+    struct ivi_layout_surface *ivisurf = NULL;
+    uint32_t now = weston_compositor_get_time();
+    uint32_t next = 0;
+    uint32_t elapsed = 0;
+    size_t size = 0;
+
+    layout->hidden.armed = 0;
+    if (layout->hidden.delay == 0) {
+        wl_event_source_timer_update(layout->hidden.timer, 0);
+        return 1;
+    }
+
+    wl_list_for_each(ivisurf, &layout->list_surface, link) {
+        if (!ivisurf->hidden.hidden || ivisurf->hidden.released ||
+            ivisurf->surface == NULL) {
+            continue;
+        }
+
+        elapsed = now - ivisurf->hidden.since;
+        if (elapsed < layout->hidden.delay) {
+            if (next == 0 || layout->hidden.delay - elapsed < next) {
+                next = layout->hidden.delay - elapsed;
+            }
+            continue;
+        }
+
+        size = weston_surface_release_renderer_state(ivisurf->surface);
+        ivisurf->hidden.released = 1;
+        layout->hidden.stats.released_surfaces++;
+        layout->hidden.stats.released_bytes += size;
+        weston_log("ivi-layout: released %zu bytes of hidden surface %u\n",
+                   size, ivisurf->id_surface);
+    }
+
+    layout->hidden.armed = next != 0;
+    wl_event_source_timer_update(layout->hidden.timer, next);
+
+    return 1;
+}
+
+static void
+hide_surface(struct ivi_layout *layout, struct ivi_layout_surface *ivisurf,
+             uint32_t now)
+{
+    ivisurf->hidden.hidden = 1;
+    ivisurf->hidden.released = 0;
+    ivisurf->hidden.since = now;
+
+    if (layout->hidden.delay != 0 && !layout->hidden.armed) {
+        layout->hidden.armed = 1;
+        wl_event_source_timer_update(layout->hidden.timer,
+                                     layout->hidden.delay);
+    }
+}
+
+static void
+update_hidden_surfaces(struct ivi_layout *layout)
+{
+    struct ivi_layout_surface *ivisurf = NULL;
+    uint32_t now = weston_compositor_get_time();
+
+    wl_list_for_each(ivisurf, &layout->list_surface, link) {
+        if (surface_is_shown(ivisurf)) {
+            ivisurf->hidden.hidden = 0;
+            ivisurf->hidden.released = 0;
+        } else if (!ivisurf->hidden.hidden) {
+            hide_surface(layout, ivisurf, now);
+        }
+    }
+}
+
+static void
+surface_handle_commit(struct wl_listener *listener, void *data)
+{
+    struct ivi_layout_surface *ivisurf =
+        container_of(listener, struct ivi_layout_surface,
+                     surface_commit_listener);
+    struct weston_surface *surface = data;
+    struct weston_view *view = get_weston_view(ivisurf);
+
+    frame_stats_record_commit(ivisurf, surface);
+
+    if (view == NULL || wl_list_empty(&view->layer_link)) {
+        frame_stats_drop_pending(ivisurf);
+    }
+
+    /* a released surface has a renderer state again after attach */
+    if (view == NULL || !surface_is_shown(ivisurf)) {
+        if (!ivisurf->hidden.hidden || ivisurf->hidden.released) {
+            hide_surface(ivisurf->layout, ivisurf,
+                         weston_compositor_get_time());
+        }
+    }
+}
+
+static void
+watch_surface_commits(struct ivi_layout_surface *ivisurf)
+{
+    ivisurf->surface_commit_listener.notify = surface_handle_commit;
+    wl_signal_add(&ivisurf->surface->commit_signal,
+                  &ivisurf->surface_commit_listener);
+}
+
+static void
+unwatch_surface_commits(struct ivi_layout_surface *ivisurf)
+{
+    wl_list_remove(&ivisurf->surface_commit_listener.link);
+    wl_list_init(&ivisurf->surface_commit_listener.link);
+}
+
+/**
+ * Translate notification masks of a layer and one of its surfaces, which
+ * hold what was set since the last commit, to the set of derived states of
+ * the surface which have to be rebuilt.
+ */
+static uint32_t
+get_dirty_flags(struct ivi_layout_layer *ivilayer,
+                struct ivi_layout_surface *ivisurf)
+{
+    uint32_t layer_mask = ivilayer->event_mask;
+    uint32_t surf_mask  = ivisurf->event_mask;
+    uint32_t dirty = ivisurf->dirty;
+
+    if ((layer_mask | surf_mask) & IVI_NOTIFICATION_ADD) {
+        return IVI_LAYOUT_DIRTY_ALL;
+    }
+
+    if ((layer_mask | surf_mask) & IVI_NOTIFICATION_OPACITY) {
+        dirty |= IVI_LAYOUT_DIRTY_OPACITY;
+    }
+
+    if ((layer_mask | surf_mask) & IVI_NOTIFICATION_VISIBILITY) {
+        dirty |= IVI_LAYOUT_DIRTY_VISIBILITY;
+    }
+
+    if ((layer_mask | surf_mask) & IVI_NOTIFICATION_CHROMA_KEY) {
+        dirty |= IVI_LAYOUT_DIRTY_CHROMA_KEY;
+    }
+
+    if (layer_mask & IVI_NOTIFICATION_ORIENTATION) {
+        dirty |= IVI_LAYOUT_DIRTY_LAYER_ORIENTATION;
+    }
+
+    if (layer_mask & (IVI_NOTIFICATION_POSITION |
+                      IVI_NOTIFICATION_DEST_RECT)) {
+        dirty |= IVI_LAYOUT_DIRTY_LAYER_POSITION;
+    }
+
+    if (surf_mask & (IVI_NOTIFICATION_POSITION |
+                     IVI_NOTIFICATION_DEST_RECT)) {
+        dirty |= IVI_LAYOUT_DIRTY_SURFACE_POSITION;
+    }
+
+    if ((surf_mask & IVI_NOTIFICATION_ORIENTATION) ||
+        (layer_mask & (IVI_NOTIFICATION_DEST_RECT |
+                       IVI_NOTIFICATION_DIMENSION))) {
+        dirty |= IVI_LAYOUT_DIRTY_SURFACE_ORIENTATION;
+    }
+
+    if ((layer_mask | surf_mask) & (IVI_NOTIFICATION_SOURCE_RECT |
+                                    IVI_NOTIFICATION_DEST_RECT   |
+                                    IVI_NOTIFICATION_DIMENSION)) {
+        dirty |= IVI_LAYOUT_DIRTY_SCALE;
+    }
+
+    return dirty;
+}
+
 static void
 update_opacity(struct ivi_layout_layer *ivilayer,
-               struct ivi_layout_surface *ivisurf)
+               struct ivi_layout_surface *ivisurf,
+               struct weston_view *view)
 {
     double layer_alpha = wl_fixed_to_double(ivilayer->prop.opacity);
     double surf_alpha  = wl_fixed_to_double(ivisurf->prop.opacity);
 
-    if ((ivilayer->event_mask & IVI_NOTIFICATION_OPACITY) ||
-        (ivisurf->event_mask  & IVI_NOTIFICATION_OPACITY)) {
-        struct weston_view *tmpview = NULL;
-        wl_list_for_each(tmpview, &ivisurf->surface->views, surface_link)
-        {
-            if (tmpview == NULL) {
-                continue;
-            }
-            tmpview->alpha = layer_alpha * surf_alpha;
-        }
+    weston_view_set_alpha(view, layer_alpha * surf_alpha);
+}
+
+/**
+ * The chroma key of a surface takes precedence over the one of its layer.
+ */
+static void
+update_chroma_key(struct ivi_layout_layer *ivilayer,
+                  struct ivi_layout_surface *ivisurf,
+                  struct weston_view *view)
+{
+    if (ivisurf->prop.chromaKeyEnabled) {
+        weston_view_set_chroma_key(view, 1,
+                                   (ivisurf->prop.chromaKeyRed   << 16) |
+                                   (ivisurf->prop.chromaKeyGreen <<  8) |
+                                    ivisurf->prop.chromaKeyBlue);
+    } else if (ivilayer->prop.chromaKeyEnabled) {
+        weston_view_set_chroma_key(view, 1,
+                                   (ivilayer->prop.chromaKeyRed   << 16) |
+                                   (ivilayer->prop.chromaKeyGreen <<  8) |
+                                    ivilayer->prop.chromaKeyBlue);
+    } else {
+        weston_view_set_chroma_key(view, 0, 0);
     }
 }
 
@@ -458,8 +897,7 @@ static void
 update_surface_orientation(struct ivi_layout_layer *ivilayer,
                            struct ivi_layout_surface *ivisurf)
 {
-    struct weston_view *view;
-    struct weston_matrix  *matrix = &ivisurf->surface_rotation.matrix;
+    struct weston_matrix  *matrix = &ivisurf->surface_rotation;
     float width  = 0.0f;
     float height = 0.0f;
     float v_sin  = 0.0f;
@@ -469,17 +907,6 @@ update_surface_orientation(struct ivi_layout_layer *ivilayer,
     float sx = 1.0f;
     float sy = 1.0f;
 
-    wl_list_for_each(view, &ivisurf->surface->views, surface_link)
-    {
-        if (view != NULL) {
-            break;
-        }
-    }
-
-    if (view == NULL) {
-        return;
-    }
-
     if ((ivilayer->prop.destWidth == 0) ||
         (ivilayer->prop.destHeight == 0)) {
         return;
@@ -510,8 +937,6 @@ update_surface_orientation(struct ivi_layout_layer *ivilayer,
         sy = height / width;
         break;
     }
-    wl_list_remove(&ivisurf->surface_rotation.link);
-    weston_view_geometry_dirty(view);
 
     weston_matrix_init(matrix);
     cx = 0.5f * width;
@@ -520,21 +945,17 @@ update_surface_orientation(struct ivi_layout_layer *ivilayer,
     weston_matrix_rotate_xy(matrix, v_cos, v_sin);
     weston_matrix_scale(matrix, sx, sy, 1.0);
     weston_matrix_translate(matrix, cx, cy, 0.0f);
-    wl_list_insert(&view->geometry.transformation_list,
-                   &ivisurf->surface_rotation.link);
-
-    weston_view_set_transform_parent(view, NULL);
-    weston_view_update_transform(view);
 }
 
+/**
+ * The layer part of the transform is shared by all surfaces of the layer,
+ * so it is computed once per layer and composed into each surface matrix.
+ */
 static void
-update_layer_orientation(struct ivi_layout_layer *ivilayer,
-                         struct ivi_layout_surface *ivisurf)
+update_layer_transform(struct ivi_layout_layer *ivilayer,
+                       struct weston_output *output)
 {
-    struct weston_surface *es = ivisurf->surface;
-    struct weston_view    *view;
-    struct weston_matrix  *matrix = &ivisurf->layer_rotation.matrix;
-    struct weston_output  *output = NULL;
+    struct weston_matrix  *matrix = &ivilayer->transform;
     float width  = 0.0f;
     float height = 0.0f;
     float v_sin  = 0.0f;
@@ -544,24 +965,13 @@ update_layer_orientation(struct ivi_layout_layer *ivilayer,
     float sx = 1.0f;
     float sy = 1.0f;
 
-    wl_list_for_each(view, &ivisurf->surface->views, surface_link)
-    {
-        if (view != NULL) {
-            break;
-        }
-    }
-
-    if (es == NULL || view == NULL) {
-        return;
-    }
+    weston_matrix_init(matrix);
+    weston_matrix_translate(matrix, (float)ivilayer->prop.destX,
+                            (float)ivilayer->prop.destY, 0.0f);
 
-    output = es->output;
     if (output == NULL) {
         return;
     }
-    if ((output->width == 0) || (output->height == 0)) {
-        return;
-    }
     width = (float)output->width;
     height = (float)output->height;
 
@@ -588,51 +998,29 @@ update_layer_orientation(struct ivi_layout_layer *ivilayer,
         sy = height / width;
         break;
     }
-    wl_list_remove(&ivisurf->layer_rotation.link);
-    weston_view_geometry_dirty(view);
 
-    weston_matrix_init(matrix);
-    cx = 0.5f * width;
-    cy = 0.5f * height;
-    weston_matrix_translate(matrix, -cx, -cy, 0.0f);
-    weston_matrix_rotate_xy(matrix, v_cos, v_sin);
-    weston_matrix_scale(matrix, sx, sy, 1.0);
-    weston_matrix_translate(matrix, cx, cy, 0.0f);
-    wl_list_insert(&view->geometry.transformation_list,
-                   &ivisurf->layer_rotation.link);
+    if ((width != 0.0f) && (height != 0.0f) && (v_cos != 1.0f)) {
+        cx = 0.5f * width;
+        cy = 0.5f * height;
+        weston_matrix_translate(matrix, -cx, -cy, 0.0f);
+        weston_matrix_rotate_xy(matrix, v_cos, v_sin);
+        weston_matrix_scale(matrix, sx, sy, 1.0);
+        weston_matrix_translate(matrix, cx, cy, 0.0f);
+    }
 
-    weston_view_set_transform_parent(view, NULL);
-    weston_view_update_transform(view);
+    /* coordinates of screen are relative to the output of the screen */
+    weston_matrix_translate(matrix, (float)output->x, (float)output->y, 0.0f);
 }
 
 static void
 update_surface_position(struct ivi_layout_surface *ivisurf)
 {
-    struct weston_view *view;
     float tx  = (float)ivisurf->prop.destX;
     float ty  = (float)ivisurf->prop.destY;
-    struct weston_matrix *matrix = &ivisurf->surface_pos.matrix;
-
-    wl_list_for_each(view, &ivisurf->surface->views, surface_link)
-    {
-        if (view != NULL) {
-            break;
-        }
-    }
-
-    if (view == NULL) {
-        return;
-    }
-
-    wl_list_remove(&ivisurf->surface_pos.link);
+    struct weston_matrix *matrix = &ivisurf->surface_pos;
 
     weston_matrix_init(matrix);
     weston_matrix_translate(matrix, tx, ty, 0.0f);
-    wl_list_insert(&view->geometry.transformation_list,
-                   &ivisurf->surface_pos.link);
-
-    weston_view_set_transform_parent(view, NULL);
-    weston_view_update_transform(view);
 
 #if 0
     /* disable zoom transition */
@@ -641,44 +1029,51 @@ update_surface_position(struct ivi_layout_surface *ivisurf)
 
 }
 
+/**
+ * Map the source rectangle onto buffer_viewport of weston_surface, the way
+ * wl_viewport crops a buffer, so renderers upload and sample only texels
+ * inside it. The rectangle is clipped to the buffer, and a rectangle
+ * covering the whole buffer removes the crop. So does the default source
+ * rectangle, which the controller never set: it follows the buffer size.
+ */
 static void
-update_layer_position(struct ivi_layout_layer *ivilayer,
-               struct ivi_layout_surface *ivisurf)
-{
-    struct weston_view *view;
-    struct weston_matrix *matrix = &ivisurf->layer_pos.matrix;
-    float tx  = (float)ivilayer->prop.destX;
-    float ty  = (float)ivilayer->prop.destY;
+update_source_viewport(struct ivi_layout_surface *ivisurf)
+{
+    struct weston_surface *surface = ivisurf->surface;
+    const uint32_t buffer_width  = surface->width_from_buffer;
+    const uint32_t buffer_height = surface->height_from_buffer;
+    uint32_t x1 = ivisurf->prop.sourceX;
+    uint32_t y1 = ivisurf->prop.sourceY;
+    uint32_t x2 = x1 + ivisurf->prop.sourceWidth;
+    uint32_t y2 = y1 + ivisurf->prop.sourceHeight;
+
+    x1 = MIN(x1, buffer_width);
+    y1 = MIN(y1, buffer_height);
+    x2 = MIN(x2, buffer_width);
+    y2 = MIN(y2, buffer_height);
+
+    if ((ivisurf->pending.prop.sourceWidth == 0 &&
+         ivisurf->pending.prop.sourceHeight == 0) ||
+        x2 <= x1 || y2 <= y1 ||
+        (x1 == 0 && y1 == 0 && x2 == buffer_width && y2 == buffer_height)) {
+        weston_surface_set_viewport_source(surface, 0, 0,
+                                           wl_fixed_from_int(-1),
+                                           wl_fixed_from_int(-1));
+        return;
+    }
 
-    wl_list_for_each(view, &ivisurf->surface->views, surface_link)
-    {
-        if (view != NULL) {
-            break;
-        }
-    }
-
-    if (view == NULL) {
-        return;
-    }
-
-    wl_list_remove(&ivisurf->layer_pos.link);
-
-    weston_matrix_init(matrix);
-    weston_matrix_translate(matrix, tx, ty, 0.0f);
-    wl_list_insert(
-        &view->geometry.transformation_list,
-        &ivisurf->layer_pos.link);
-
-    weston_view_set_transform_parent(view, NULL);
-    weston_view_update_transform(view);
+    weston_surface_set_viewport_source(surface,
+                                       wl_fixed_from_int(x1),
+                                       wl_fixed_from_int(y1),
+                                       wl_fixed_from_int(x2 - x1),
+                                       wl_fixed_from_int(y2 - y1));
 }
 
 static void
 update_scale(struct ivi_layout_layer *ivilayer,
                struct ivi_layout_surface *ivisurf)
 {
-    struct weston_view *view;
-    struct weston_matrix *matrix = &ivisurf->scaling.matrix;
+    struct weston_matrix *matrix = &ivisurf->scaling;
     float sx = 0.0f;
     float sy = 0.0f;
     float lw = 0.0f;
@@ -686,17 +1081,6 @@ update_scale(struct ivi_layout_layer *ivilayer,
     float lh = 0.0f;
     float sh = 0.0f;
 
-    wl_list_for_each(view, &ivisurf->surface->views, surface_link)
-    {
-        if (view != NULL) {
-            break;
-        }
-    }
-
-    if (view == NULL) {
-        return;
-    }
-
     if (ivisurf->prop.sourceWidth == 0 && ivisurf->prop.sourceHeight == 0) {
         ivisurf->prop.sourceWidth  = ivisurf->surface->width_from_buffer;
         ivisurf->prop.sourceHeight = ivisurf->surface->height_from_buffer;
@@ -707,6 +1091,8 @@ update_scale(struct ivi_layout_layer *ivilayer,
         }
     }
 
+    update_source_viewport(ivisurf);
+
     lw = ((float)ivilayer->prop.destWidth  / ivilayer->prop.sourceWidth );
     sw = ((float)ivisurf->prop.destWidth   / ivisurf->prop.sourceWidth  );
     lh = ((float)ivilayer->prop.destHeight / ivilayer->prop.sourceHeight);
@@ -714,47 +1100,143 @@ update_scale(struct ivi_layout_layer *ivilayer,
     sx = sw * lw;
     sy = sh * lh;
 
-    wl_list_remove(&ivisurf->scaling.link);
     weston_matrix_init(matrix);
     weston_matrix_scale(matrix, sx, sy, 1.0f);
+}
+
+/**
+ * Compose the surface matrices and the layer transform into the single
+ * weston_transform which is linked to the view.
+ */
+static void
+update_transform(struct ivi_layout_layer *ivilayer,
+                 struct ivi_layout_surface *ivisurf,
+                 struct weston_view *view)
+{
+    struct weston_matrix *matrix = &ivisurf->transform.matrix;
 
-    wl_list_insert(&view->geometry.transformation_list,
-                   &ivisurf->scaling.link);
+    *matrix = ivisurf->scaling;
+    weston_matrix_multiply(matrix, &ivisurf->surface_rotation);
+    weston_matrix_multiply(matrix, &ivisurf->surface_pos);
+    weston_matrix_multiply(matrix, &ivilayer->transform);
 
-    weston_view_set_transform_parent(view, NULL);
-    weston_view_update_transform(view);
+    /* the transform is unlinked when the native content is replaced */
+    if (wl_list_empty(&ivisurf->transform.link)) {
+        wl_list_insert(&view->geometry.transformation_list,
+                       &ivisurf->transform.link);
+        weston_view_set_transform_parent(view, NULL);
+    }
 }
 
 static void
 update_prop(struct ivi_layout_layer *ivilayer,
             struct ivi_layout_surface *ivisurf)
 {
-    if (ivilayer->event_mask | ivisurf->event_mask) {
-        update_opacity(ivilayer, ivisurf);
-        update_layer_orientation(ivilayer, ivisurf);
-        update_layer_position(ivilayer, ivisurf);
+    struct weston_view *view;
+    uint32_t dirty = get_dirty_flags(ivilayer, ivisurf);
+
+    view = get_weston_view(ivisurf);
+    if (view == NULL) {
+        return;
+    }
+
+    if (wl_list_empty(&ivisurf->transform.link)) {
+        dirty = IVI_LAYOUT_DIRTY_ALL;
+    }
+
+    if (dirty == 0) {
+        return;
+    }
+
+    if (dirty & IVI_LAYOUT_DIRTY_OPACITY) {
+        update_opacity(ivilayer, ivisurf, view);
+    }
+    if (dirty & IVI_LAYOUT_DIRTY_CHROMA_KEY) {
+        update_chroma_key(ivilayer, ivisurf, view);
+    }
+    if (dirty & IVI_LAYOUT_DIRTY_SURFACE_POSITION) {
         update_surface_position(ivisurf);
+    }
+    if (dirty & IVI_LAYOUT_DIRTY_SURFACE_ORIENTATION) {
         update_surface_orientation(ivilayer, ivisurf);
+    }
+    if (dirty & IVI_LAYOUT_DIRTY_SCALE) {
         update_scale(ivilayer, ivisurf);
+    }
 
-        ivisurf->update_count++;
+    ivisurf->dirty = 0;
+    ivisurf->update_count++;
 
-        struct weston_view *tmpview;
-        wl_list_for_each(tmpview, &ivisurf->surface->views, surface_link)
-        {
-            if (tmpview != NULL) {
-                break;
-            }
-        }
+    if (dirty & (IVI_LAYOUT_DIRTY_TRANSFORM | IVI_LAYOUT_DIRTY_VISIBILITY)) {
+        /* repaint the area the view covered before this commit */
+        weston_view_damage_below(view);
+    }
 
-        if (tmpview != NULL) {
-            weston_view_geometry_dirty(tmpview);
-        }
+    if (dirty & IVI_LAYOUT_DIRTY_TRANSFORM) {
+        update_transform(ivilayer, ivisurf, view);
+    }
 
-        if (ivisurf->surface != NULL) {
-            weston_surface_damage(ivisurf->surface);
-        }
+    /* the opaque region of the view depends on alpha and chroma key too,
+     * and view lists are built from it right after this */
+    if (dirty & (IVI_LAYOUT_DIRTY_TRANSFORM |
+                 IVI_LAYOUT_DIRTY_OPACITY   |
+                 IVI_LAYOUT_DIRTY_CHROMA_KEY)) {
+        weston_view_geometry_dirty(view);
+        weston_view_update_transform(view);
+    }
+
+    weston_surface_damage(ivisurf->surface);
+}
+
+/**
+ * View lists depend on visibility and render order. With occlusion culling
+ * they also depend on opacity and, while any view occludes others, on
+ * geometry of views.
+ */
+static int32_t
+changes_view_list(struct ivi_layout *layout, uint32_t event_mask)
+{
+    if (event_mask & (IVI_NOTIFICATION_VISIBILITY |
+                      IVI_NOTIFICATION_OPACITY    |
+                      IVI_NOTIFICATION_ORIENTATION |
+                      IVI_NOTIFICATION_CHROMA_KEY)) {
+        return 1;
+    }
+
+    if (layout->culling.occluder_count > 0 &&
+        (event_mask & (IVI_NOTIFICATION_SOURCE_RECT |
+                       IVI_NOTIFICATION_DEST_RECT   |
+                       IVI_NOTIFICATION_DIMENSION   |
+                       IVI_NOTIFICATION_POSITION))) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Layer transforms contain position and size of the output of the screen.
+ * Returns 1 when the output has changed since they were built.
+ */
+static int32_t
+update_screen_geometry(struct ivi_layout_screen *iviscrn)
+{
+    struct weston_output *output = iviscrn->output;
+
+    if (output == NULL ||
+        (iviscrn->geometry.x      == output->x     &&
+         iviscrn->geometry.y      == output->y     &&
+         iviscrn->geometry.width  == output->width &&
+         iviscrn->geometry.height == output->height)) {
+        return 0;
     }
+
+    iviscrn->geometry.x      = output->x;
+    iviscrn->geometry.y      = output->y;
+    iviscrn->geometry.width  = output->width;
+    iviscrn->geometry.height = output->height;
+
+    return 1;
 }
 
 static void
@@ -763,10 +1245,38 @@ commit_changes(struct ivi_layout *layout)
     struct ivi_layout_screen  *iviscrn  = NULL;
     struct ivi_layout_layer   *ivilayer = NULL;
     struct ivi_layout_surface *ivisurf  = NULL;
+    int32_t output_changed = 0;
 
     wl_list_for_each(iviscrn, &layout->list_screen, link) {
+        /* e.g. a mode switch, which is not signalled like a move */
+        output_changed = update_screen_geometry(iviscrn);
+        if (output_changed) {
+            layout->commit.view_list_dirty = 1;
+        }
+
         wl_list_for_each(ivilayer, &iviscrn->order.list_layer, order.link) {
+            if (output_changed ||
+                (ivilayer->event_mask & (IVI_NOTIFICATION_ORIENTATION |
+                                         IVI_NOTIFICATION_POSITION    |
+                                         IVI_NOTIFICATION_DEST_RECT   |
+                                         IVI_NOTIFICATION_ADD))) {
+                update_layer_transform(ivilayer, iviscrn->output);
+            }
+
+            if (changes_view_list(layout, ivilayer->event_mask)) {
+                layout->commit.view_list_dirty = 1;
+            }
+
             wl_list_for_each(ivisurf, &ivilayer->order.list_surface, order.link) {
+                if (changes_view_list(layout, ivisurf->event_mask)) {
+                    layout->commit.view_list_dirty = 1;
+                }
+
+                if (output_changed) {
+                    ivisurf->dirty |= IVI_LAYOUT_DIRTY_LAYER_ORIENTATION |
+                                      IVI_LAYOUT_DIRTY_LAYER_POSITION;
+                }
+
                 update_prop(ivilayer, ivisurf);
             }
         }
@@ -877,12 +1387,18 @@ commit_list_layer(struct ivi_layout *layout)
         ivilayer->pending.prop.transitionType = IVI_LAYOUT_TRANSITION_NONE;
 
         ivilayer->prop = ivilayer->pending.prop;
+        if (ivilayer->plane_pinned != ivilayer->pending.plane_pinned) {
+            ivilayer->plane_pinned = ivilayer->pending.plane_pinned;
+            layout->commit.view_list_dirty = 1;
+        }
 
         if (!(ivilayer->event_mask &
               (IVI_NOTIFICATION_ADD | IVI_NOTIFICATION_REMOVE)) ) {
             continue;
         }
 
+        layout->order_serial++;
+
         if (ivilayer->event_mask & IVI_NOTIFICATION_REMOVE) {
             wl_list_for_each_safe(ivisurf, next,
                 &ivilayer->order.list_surface, order.link) {
@@ -928,6 +1444,177 @@ commit_list_layer(struct ivi_layout *layout)
     }
 }
 
+/**
+ * Rebuild the weston_layer of a screen from its layers and surfaces.
+ * Views which are dropped from the list or are not at the same position
+ * as before damage the output, so that only the outputs whose view list
+ * really changed are repainted.
+ */
+static int32_t
+layer_prefers_plane(struct ivi_layout_layer *ivilayer,
+                    struct ivi_layout_screen *iviscrn)
+{
+    struct ivi_layout *layout = ivilayer->layout;
+    struct weston_output *output = iviscrn->output;
+
+    switch (layout->optimization_mode[IVI_LAYOUT_OPTIMIZATION_HARDWARE_PLANE]) {
+    case IVI_LAYOUT_OPTIMIZATION_MODE_FORCE_OFF:
+        return 0;
+    case IVI_LAYOUT_OPTIMIZATION_MODE_FORCE_ON:
+        if (ivilayer->prop.destX <= 0 && ivilayer->prop.destY <= 0 &&
+            ivilayer->prop.destX + (int32_t)ivilayer->prop.destWidth >=
+                output->width &&
+            ivilayer->prop.destY + (int32_t)ivilayer->prop.destHeight >=
+                output->height) {
+            return 1;
+        }
+        return ivilayer->plane_pinned || ivilayer->prop.chromaKeyEnabled;
+    default:
+        /* planes with color key save the keying in the renderer */
+        return ivilayer->plane_pinned || ivilayer->prop.chromaKeyEnabled;
+    }
+}
+
+/**
+ * A view is visible if it is not covered by the opaque area accumulated
+ * from the views above it. The opaque area of a view is only accumulated
+ * when the view is fully opaque, i.e. alpha of layer and surface is 1.
+ */
+static int32_t
+cull_view(struct weston_view *view, pixman_region32_t *opaque)
+{
+    pixman_box32_t *box = NULL;
+
+    weston_view_update_transform(view);
+
+    box = pixman_region32_extents(&view->transform.boundingbox);
+    if (pixman_region32_contains_rectangle(opaque, box) ==
+        PIXMAN_REGION_IN) {
+        return 1;
+    }
+
+    return 0;
+}
+
+static void
+build_view_list(struct ivi_layout_screen *iviscrn)
+{
+    struct ivi_layout *layout = iviscrn->layout;
+    struct ivi_layout_layer   *ivilayer = NULL;
+    struct ivi_layout_surface *ivisurf  = NULL;
+    struct weston_view *view = NULL;
+    struct weston_view *next = NULL;
+    struct wl_list old_list;
+    pixman_region32_t opaque;
+    int32_t covered = 0;
+
+    layout->culling.serial++;
+    iviscrn->culled_view_count = 0;
+
+    wl_list_init(&old_list);
+    wl_list_insert_list(&old_list, &iviscrn->weston_layer.view_list);
+    wl_list_init(&iviscrn->weston_layer.view_list);
+
+    pixman_region32_init(&opaque);
+
+    /* walk from the top, so that views hidden by opaque views above
+     * them are never put into the view list */
+    wl_list_for_each_reverse(ivilayer, &iviscrn->order.list_layer, order.link) {
+        int32_t prefer_plane = 0;
+
+        if (ivilayer->prop.visibility == 0)
+            continue;
+
+        /* planes are useless when there is only the primary one */
+        if (iviscrn->output->plane_count > 1) {
+            prefer_plane = layer_prefers_plane(ivilayer, iviscrn);
+        }
+
+        wl_list_for_each_reverse(ivisurf, &ivilayer->order.list_surface,
+                                 order.link) {
+            if (ivisurf->prop.visibility == 0)
+                continue;
+            if (ivisurf->surface == NULL)
+                continue;
+
+            view = get_weston_view(ivisurf);
+            if (view == NULL)
+                continue;
+
+            /* shown on the screen, even if it is culled below */
+            ivisurf->hidden.serial = layout->hidden.serial;
+
+            /* a surface on several layers is shown on the topmost */
+            if (ivisurf->culling.serial == layout->culling.serial)
+                continue;
+            ivisurf->culling.serial = layout->culling.serial;
+            ivisurf->culling.occluding = 0;
+            ivisurf->culling.culled = 0;
+
+            if (covered || cull_view(view, &opaque)) {
+                ivisurf->culling.culled = 1;
+                iviscrn->culled_view_count++;
+                continue;
+            }
+
+            view->prefer_plane = prefer_plane;
+
+            /* views are inserted at tail, so old list is consumed at head */
+            if (old_list.next != &view->layer_link) {
+                weston_view_damage_below(view);
+            }
+
+            wl_list_remove(&view->layer_link);
+            wl_list_insert(iviscrn->weston_layer.view_list.prev,
+                           &view->layer_link);
+
+            if (!pixman_region32_not_empty(&view->transform.opaque))
+                continue;
+
+            ivisurf->culling.occluding = 1;
+            layout->culling.occluder_count++;
+            pixman_region32_copy(&ivisurf->culling.opaque,
+                                 &ivisurf->surface->opaque);
+            pixman_region32_union(&opaque, &opaque, &view->transform.opaque);
+
+            /* the rest is hidden without looking at transforms */
+            if (pixman_region32_contains_rectangle(&opaque,
+                    pixman_region32_extents(&iviscrn->output->region)) ==
+                PIXMAN_REGION_IN) {
+                covered = 1;
+            }
+        }
+    }
+
+    pixman_region32_fini(&opaque);
+
+    wl_list_for_each_safe(view, next, &old_list, layer_link) {
+        weston_view_damage_below(view);
+        wl_list_remove(&view->layer_link);
+        wl_list_init(&view->layer_link);
+    }
+}
+
+static void
+build_view_lists(struct ivi_layout *layout)
+{
+    struct ivi_layout_screen *iviscrn = NULL;
+
+    layout->culling.culled_view_count = 0;
+    layout->culling.occluder_count = 0;
+    layout->hidden.serial++;
+
+    wl_list_for_each(iviscrn, &layout->list_screen, link) {
+        build_view_list(iviscrn);
+        layout->culling.culled_view_count += iviscrn->culled_view_count;
+    }
+
+    layout->commit.order_serial = layout->order_serial;
+    layout->commit.view_list_dirty = 0;
+
+    update_hidden_surfaces(layout);
+}
+
 static void
 commit_list_screen(struct ivi_layout *layout)
 {
@@ -937,6 +1624,11 @@ commit_list_screen(struct ivi_layout *layout)
     struct ivi_layout_surface *ivisurf  = NULL;
 
     wl_list_for_each(iviscrn, &layout->list_screen, link) {
+        if (iviscrn->event_mask &
+            (IVI_NOTIFICATION_ADD | IVI_NOTIFICATION_REMOVE)) {
+            layout->order_serial++;
+        }
+
         if (iviscrn->event_mask & IVI_NOTIFICATION_REMOVE) {
             wl_list_for_each_safe(ivilayer, next,
                      &iviscrn->order.list_layer, order.link) {
@@ -974,37 +1666,6 @@ commit_list_screen(struct ivi_layout *layout)
         }
 
         iviscrn->event_mask = 0;
-
-        /* Clear view list of layout layer */
-        wl_list_init(&layout->layout_layer.view_list);
-
-        wl_list_for_each(ivilayer, &iviscrn->order.list_layer, order.link) {
-
-            if (ivilayer->prop.visibility == 0)
-                continue;
-
-            wl_list_for_each(ivisurf, &ivilayer->order.list_surface, order.link) {
-                struct weston_view *tmpview = NULL;
-                wl_list_for_each(tmpview, &ivisurf->surface->views, surface_link)
-                {
-                    if (tmpview != NULL) {
-                        break;
-                    }
-                }
-
-                if (ivisurf->prop.visibility == 0)
-                    continue;
-                if (ivisurf->surface == NULL || tmpview == NULL)
-                    continue;
-
-                wl_list_insert(&layout->layout_layer.view_list,
-                               &tmpview->layer_link);
-
-                ivisurf->surface->output = iviscrn->output;
-            }
-        }
-
-        break;
     }
 }
 
@@ -1020,21 +1681,117 @@ commit_transition(struct ivi_layout* layout)
 
     wl_list_init(&layout->pending_transition_list);
 
-    wl_event_source_timer_update(layout->transitions->event_source, 1);
+    ivi_layout_transition_set_schedule(layout->transitions);
 }
 
+/**
+ * Property changes are not notified at each commit. The event_mask of a
+ * commit is accumulated to notification.pending of the layer/surface, and
+ * they are notified once with the combined mask when the event loop gets
+ * idle, i.e. after all commits made while handling the current events.
+ * That works while outputs are asleep too. Objects without change are not
+ * notified.
+ */
 static void
-send_surface_prop(struct ivi_layout_surface *ivisurf)
+flush_notification(struct ivi_layout *layout)
 {
-    wl_signal_emit(&ivisurf->property_changed, ivisurf);
-    ivisurf->event_mask = 0;
+    struct ivi_layout_layer   *ivilayer = NULL;
+    struct ivi_layout_surface *ivisurf  = NULL;
+    struct ivi_layout_property_change *change = NULL;
+    struct wl_list list_layer;
+    struct wl_list list_surface;
+    int32_t count = 0;
+
+    wl_list_init(&list_layer);
+    wl_list_insert_list(&list_layer, &layout->notification.list_layer);
+    wl_list_init(&layout->notification.list_layer);
+
+    wl_list_init(&list_surface);
+    wl_list_insert_list(&list_surface, &layout->notification.list_surface);
+    wl_list_init(&layout->notification.list_surface);
+
+    if (!wl_list_empty(&layout->notification.batch.listener_list)) {
+        layout->notification.changes.size = 0;
+
+        wl_list_for_each(ivilayer, &list_layer, notification.link) {
+            change = wl_array_add(&layout->notification.changes,
+                                  sizeof *change);
+            if (change == NULL) {
+                break;
+            }
+            change->ivilayer = ivilayer;
+            change->ivisurf = NULL;
+            change->mask = ivilayer->notification.pending;
+        }
+
+        wl_list_for_each(ivisurf, &list_surface, notification.link) {
+            change = wl_array_add(&layout->notification.changes,
+                                  sizeof *change);
+            if (change == NULL) {
+                break;
+            }
+            change->ivilayer = NULL;
+            change->ivisurf = ivisurf;
+            change->mask = ivisurf->notification.pending;
+        }
+
+        count = layout->notification.changes.size / sizeof *change;
+        if (count > 0) {
+            wl_signal_emit(&layout->notification.batch,
+                           &layout->notification.changes);
+        }
+    }
+
+    /* listeners may commit or remove objects, so the lists are consumed
+     * from the head one by one */
+    while (!wl_list_empty(&list_layer)) {
+        ivilayer = container_of(list_layer.next,
+                                struct ivi_layout_layer, notification.link);
+        wl_list_remove(&ivilayer->notification.link);
+        wl_list_init(&ivilayer->notification.link);
+
+        ivilayer->notification.mask = ivilayer->notification.pending;
+        ivilayer->notification.pending = 0;
+        wl_signal_emit(&ivilayer->property_changed, ivilayer);
+    }
+
+    while (!wl_list_empty(&list_surface)) {
+        ivisurf = container_of(list_surface.next,
+                               struct ivi_layout_surface, notification.link);
+        wl_list_remove(&ivisurf->notification.link);
+        wl_list_init(&ivisurf->notification.link);
+
+        ivisurf->notification.mask = ivisurf->notification.pending;
+        ivisurf->notification.pending = 0;
+        wl_signal_emit(&ivisurf->property_changed, ivisurf);
+    }
 }
 
 static void
-send_layer_prop(struct ivi_layout_layer *ivilayer)
+notification_idle(void *data)
 {
-    wl_signal_emit(&ivilayer->property_changed, ivilayer);
-    ivilayer->event_mask = 0;
+    struct ivi_layout *layout = data;
+
+    layout->notification.idle = NULL;
+
+    flush_notification(layout);
+}
+
+static void
+schedule_notification(struct ivi_layout *layout)
+{
+    struct wl_event_loop *loop;
+
+    if (layout->notification.idle != NULL) {
+        return;
+    }
+
+    loop = wl_display_get_event_loop(layout->compositor->wl_display);
+    layout->notification.idle =
+        wl_event_loop_add_idle(loop, notification_idle, layout);
+    if (layout->notification.idle == NULL) {
+        flush_notification(layout);
+    }
 }
 
 static void
@@ -1042,13 +1799,38 @@ send_prop(struct ivi_layout *layout)
 {
     struct ivi_layout_layer   *ivilayer = NULL;
     struct ivi_layout_surface *ivisurf  = NULL;
+    int32_t changed = 0;
 
     wl_list_for_each_reverse(ivilayer, &layout->list_layer, link) {
-        send_layer_prop(ivilayer);
+        if (ivilayer->event_mask == 0) {
+            continue;
+        }
+
+        ivilayer->notification.pending |= ivilayer->event_mask;
+        ivilayer->event_mask = 0;
+        if (wl_list_empty(&ivilayer->notification.link)) {
+            wl_list_insert(layout->notification.list_layer.prev,
+                           &ivilayer->notification.link);
+        }
+        changed = 1;
     }
 
     wl_list_for_each_reverse(ivisurf, &layout->list_surface, link) {
-        send_surface_prop(ivisurf);
+        if (ivisurf->event_mask == 0) {
+            continue;
+        }
+
+        ivisurf->notification.pending |= ivisurf->event_mask;
+        ivisurf->event_mask = 0;
+        if (wl_list_empty(&ivisurf->notification.link)) {
+            wl_list_insert(layout->notification.list_surface.prev,
+                           &ivisurf->notification.link);
+        }
+        changed = 1;
+    }
+
+    if (changed) {
+        schedule_notification(layout);
     }
 }
 
@@ -1085,6 +1867,7 @@ clear_surface_order_list(struct ivi_layout_layer *ivilayer)
         wl_list_init(&surface_link->order.link);
     }
 
+    ivilayer->layout->order_serial++;
     ivilayer->event_mask |= IVI_NOTIFICATION_REMOVE;
 }
 
@@ -1136,7 +1919,8 @@ layer_prop_changed(struct wl_listener *listener, void *data)
         (struct ivi_layout_notificationCallback *)layout_listener->userdata;
 
     ((layerPropertyNotificationFunc)prop_callback->callback)
-        (ivilayer, &ivilayer->prop, ivilayer->event_mask, prop_callback->data);
+        (ivilayer, &ivilayer->prop, ivilayer->notification.mask,
+         prop_callback->data);
 }
 
 static void
@@ -1187,9 +1971,27 @@ surface_prop_changed(struct wl_listener *listener, void *data)
         (struct ivi_layout_notificationCallback *)layout_listener->userdata;
 
     ((surfacePropertyNotificationFunc)prop_callback->callback)
-        (ivisurf, &ivisurf->prop, ivisurf->event_mask, prop_callback->data);
+        (ivisurf, &ivisurf->prop, ivisurf->notification.mask,
+         prop_callback->data);
+}
 
-    ivisurf->event_mask = 0;
+static void
+property_batch_changed(struct wl_listener *listener, void *data)
+{
+    struct wl_array *changes = data;
+
+    struct listener_layoutNotification *notification =
+        container_of(listener,
+                     struct listener_layoutNotification,
+                     listener);
+
+    struct ivi_layout_notificationCallback *batch_callback =
+        (struct ivi_layout_notificationCallback *)notification->userdata;
+
+    ((propertyBatchNotificationFunc)batch_callback->callback)
+        (changes->data,
+         changes->size / sizeof(struct ivi_layout_property_change),
+         batch_callback->data);
 }
 
 static void
@@ -1478,25 +2280,59 @@ ivi_layout_removeNotificationConfigureSurface(surfaceConfigureNotificationFunc c
 }
 
 WL_EXPORT int32_t
-ivi_layout_addNotificationShellWarning(shellWarningNotificationFunc callback,
-                                       void *userdata)
+ivi_layout_addNotificationPropertyBatch(propertyBatchNotificationFunc callback,
+                                        void *userdata)
 {
     struct ivi_layout *layout = get_instance();
-    struct ivi_layout_notificationCallback *warn_callback = NULL;
+    struct ivi_layout_notificationCallback *batch_callback = NULL;
 
     if (callback == NULL) {
-        weston_log("ivi_layout_addNotificationShellWarning: invalid argument\n");
+        weston_log("ivi_layout_addNotificationPropertyBatch: invalid argument\n");
         return -1;
     }
 
-    warn_callback = malloc(sizeof *warn_callback);
-    if (warn_callback == NULL) {
+    batch_callback = malloc(sizeof *batch_callback);
+    if (batch_callback == NULL) {
         weston_log("fails to allocate memory\n");
         return -1;
     }
 
-    warn_callback->callback = callback;
-    warn_callback->data = userdata;
+    batch_callback->callback = callback;
+    batch_callback->data = userdata;
+
+    return add_notification(&layout->notification.batch,
+                            property_batch_changed,
+                            batch_callback);
+}
+
+WL_EXPORT void
+ivi_layout_removeNotificationPropertyBatch(propertyBatchNotificationFunc callback,
+                                           void *userdata)
+{
+    struct ivi_layout *layout = get_instance();
+    remove_notification(&layout->notification.batch.listener_list, callback, userdata);
+}
+
+WL_EXPORT int32_t
+ivi_layout_addNotificationShellWarning(shellWarningNotificationFunc callback,
+                                       void *userdata)
+{
+    struct ivi_layout *layout = get_instance();
+    struct ivi_layout_notificationCallback *warn_callback = NULL;
+
+    if (callback == NULL) {
+        weston_log("ivi_layout_addNotificationShellWarning: invalid argument\n");
+        return -1;
+    }
+
+    warn_callback = malloc(sizeof *warn_callback);
+    if (warn_callback == NULL) {
+        weston_log("fails to allocate memory\n");
+        return -1;
+    }
+
+    warn_callback->callback = callback;
+    warn_callback->data = userdata;
 
     return add_notification(&layout->warning_signal,
                             warning_occurred,
@@ -1527,30 +2363,16 @@ WL_EXPORT struct ivi_layout_layer *
 ivi_layout_getLayerFromId(uint32_t id_layer)
 {
     struct ivi_layout *layout = get_instance();
-    struct ivi_layout_layer *ivilayer = NULL;
-
-    wl_list_for_each(ivilayer, &layout->list_layer, link) {
-        if (ivilayer->id_layer == id_layer) {
-            return ivilayer;
-        }
-    }
 
-    return NULL;
+    return get_layer(layout, id_layer);
 }
 
 WL_EXPORT struct ivi_layout_surface *
 ivi_layout_getSurfaceFromId(uint32_t id_surface)
 {
     struct ivi_layout *layout = get_instance();
-    struct ivi_layout_surface *ivisurf = NULL;
-
-    wl_list_for_each(ivisurf, &layout->list_surface, link) {
-        if (ivisurf->id_surface == id_surface) {
-            return ivisurf;
-        }
-    }
 
-    return NULL;
+    return get_surface(layout, id_surface);
 }
 
 WL_EXPORT struct ivi_layout_screen *
@@ -1651,18 +2473,30 @@ ivi_layout_surfaceRemove(struct ivi_layout_surface *ivisurf)
     }
     if (!wl_list_empty(&ivisurf->order.link)) {
         wl_list_remove(&ivisurf->order.link);
+        layout->order_serial++;
+    }
+    if (!wl_list_empty(&ivisurf->notification.link)) {
+        wl_list_remove(&ivisurf->notification.link);
     }
     if (!wl_list_empty(&ivisurf->link)) {
         wl_list_remove(&ivisurf->link);
+        layout->surface_count--;
+    }
+    if (get_surface(layout, ivisurf->id_surface) == ivisurf) {
+        id_map_remove(&layout->surface_map, ivisurf->id_surface);
     }
     remove_ordersurface_from_layer(ivisurf);
+    unwatch_surface_commits(ivisurf);
 
     wl_signal_emit(&layout->surface_notification.removed, ivisurf);
 
     ivi_layout_surfaceRemoveNotification(ivisurf);
 
+    pixman_region32_fini(&ivisurf->culling.opaque);
     free(ivisurf);
 
+    ivi_layout_mark_pending();
+
     return 0;
 }
 
@@ -1704,9 +2538,158 @@ WL_EXPORT int32_t
 ivi_layout_getNumberOfHardwareLayers(uint32_t id_screen,
                               int32_t *pNumberOfHardwareLayers)
 {
-    /* TODO */
-    (void)id_screen;
-    (void)pNumberOfHardwareLayers;
+    struct ivi_layout *layout = get_instance();
+    struct ivi_layout_screen *iviscrn = NULL;
+
+    if (pNumberOfHardwareLayers == NULL) {
+        weston_log("ivi_layout_getNumberOfHardwareLayers: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(iviscrn, &layout->list_screen, link) {
+        if (iviscrn->id_screen != id_screen) {
+            continue;
+        }
+
+        if (iviscrn->output == NULL) {
+            break;
+        }
+
+        *pNumberOfHardwareLayers = iviscrn->output->plane_count;
+        return 0;
+    }
+
+    weston_log("ivi_layout_getNumberOfHardwareLayers: no screen %d\n",
+               id_screen);
+    return -1;
+}
+
+WL_EXPORT int32_t
+ivi_layout_getNumberOfCulledViews(int32_t *pNumberOfCulledViews)
+{
+    struct ivi_layout *layout = get_instance();
+
+    if (pNumberOfCulledViews == NULL) {
+        weston_log("ivi_layout_getNumberOfCulledViews: invalid argument\n");
+        return -1;
+    }
+
+    *pNumberOfCulledViews = layout->culling.culled_view_count;
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_getCommitStatistics(struct ivi_layout_commit_statistics *pStatistics)
+{
+    struct ivi_layout *layout = get_instance();
+
+    if (pStatistics == NULL) {
+        weston_log("ivi_layout_getCommitStatistics: invalid argument\n");
+        return -1;
+    }
+
+    *pStatistics = layout->commit.stats;
+
+    return 0;
+}
+
+static int
+compare_latency(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+WL_EXPORT int32_t
+ivi_layout_surfaceGetFrameStatistics(struct ivi_layout_surface *ivisurf,
+                struct ivi_layout_surface_frame_statistics *pStatistics)
+{
+    uint32_t latency[IVI_LAYOUT_FRAME_RECORD_COUNT];
+    const struct ivi_layout_frame_record *record = NULL;
+    uint32_t count = 0;
+    uint32_t first = 0;
+    uint32_t i = 0;
+    uint32_t n = 0;
+    uint64_t damage = 0;
+    uint64_t window = 0;
+
+    if (ivisurf == NULL || pStatistics == NULL) {
+        weston_log("ivi_layout_surfaceGetFrameStatistics: invalid argument\n");
+        return -1;
+    }
+
+    memset(pStatistics, 0, sizeof *pStatistics);
+    count = ivisurf->frame_stats.count;
+    pStatistics->update_count = ivisurf->update_count;
+    pStatistics->commit_count = count;
+    if (count == 0) {
+        return 0;
+    }
+
+    first = count > IVI_LAYOUT_FRAME_RECORD_COUNT ?
+            count - IVI_LAYOUT_FRAME_RECORD_COUNT : 0;
+
+    for (i = first; i != count; i++) {
+        record = &ivisurf->frame_stats.records[i %
+                                               IVI_LAYOUT_FRAME_RECORD_COUNT];
+        damage += record->damage;
+        if (i - first < ivisurf->frame_stats.presented - first &&
+            !record->dropped) {
+            latency[n++] = record->latency;
+        }
+    }
+
+    record = &ivisurf->frame_stats.records[first %
+                                           IVI_LAYOUT_FRAME_RECORD_COUNT];
+    window = frame_stats_now(get_instance()->compositor) -
+             record->commit_time;
+    if (window == 0) {
+        window = 1;
+    }
+
+    pStatistics->window = window > UINT32_MAX ? UINT32_MAX : window;
+    pStatistics->commit_rate = (count - first) * 1000000.0f / window;
+    pStatistics->damage_rate = damage * 1000000.0f / window;
+
+    pStatistics->latency_count = n;
+    if (n > 0) {
+        qsort(latency, n, sizeof latency[0], compare_latency);
+        pStatistics->latency_p50 = latency[n / 2];
+        pStatistics->latency_p90 = latency[n * 90 / 100];
+        pStatistics->latency_p99 = latency[n * 99 / 100];
+        pStatistics->latency_max = latency[n - 1];
+    }
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_setHiddenSurfaceReleaseDelay(uint32_t delay)
+{
+    struct ivi_layout *layout = get_instance();
+
+    layout->hidden.delay = delay;
+
+    /* release what is hidden for longer, and arm the timer for the rest */
+    release_hidden_surfaces(layout);
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_getReleaseStatistics(struct ivi_layout_release_statistics *pStatistics)
+{
+    struct ivi_layout *layout = get_instance();
+
+    if (pStatistics == NULL) {
+        weston_log("ivi_layout_getReleaseStatistics: invalid argument\n");
+        return -1;
+    }
+
+    *pStatistics = layout->hidden.stats;
 
     return 0;
 }
@@ -1724,7 +2707,7 @@ ivi_layout_getScreens(int32_t *pLength, struct ivi_layout_screen ***ppArray)
         return -1;
     }
 
-    length = wl_list_length(&layout->list_screen);
+    length = layout->screen_count;
 
     if (length != 0){
         /* the Array must be free by module which called this function */
@@ -1791,7 +2774,7 @@ ivi_layout_getLayers(int32_t *pLength, struct ivi_layout_layer ***ppArray)
         return -1;
     }
 
-    length = wl_list_length(&layout->list_layer);
+    length = layout->layer_count;
 
     if (length != 0){
         /* the Array must be free by module which called this function */
@@ -1825,7 +2808,7 @@ ivi_layout_getLayersOnScreen(struct ivi_layout_screen *iviscrn,
         return -1;
     }
 
-    length = wl_list_length(&iviscrn->order.list_layer);
+    length = get_layer_count_on_screen(iviscrn);
 
     if (length != 0){
         /* the Array must be free by module which called this function */
@@ -1835,7 +2818,7 @@ ivi_layout_getLayersOnScreen(struct ivi_layout_screen *iviscrn,
             return -1;
         }
 
-        wl_list_for_each(ivilayer, &iviscrn->order.list_layer, link) {
+        wl_list_for_each(ivilayer, &iviscrn->order.list_layer, order.link) {
             (*ppArray)[n++] = ivilayer;
         }
     }
@@ -1892,7 +2875,7 @@ ivi_layout_getSurfaces(int32_t *pLength, struct ivi_layout_surface ***ppArray)
         return -1;
     }
 
-    length = wl_list_length(&layout->list_surface);
+    length = layout->surface_count;
 
     if (length != 0){
         /* the Array must be free by module which called this function */
@@ -1926,7 +2909,7 @@ ivi_layout_getSurfacesOnLayer(struct ivi_layout_layer *ivilayer,
         return -1;
     }
 
-    length = wl_list_length(&ivilayer->order.list_surface);
+    length = get_surface_count_on_layer(ivilayer);
 
     if (length != 0) {
         /* the Array must be free by module which called this function */
@@ -1946,6 +2929,233 @@ ivi_layout_getSurfacesOnLayer(struct ivi_layout_layer *ivilayer,
     return 0;
 }
 
+WL_EXPORT int32_t
+ivi_layout_forEachScreen(screenVisitorFunc visitor, void *userdata)
+{
+    struct ivi_layout *layout = get_instance();
+    struct ivi_layout_screen *iviscrn = NULL;
+
+    if (visitor == NULL) {
+        weston_log("ivi_layout_forEachScreen: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(iviscrn, &layout->list_screen, link) {
+        if (visitor(iviscrn, userdata) != 0) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_forEachLayer(layerVisitorFunc visitor, void *userdata)
+{
+    struct ivi_layout *layout = get_instance();
+    struct ivi_layout_layer *ivilayer = NULL;
+
+    if (visitor == NULL) {
+        weston_log("ivi_layout_forEachLayer: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(ivilayer, &layout->list_layer, link) {
+        if (visitor(ivilayer, userdata) != 0) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_forEachLayerOnScreen(struct ivi_layout_screen *iviscrn,
+                                layerVisitorFunc visitor, void *userdata)
+{
+    struct ivi_layout_layer *ivilayer = NULL;
+
+    if (iviscrn == NULL || visitor == NULL) {
+        weston_log("ivi_layout_forEachLayerOnScreen: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(ivilayer, &iviscrn->order.list_layer, order.link) {
+        if (visitor(ivilayer, userdata) != 0) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_forEachSurface(surfaceVisitorFunc visitor, void *userdata)
+{
+    struct ivi_layout *layout = get_instance();
+    struct ivi_layout_surface *ivisurf = NULL;
+
+    if (visitor == NULL) {
+        weston_log("ivi_layout_forEachSurface: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(ivisurf, &layout->list_surface, link) {
+        if (visitor(ivisurf, userdata) != 0) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_forEachSurfaceOnLayer(struct ivi_layout_layer *ivilayer,
+                                 surfaceVisitorFunc visitor, void *userdata)
+{
+    struct ivi_layout_surface *ivisurf = NULL;
+
+    if (ivilayer == NULL || visitor == NULL) {
+        weston_log("ivi_layout_forEachSurfaceOnLayer: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(ivisurf, &ivilayer->order.list_surface, order.link) {
+        if (visitor(ivisurf, userdata) != 0) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_getScreensSnapshot(struct ivi_layout_screen **pArray,
+                              int32_t capacity, int32_t *pLength)
+{
+    struct ivi_layout *layout = get_instance();
+    struct ivi_layout_screen *iviscrn = NULL;
+    int32_t n = 0;
+
+    if (pLength == NULL || capacity < 0 || (pArray == NULL && capacity > 0)) {
+        weston_log("ivi_layout_getScreensSnapshot: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(iviscrn, &layout->list_screen, link) {
+        if (n >= capacity) {
+            break;
+        }
+        pArray[n++] = iviscrn;
+    }
+
+    *pLength = layout->screen_count;
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_getLayersSnapshot(struct ivi_layout_layer **pArray,
+                             int32_t capacity, int32_t *pLength)
+{
+    struct ivi_layout *layout = get_instance();
+    struct ivi_layout_layer *ivilayer = NULL;
+    int32_t n = 0;
+
+    if (pLength == NULL || capacity < 0 || (pArray == NULL && capacity > 0)) {
+        weston_log("ivi_layout_getLayersSnapshot: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(ivilayer, &layout->list_layer, link) {
+        if (n >= capacity) {
+            break;
+        }
+        pArray[n++] = ivilayer;
+    }
+
+    *pLength = layout->layer_count;
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_getLayersOnScreenSnapshot(struct ivi_layout_screen *iviscrn,
+                                     struct ivi_layout_layer **pArray,
+                                     int32_t capacity, int32_t *pLength)
+{
+    struct ivi_layout_layer *ivilayer = NULL;
+    int32_t n = 0;
+
+    if (iviscrn == NULL || pLength == NULL || capacity < 0 ||
+        (pArray == NULL && capacity > 0)) {
+        weston_log("ivi_layout_getLayersOnScreenSnapshot: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(ivilayer, &iviscrn->order.list_layer, order.link) {
+        if (n >= capacity) {
+            break;
+        }
+        pArray[n++] = ivilayer;
+    }
+
+    *pLength = get_layer_count_on_screen(iviscrn);
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_getSurfacesSnapshot(struct ivi_layout_surface **pArray,
+                               int32_t capacity, int32_t *pLength)
+{
+    struct ivi_layout *layout = get_instance();
+    struct ivi_layout_surface *ivisurf = NULL;
+    int32_t n = 0;
+
+    if (pLength == NULL || capacity < 0 || (pArray == NULL && capacity > 0)) {
+        weston_log("ivi_layout_getSurfacesSnapshot: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(ivisurf, &layout->list_surface, link) {
+        if (n >= capacity) {
+            break;
+        }
+        pArray[n++] = ivisurf;
+    }
+
+    *pLength = layout->surface_count;
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_getSurfacesOnLayerSnapshot(struct ivi_layout_layer *ivilayer,
+                                      struct ivi_layout_surface **pArray,
+                                      int32_t capacity, int32_t *pLength)
+{
+    struct ivi_layout_surface *ivisurf = NULL;
+    int32_t n = 0;
+
+    if (ivilayer == NULL || pLength == NULL || capacity < 0 ||
+        (pArray == NULL && capacity > 0)) {
+        weston_log("ivi_layout_getSurfacesOnLayerSnapshot: invalid argument\n");
+        return -1;
+    }
+
+    wl_list_for_each(ivisurf, &ivilayer->order.list_surface, order.link) {
+        if (n >= capacity) {
+            break;
+        }
+        pArray[n++] = ivisurf;
+    }
+
+    *pLength = get_surface_count_on_layer(ivilayer);
+
+    return 0;
+}
+
 WL_EXPORT struct ivi_layout_layer *
 ivi_layout_layerCreateWithDimension(uint32_t id_layer,
                                        int32_t width, int32_t height)
@@ -1953,7 +3163,7 @@ ivi_layout_layerCreateWithDimension(uint32_t id_layer,
     struct ivi_layout *layout = get_instance();
     struct ivi_layout_layer *ivilayer = NULL;
 
-    ivilayer = get_layer(&layout->list_layer, id_layer);
+    ivilayer = get_layer(layout, id_layer);
     if (ivilayer != NULL) {
         weston_log("id_layer is already created\n");
         return ivilayer;
@@ -1965,8 +3175,15 @@ ivi_layout_layerCreateWithDimension(uint32_t id_layer,
         return NULL;
     }
 
+    if (id_map_insert(&layout->layer_map, id_layer, ivilayer) < 0) {
+        weston_log("fails to allocate memory\n");
+        free(ivilayer);
+        return NULL;
+    }
+
     wl_list_init(&ivilayer->link);
     wl_signal_init(&ivilayer->property_changed);
+    wl_list_init(&ivilayer->notification.link);
     wl_list_init(&ivilayer->list_screen);
     wl_list_init(&ivilayer->link_to_surface);
     ivilayer->layout = layout;
@@ -1974,6 +3191,7 @@ ivi_layout_layerCreateWithDimension(uint32_t id_layer,
 
     init_layerProperties(&ivilayer->prop, width, height);
     ivilayer->event_mask = 0;
+    weston_matrix_init(&ivilayer->transform);
 
     wl_list_init(&ivilayer->pending.list_surface);
     wl_list_init(&ivilayer->pending.link);
@@ -1983,6 +3201,7 @@ ivi_layout_layerCreateWithDimension(uint32_t id_layer,
     wl_list_init(&ivilayer->order.link);
 
     wl_list_insert(&layout->list_layer, &ivilayer->link);
+    layout->layer_count++;
 
     wl_signal_emit(&layout->layer_notification.created, ivilayer);
 
@@ -2009,9 +3228,17 @@ ivi_layout_layerRemove(struct ivi_layout_layer *ivilayer)
     }
     if (!wl_list_empty(&ivilayer->order.link)) {
         wl_list_remove(&ivilayer->order.link);
+        layout->order_serial++;
+    }
+    if (!wl_list_empty(&ivilayer->notification.link)) {
+        wl_list_remove(&ivilayer->notification.link);
     }
     if (!wl_list_empty(&ivilayer->link)) {
         wl_list_remove(&ivilayer->link);
+        layout->layer_count--;
+    }
+    if (get_layer(layout, ivilayer->id_layer) == ivilayer) {
+        id_map_remove(&layout->layer_map, ivilayer->id_layer);
     }
     remove_orderlayer_from_screen(ivilayer);
     remove_link_to_surface(ivilayer);
@@ -2019,6 +3246,8 @@ ivi_layout_layerRemove(struct ivi_layout_layer *ivilayer)
 
     free(ivilayer);
 
+    ivi_layout_mark_pending();
+
     return 0;
 }
 
@@ -2034,33 +3263,64 @@ ivi_layout_layerGetType(struct ivi_layout_layer *ivilayer,
 }
 
 WL_EXPORT int32_t
-ivi_layout_layerSetVisibility(struct ivi_layout_layer *ivilayer,
-                              int32_t newVisibility)
+ivi_layout_layerSetVisibility(struct ivi_layout_layer *ivilayer,
+                              int32_t newVisibility)
+{
+    struct ivi_layout_LayerProperties *prop = NULL;
+
+    if (ivilayer == NULL) {
+        weston_log("ivi_layout_layerSetVisibility: invalid argument\n");
+        return -1;
+    }
+
+    prop = &ivilayer->pending.prop;
+    prop->visibility = newVisibility;
+
+    ivilayer->event_mask |= IVI_NOTIFICATION_VISIBILITY;
+    ivi_layout_mark_pending();
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_layerGetVisibility(struct ivi_layout_layer *ivilayer, int32_t *pVisibility)
+{
+    if (ivilayer == NULL || pVisibility == NULL) {
+        weston_log("ivi_layout_layerGetVisibility: invalid argument\n");
+        return -1;
+    }
+
+    *pVisibility = ivilayer->prop.visibility;
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_layerSetHardwarePlane(struct ivi_layout_layer *ivilayer,
+                                 int32_t pinned)
 {
-    struct ivi_layout_LayerProperties *prop = NULL;
-
     if (ivilayer == NULL) {
-        weston_log("ivi_layout_layerSetVisibility: invalid argument\n");
+        weston_log("ivi_layout_layerSetHardwarePlane: invalid argument\n");
         return -1;
     }
 
-    prop = &ivilayer->pending.prop;
-    prop->visibility = newVisibility;
+    ivilayer->pending.plane_pinned = pinned ? 1 : 0;
 
-    ivilayer->event_mask |= IVI_NOTIFICATION_VISIBILITY;
+    ivi_layout_mark_pending();
 
     return 0;
 }
 
 WL_EXPORT int32_t
-ivi_layout_layerGetVisibility(struct ivi_layout_layer *ivilayer, int32_t *pVisibility)
+ivi_layout_layerGetHardwarePlane(struct ivi_layout_layer *ivilayer,
+                                 int32_t *pPinned)
 {
-    if (ivilayer == NULL || pVisibility == NULL) {
-        weston_log("ivi_layout_layerGetVisibility: invalid argument\n");
+    if (ivilayer == NULL || pPinned == NULL) {
+        weston_log("ivi_layout_layerGetHardwarePlane: invalid argument\n");
         return -1;
     }
 
-    *pVisibility = ivilayer->prop.visibility;
+    *pPinned = ivilayer->plane_pinned;
 
     return 0;
 }
@@ -2080,6 +3340,7 @@ ivi_layout_layerSetOpacity(struct ivi_layout_layer *ivilayer,
     prop->opacity = opacity;
 
     ivilayer->event_mask |= IVI_NOTIFICATION_OPACITY;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2117,6 +3378,7 @@ ivi_layout_layerSetSourceRectangle(struct ivi_layout_layer *ivilayer,
     prop->sourceHeight = height;
 
     ivilayer->event_mask |= IVI_NOTIFICATION_SOURCE_RECT;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2140,6 +3402,7 @@ ivi_layout_layerSetDestinationRectangle(struct ivi_layout_layer *ivilayer,
     prop->destHeight = height;
 
     ivilayer->event_mask |= IVI_NOTIFICATION_DEST_RECT;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2176,6 +3439,7 @@ ivi_layout_layerSetDimension(struct ivi_layout_layer *ivilayer,
     prop->destHeight = pDimension[1];
 
     ivilayer->event_mask |= IVI_NOTIFICATION_DIMENSION;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2209,6 +3473,7 @@ ivi_layout_layerSetPosition(struct ivi_layout_layer *ivilayer, int32_t *pPositio
     prop->destY = pPosition[1];
 
     ivilayer->event_mask |= IVI_NOTIFICATION_POSITION;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2228,6 +3493,7 @@ ivi_layout_layerSetOrientation(struct ivi_layout_layer *ivilayer,
     prop->orientation = orientation;
 
     ivilayer->event_mask |= IVI_NOTIFICATION_ORIENTATION;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2249,9 +3515,25 @@ ivi_layout_layerGetOrientation(struct ivi_layout_layer *ivilayer,
 WL_EXPORT int32_t
 ivi_layout_layerSetChromaKey(struct ivi_layout_layer *ivilayer, int32_t* pColor)
 {
-    /* TODO */
-    (void)ivilayer;
-    (void)pColor;
+    struct ivi_layout_LayerProperties *prop = NULL;
+
+    if (ivilayer == NULL) {
+        weston_log("ivi_layout_layerSetChromaKey: invalid argument\n");
+        return -1;
+    }
+
+    prop = &ivilayer->pending.prop;
+    if (pColor == NULL) {
+        prop->chromaKeyEnabled = 0;
+    } else {
+        prop->chromaKeyEnabled = 1;
+        prop->chromaKeyRed   = pColor[0] & 0xff;
+        prop->chromaKeyGreen = pColor[1] & 0xff;
+        prop->chromaKeyBlue  = pColor[2] & 0xff;
+    }
+
+    ivilayer->event_mask |= IVI_NOTIFICATION_CHROMA_KEY;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2264,7 +3546,6 @@ ivi_layout_layerSetRenderOrder(struct ivi_layout_layer *ivilayer,
     struct ivi_layout *layout = get_instance();
     struct ivi_layout_surface *ivisurf = NULL;
     struct ivi_layout_surface *next = NULL;
-    uint32_t *id_surface = NULL;
     int32_t i = 0;
 
     if (ivilayer == NULL) {
@@ -2281,28 +3562,26 @@ ivi_layout_layerSetRenderOrder(struct ivi_layout_layer *ivilayer,
             wl_list_init(&ivisurf->pending.link);
         }
         ivilayer->event_mask |= IVI_NOTIFICATION_REMOVE;
+        ivi_layout_mark_pending();
         return 0;
     }
 
     for (i = 0; i < number; i++) {
-        id_surface = &pSurface[i]->id_surface;
-
-        wl_list_for_each_safe(ivisurf, next, &layout->list_surface, pending.link) {
-            if (*id_surface != ivisurf->id_surface) {
-                continue;
-            }
+        ivisurf = get_surface(layout, pSurface[i]->id_surface);
+        if (ivisurf == NULL) {
+            continue;
+        }
 
-            if (!wl_list_empty(&ivisurf->pending.link)) {
-                wl_list_remove(&ivisurf->pending.link);
-            }
-            wl_list_init(&ivisurf->pending.link);
-            wl_list_insert(&ivilayer->pending.list_surface,
-                           &ivisurf->pending.link);
-            break;
+        if (!wl_list_empty(&ivisurf->pending.link)) {
+            wl_list_remove(&ivisurf->pending.link);
         }
+        wl_list_init(&ivisurf->pending.link);
+        wl_list_insert(&ivilayer->pending.list_surface,
+                       &ivisurf->pending.link);
     }
 
     ivilayer->event_mask |= IVI_NOTIFICATION_ADD;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2344,6 +3623,7 @@ ivi_layout_surfaceSetVisibility(struct ivi_layout_surface *ivisurf,
     prop->visibility = newVisibility;
 
     ivisurf->event_mask |= IVI_NOTIFICATION_VISIBILITY;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2377,6 +3657,7 @@ ivi_layout_surfaceSetOpacity(struct ivi_layout_surface *ivisurf,
     prop->opacity = opacity;
 
     ivisurf->event_mask |= IVI_NOTIFICATION_OPACITY;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2436,6 +3717,7 @@ ivi_layout_surfaceSetDestinationRectangle(struct ivi_layout_surface *ivisurf,
     prop->destHeight = height;
 
     ivisurf->event_mask |= IVI_NOTIFICATION_DEST_RECT;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2455,6 +3737,7 @@ ivi_layout_surfaceSetDimension(struct ivi_layout_surface *ivisurf, int32_t *pDim
     prop->destHeight = pDimension[1];
 
     ivisurf->event_mask |= IVI_NOTIFICATION_DIMENSION;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2490,6 +3773,7 @@ ivi_layout_surfaceSetPosition(struct ivi_layout_surface *ivisurf,
     prop->destY = pPosition[1];
 
     ivisurf->event_mask |= IVI_NOTIFICATION_POSITION;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2524,6 +3808,7 @@ ivi_layout_surfaceSetOrientation(struct ivi_layout_surface *ivisurf,
     prop->orientation = orientation;
 
     ivisurf->event_mask |= IVI_NOTIFICATION_ORIENTATION;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2555,9 +3840,25 @@ ivi_layout_surfaceGetPixelformat(struct ivi_layout_layer *ivisurf, int32_t *pPix
 WL_EXPORT int32_t
 ivi_layout_surfaceSetChromaKey(struct ivi_layout_surface *ivisurf, int32_t* pColor)
 {
-    /* TODO */
-    (void)ivisurf;
-    (void)pColor;
+    struct ivi_layout_SurfaceProperties *prop = NULL;
+
+    if (ivisurf == NULL) {
+        weston_log("ivi_layout_surfaceSetChromaKey: invalid argument\n");
+        return -1;
+    }
+
+    prop = &ivisurf->pending.prop;
+    if (pColor == NULL) {
+        prop->chromaKeyEnabled = 0;
+    } else {
+        prop->chromaKeyEnabled = 1;
+        prop->chromaKeyRed   = pColor[0] & 0xff;
+        prop->chromaKeyGreen = pColor[1] & 0xff;
+        prop->chromaKeyBlue  = pColor[2] & 0xff;
+    }
+
+    ivisurf->event_mask |= IVI_NOTIFICATION_CHROMA_KEY;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2568,7 +3869,6 @@ ivi_layout_screenAddLayer(struct ivi_layout_screen *iviscrn,
 {
     struct ivi_layout *layout = get_instance();
     struct ivi_layout_layer *ivilayer = NULL;
-    struct ivi_layout_layer *next = NULL;
     int is_layer_in_scrn = 0;
 
     if (iviscrn == NULL || addlayer == NULL) {
@@ -2582,19 +3882,18 @@ ivi_layout_screenAddLayer(struct ivi_layout_screen *iviscrn,
         return 0;
     }
 
-    wl_list_for_each_safe(ivilayer, next, &layout->list_layer, link) {
-        if (ivilayer->id_layer == addlayer->id_layer) {
-            if (!wl_list_empty(&ivilayer->pending.link)) {
-                wl_list_remove(&ivilayer->pending.link);
-            }
-            wl_list_init(&ivilayer->pending.link);
-            wl_list_insert(&iviscrn->pending.list_layer,
-                           &ivilayer->pending.link);
-            break;
+    ivilayer = get_layer(layout, addlayer->id_layer);
+    if (ivilayer != NULL) {
+        if (!wl_list_empty(&ivilayer->pending.link)) {
+            wl_list_remove(&ivilayer->pending.link);
         }
+        wl_list_init(&ivilayer->pending.link);
+        wl_list_insert(&iviscrn->pending.list_layer,
+                       &ivilayer->pending.link);
     }
 
     iviscrn->event_mask |= IVI_NOTIFICATION_ADD;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2607,7 +3906,6 @@ ivi_layout_screenSetRenderOrder(struct ivi_layout_screen *iviscrn,
     struct ivi_layout *layout = get_instance();
     struct ivi_layout_layer *ivilayer = NULL;
     struct ivi_layout_layer *next = NULL;
-    uint32_t *id_layer = NULL;
     int32_t i = 0;
 
     if (iviscrn == NULL) {
@@ -2632,27 +3930,26 @@ ivi_layout_screenSetRenderOrder(struct ivi_layout_screen *iviscrn,
         }
 
         iviscrn->event_mask |= IVI_NOTIFICATION_REMOVE;
+        ivi_layout_mark_pending();
         return 0;
     }
 
     for (i = 0; i < number; i++) {
-        id_layer = &pLayer[i]->id_layer;
-        wl_list_for_each(ivilayer, &layout->list_layer, link) {
-            if (*id_layer != ivilayer->id_layer) {
-                continue;
-            }
+        ivilayer = get_layer(layout, pLayer[i]->id_layer);
+        if (ivilayer == NULL) {
+            continue;
+        }
 
-            if (!wl_list_empty(&ivilayer->pending.link)) {
-                wl_list_remove(&ivilayer->pending.link);
-            }
-            wl_list_init(&ivilayer->pending.link);
-            wl_list_insert(&iviscrn->pending.list_layer,
-                           &ivilayer->pending.link);
-            break;
+        if (!wl_list_empty(&ivilayer->pending.link)) {
+            wl_list_remove(&ivilayer->pending.link);
         }
+        wl_list_init(&ivilayer->pending.link);
+        wl_list_insert(&iviscrn->pending.list_layer,
+                       &ivilayer->pending.link);
     }
 
     iviscrn->event_mask |= IVI_NOTIFICATION_ADD;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2666,9 +3963,19 @@ ivi_layout_screenGetOutput(struct ivi_layout_screen *iviscrn)
 WL_EXPORT int32_t
 ivi_layout_SetOptimizationMode(uint32_t id, int32_t mode)
 {
-    /* TODO */
-    (void)id;
-    (void)mode;
+    struct ivi_layout *layout = get_instance();
+
+    if (id >= IVI_LAYOUT_OPTIMIZATION_MAX ||
+        mode < IVI_LAYOUT_OPTIMIZATION_MODE_FORCE_OFF ||
+        mode > IVI_LAYOUT_OPTIMIZATION_MODE_HEURISTIC) {
+        weston_log("ivi_layout_SetOptimizationMode: invalid argument\n");
+        return -1;
+    }
+
+    layout->optimization_mode[id] = mode;
+    layout->commit.view_list_dirty = 1;
+
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2676,9 +3983,14 @@ ivi_layout_SetOptimizationMode(uint32_t id, int32_t mode)
 WL_EXPORT int32_t
 ivi_layout_GetOptimizationMode(uint32_t id, int32_t *pMode)
 {
-    /* TODO */
-    (void)id;
-    (void)pMode;
+    struct ivi_layout *layout = get_instance();
+
+    if (id >= IVI_LAYOUT_OPTIMIZATION_MAX || pMode == NULL) {
+        weston_log("ivi_layout_GetOptimizationMode: invalid argument\n");
+        return -1;
+    }
+
+    *pMode = layout->optimization_mode[id];
 
     return 0;
 }
@@ -2732,6 +4044,8 @@ ivi_layout_getPropertiesOfSurface(struct ivi_layout_surface *ivisurf,
     }
 
     *pSurfaceProperties = ivisurf->prop;
+    pSurfaceProperties->updateCounter = ivisurf->update_count;
+    pSurfaceProperties->frameCounter = ivisurf->frame_stats.count;
 
     return 0;
 }
@@ -2742,7 +4056,6 @@ ivi_layout_layerAddSurface(struct ivi_layout_layer *ivilayer,
 {
     struct ivi_layout *layout = get_instance();
     struct ivi_layout_surface *ivisurf = NULL;
-    struct ivi_layout_surface *next = NULL;
     int is_surf_in_layer = 0;
 
     if (ivilayer == NULL || addsurf == NULL) {
@@ -2756,19 +4069,18 @@ ivi_layout_layerAddSurface(struct ivi_layout_layer *ivilayer,
         return 0;
     }
 
-    wl_list_for_each_safe(ivisurf, next, &layout->list_surface, link) {
-        if (ivisurf->id_surface == addsurf->id_surface) {
-            if (!wl_list_empty(&ivisurf->pending.link)) {
-                wl_list_remove(&ivisurf->pending.link);
-            }
-            wl_list_init(&ivisurf->pending.link);
-            wl_list_insert(&ivilayer->pending.list_surface,
-                           &ivisurf->pending.link);
-            break;
+    ivisurf = get_surface(layout, addsurf->id_surface);
+    if (ivisurf != NULL) {
+        if (!wl_list_empty(&ivisurf->pending.link)) {
+            wl_list_remove(&ivisurf->pending.link);
         }
+        wl_list_init(&ivisurf->pending.link);
+        wl_list_insert(&ivilayer->pending.list_surface,
+                       &ivisurf->pending.link);
     }
 
     ivilayer->event_mask |= IVI_NOTIFICATION_ADD;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2797,6 +4109,7 @@ ivi_layout_layerRemoveSurface(struct ivi_layout_layer *ivilayer,
     }
 
     remsurf->event_mask |= IVI_NOTIFICATION_REMOVE;
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2820,6 +4133,224 @@ ivi_layout_surfaceSetSourceRectangle(struct ivi_layout_surface *ivisurf,
     prop->sourceHeight = height;
 
     ivisurf->event_mask |= IVI_NOTIFICATION_SOURCE_RECT;
+    ivi_layout_mark_pending();
+
+    return 0;
+}
+
+/*
+ * Properties which ivi_layout_surfaceSetProperties and
+ * ivi_layout_layerSetProperties can set, as notification mask.
+ */
+#define IVI_LAYOUT_SETTABLE_PROPERTIES (IVI_NOTIFICATION_OPACITY     | \
+                                        IVI_NOTIFICATION_SOURCE_RECT | \
+                                        IVI_NOTIFICATION_DEST_RECT   | \
+                                        IVI_NOTIFICATION_DIMENSION   | \
+                                        IVI_NOTIFICATION_POSITION    | \
+                                        IVI_NOTIFICATION_ORIENTATION | \
+                                        IVI_NOTIFICATION_VISIBILITY)
+
+/**
+ * Same as calling the setter of each property in mask, in the order of
+ * bits of enum ivi_layout_notification_mask.
+ */
+static void
+surface_set_properties(struct ivi_layout_surface *ivisurf,
+                       const struct ivi_layout_SurfaceProperties *src,
+                       uint32_t mask)
+{
+    struct ivi_layout_SurfaceProperties *prop = &ivisurf->pending.prop;
+
+    if (mask & IVI_NOTIFICATION_OPACITY) {
+        prop->opacity = src->opacity;
+    }
+
+    if (mask & IVI_NOTIFICATION_SOURCE_RECT) {
+        prop->sourceX = src->sourceX;
+        prop->sourceY = src->sourceY;
+        prop->sourceWidth = src->sourceWidth;
+        prop->sourceHeight = src->sourceHeight;
+    }
+
+    if (mask & IVI_NOTIFICATION_DEST_RECT) {
+        prop->startX = prop->destX;
+        prop->startY = prop->destY;
+        prop->destX = src->destX;
+        prop->destY = src->destY;
+        prop->startWidth = prop->destWidth;
+        prop->startHeight = prop->destHeight;
+        prop->destWidth = src->destWidth;
+        prop->destHeight = src->destHeight;
+    }
+
+    if (mask & IVI_NOTIFICATION_DIMENSION) {
+        prop->destWidth = src->destWidth;
+        prop->destHeight = src->destHeight;
+    }
+
+    if (mask & IVI_NOTIFICATION_POSITION) {
+        prop->destX = src->destX;
+        prop->destY = src->destY;
+    }
+
+    if (mask & IVI_NOTIFICATION_ORIENTATION) {
+        prop->orientation = src->orientation;
+    }
+
+    if (mask & IVI_NOTIFICATION_VISIBILITY) {
+        prop->visibility = src->visibility;
+    }
+
+    ivisurf->event_mask |= mask;
+}
+
+static void
+layer_set_properties(struct ivi_layout_layer *ivilayer,
+                     const struct ivi_layout_LayerProperties *src,
+                     uint32_t mask)
+{
+    struct ivi_layout_LayerProperties *prop = &ivilayer->pending.prop;
+
+    if (mask & IVI_NOTIFICATION_OPACITY) {
+        prop->opacity = src->opacity;
+    }
+
+    if (mask & IVI_NOTIFICATION_SOURCE_RECT) {
+        prop->sourceX = src->sourceX;
+        prop->sourceY = src->sourceY;
+        prop->sourceWidth = src->sourceWidth;
+        prop->sourceHeight = src->sourceHeight;
+    }
+
+    if (mask & (IVI_NOTIFICATION_DEST_RECT | IVI_NOTIFICATION_DIMENSION)) {
+        prop->destWidth = src->destWidth;
+        prop->destHeight = src->destHeight;
+    }
+
+    if (mask & (IVI_NOTIFICATION_DEST_RECT | IVI_NOTIFICATION_POSITION)) {
+        prop->destX = src->destX;
+        prop->destY = src->destY;
+    }
+
+    if (mask & IVI_NOTIFICATION_ORIENTATION) {
+        prop->orientation = src->orientation;
+    }
+
+    if (mask & IVI_NOTIFICATION_VISIBILITY) {
+        prop->visibility = src->visibility;
+    }
+
+    ivilayer->event_mask |= mask;
+}
+
+WL_EXPORT int32_t
+ivi_layout_surfaceSetProperties(struct ivi_layout_surface *ivisurf,
+                        const struct ivi_layout_SurfaceProperties *pProperties,
+                        uint32_t mask)
+{
+    if (ivisurf == NULL || pProperties == NULL ||
+        (mask & ~IVI_LAYOUT_SETTABLE_PROPERTIES) != 0) {
+        weston_log("ivi_layout_surfaceSetProperties: invalid argument\n");
+        return -1;
+    }
+
+    if (mask == 0) {
+        return 0;
+    }
+
+    surface_set_properties(ivisurf, pProperties, mask);
+    ivi_layout_mark_pending();
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_surfaceSetPropertiesArray(struct ivi_layout_surface **ppSurface,
+                        const struct ivi_layout_SurfaceProperties *pProperties,
+                        int32_t length,
+                        uint32_t mask)
+{
+    int32_t i = 0;
+
+    if (length < 0 || (length > 0 && (ppSurface == NULL ||
+                                      pProperties == NULL)) ||
+        (mask & ~IVI_LAYOUT_SETTABLE_PROPERTIES) != 0) {
+        weston_log("ivi_layout_surfaceSetPropertiesArray: invalid argument\n");
+        return -1;
+    }
+
+    /* nothing is set unless all surfaces are valid */
+    for (i = 0; i < length; i++) {
+        if (ppSurface[i] == NULL) {
+            weston_log("ivi_layout_surfaceSetPropertiesArray: invalid argument\n");
+            return -1;
+        }
+    }
+
+    if (length == 0 || mask == 0) {
+        return 0;
+    }
+
+    for (i = 0; i < length; i++) {
+        surface_set_properties(ppSurface[i], &pProperties[i], mask);
+    }
+    ivi_layout_mark_pending();
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_layerSetProperties(struct ivi_layout_layer *ivilayer,
+                        const struct ivi_layout_LayerProperties *pProperties,
+                        uint32_t mask)
+{
+    if (ivilayer == NULL || pProperties == NULL ||
+        (mask & ~IVI_LAYOUT_SETTABLE_PROPERTIES) != 0) {
+        weston_log("ivi_layout_layerSetProperties: invalid argument\n");
+        return -1;
+    }
+
+    if (mask == 0) {
+        return 0;
+    }
+
+    layer_set_properties(ivilayer, pProperties, mask);
+    ivi_layout_mark_pending();
+
+    return 0;
+}
+
+WL_EXPORT int32_t
+ivi_layout_layerSetPropertiesArray(struct ivi_layout_layer **ppLayer,
+                        const struct ivi_layout_LayerProperties *pProperties,
+                        int32_t length,
+                        uint32_t mask)
+{
+    int32_t i = 0;
+
+    if (length < 0 || (length > 0 && (ppLayer == NULL ||
+                                      pProperties == NULL)) ||
+        (mask & ~IVI_LAYOUT_SETTABLE_PROPERTIES) != 0) {
+        weston_log("ivi_layout_layerSetPropertiesArray: invalid argument\n");
+        return -1;
+    }
+
+    /* nothing is set unless all layers are valid */
+    for (i = 0; i < length; i++) {
+        if (ppLayer[i] == NULL) {
+            weston_log("ivi_layout_layerSetPropertiesArray: invalid argument\n");
+            return -1;
+        }
+    }
+
+    if (length == 0 || mask == 0) {
+        return 0;
+    }
+
+    for (i = 0; i < length; i++) {
+        layer_set_properties(ppLayer[i], &pProperties[i], mask);
+    }
+    ivi_layout_mark_pending();
 
     return 0;
 }
@@ -2829,6 +4360,13 @@ ivi_layout_commitChanges(void)
 {
     struct ivi_layout *layout = get_instance();
 
+    if (layout->commit.generation == layout->commit.committed_generation) {
+        layout->commit.stats.skipped++;
+        return 0;
+    }
+    layout->commit.committed_generation = layout->commit.generation;
+    layout->commit.stats.executed++;
+
     commit_list_surface(layout);
     commit_list_layer(layout);
     commit_list_screen(layout);
@@ -2836,8 +4374,16 @@ ivi_layout_commitChanges(void)
     commit_transition(layout);
 
     commit_changes(layout);
+
+    if (layout->commit.view_list_dirty ||
+        layout->commit.order_serial != layout->order_serial) {
+        build_view_lists(layout);
+        layout->commit.stats.view_list_rebuilt++;
+    } else {
+        layout->commit.stats.view_list_kept++;
+    }
+
     send_prop(layout);
-    weston_compositor_schedule_repaint(layout->compositor);
 
     return 0;
 }
@@ -2857,6 +4403,76 @@ ivi_layout_get_weston_view(struct ivi_layout_surface *surface)
     return tmpview;
 }
 
+static void
+check_occluders(void *data)
+{
+    struct ivi_layout *layout = data;
+    struct ivi_layout_surface *ivisurf = NULL;
+
+    layout->culling.idle = NULL;
+
+    /* views below may be uncovered without any commit of layout */
+    wl_list_for_each(ivisurf, &layout->list_surface, link) {
+        if (!ivisurf->culling.occluding || ivisurf->surface == NULL)
+            continue;
+
+        if (!pixman_region32_equal(&ivisurf->culling.opaque,
+                                   &ivisurf->surface->opaque)) {
+            build_view_lists(layout);
+            return;
+        }
+    }
+}
+
+/**
+ * Views follow a moved output at once, without a commit of layout, which
+ * would apply pending properties too. Outputs are also moved when another
+ * one is destroyed.
+ */
+static void
+output_moved(struct wl_listener *listener, void *data)
+{
+    struct ivi_layout *layout =
+        container_of(listener, struct ivi_layout, output_moved_listener);
+    struct weston_output *output = data;
+    struct ivi_layout_screen  *iviscrn  = NULL;
+    struct ivi_layout_layer   *ivilayer = NULL;
+    struct ivi_layout_surface *ivisurf  = NULL;
+    struct weston_view *view = NULL;
+    int32_t moved = 0;
+
+    wl_list_for_each(iviscrn, &layout->list_screen, link) {
+        if (iviscrn->output != output ||
+            !update_screen_geometry(iviscrn)) {
+            continue;
+        }
+
+        wl_list_for_each(ivilayer, &iviscrn->order.list_layer, order.link) {
+            update_layer_transform(ivilayer, output);
+
+            wl_list_for_each(ivisurf, &ivilayer->order.list_surface,
+                             order.link) {
+                view = get_weston_view(ivisurf);
+                if (view == NULL || wl_list_empty(&ivisurf->transform.link)) {
+                    continue;
+                }
+
+                weston_view_damage_below(view);
+                update_transform(ivilayer, ivisurf, view);
+                weston_view_geometry_dirty(view);
+                weston_view_update_transform(view);
+                weston_surface_damage(ivisurf->surface);
+            }
+        }
+        moved = 1;
+    }
+
+    /* culling depends on the region of output */
+    if (moved) {
+        build_view_lists(layout);
+    }
+}
+
 static void
 ivi_layout_surfaceConfigure(struct ivi_layout_surface *ivisurf,
                                int32_t width, int32_t height)
@@ -2865,6 +4481,22 @@ ivi_layout_surfaceConfigure(struct ivi_layout_surface *ivisurf,
 
     ivisurf->surface->width_from_buffer  = width;
     ivisurf->surface->height_from_buffer = height;
+    ivisurf->dirty |= IVI_LAYOUT_DIRTY_SCALE;
+
+    /* the crop stays in the pending viewport of the surface, so it is
+     * clipped to the new buffer now rather than at the next commit */
+    update_source_viewport(ivisurf);
+
+    ivi_layout_mark_pending();
+
+    /* opaque region is applied after configure in the commit of
+     * weston_surface, so occluders are checked once it is done */
+    if (ivisurf->culling.occluding && layout->culling.idle == NULL) {
+        layout->culling.idle =
+            wl_event_loop_add_idle(
+                wl_display_get_event_loop(layout->compositor->wl_display),
+                check_occluders, layout);
+    }
 
     wl_signal_emit(&layout->surface_notification.configure_changed, ivisurf);
 }
@@ -2878,7 +4510,7 @@ ivi_layout_surfaceSetNativeContent(struct weston_surface *surface,
     struct ivi_layout *layout = get_instance();
     struct ivi_layout_surface *ivisurf;
 
-    ivisurf = get_surface(&layout->list_surface, id_surface);
+    ivisurf = get_surface(layout, id_surface);
     if (ivisurf == NULL) {
         weston_log("layout surface is not found\n");
         return -1;
@@ -2892,19 +4524,12 @@ ivi_layout_surfaceSetNativeContent(struct weston_surface *surface,
         }
 
         wl_list_remove(&ivisurf->surface_destroy_listener.link);
+        unwatch_surface_commits(ivisurf);
 
         ivisurf->surface = NULL;
 
-        wl_list_remove(&ivisurf->surface_rotation.link);
-        wl_list_remove(&ivisurf->layer_rotation.link);
-        wl_list_remove(&ivisurf->surface_pos.link);
-        wl_list_remove(&ivisurf->layer_pos.link);
-        wl_list_remove(&ivisurf->scaling.link);
-        wl_list_init(&ivisurf->surface_rotation.link);
-        wl_list_init(&ivisurf->layer_rotation.link);
-        wl_list_init(&ivisurf->surface_pos.link);
-        wl_list_init(&ivisurf->layer_pos.link);
-        wl_list_init(&ivisurf->scaling.link);
+        wl_list_remove(&ivisurf->transform.link);
+        wl_list_init(&ivisurf->transform.link);
 
     }
 
@@ -2923,6 +4548,7 @@ ivi_layout_surfaceSetNativeContent(struct weston_surface *surface,
         westonsurface_destroy_from_ivisurface;
     wl_resource_add_destroy_listener(surface->resource,
                                      &ivisurf->surface_destroy_listener);
+    watch_surface_commits(ivisurf);
 
     struct weston_view *tmpview = weston_view_create(surface);
     if (tmpview == NULL) {
@@ -2934,6 +4560,9 @@ ivi_layout_surfaceSetNativeContent(struct weston_surface *surface,
     ivisurf->surface->height_from_buffer = height;
     ivisurf->pixelformat = IVI_LAYOUT_SURFACE_PIXELFORMAT_RGBA_8888;
 
+    layout->commit.view_list_dirty = 1;
+    ivi_layout_mark_pending();
+
     wl_signal_emit(&layout->surface_notification.created, ivisurf);
 
     if (ivisurf->content_observer.callback) {
@@ -2970,7 +4599,7 @@ ivi_layout_surfaceCreate(struct weston_surface *wl_surface,
         return NULL;
     }
 
-    ivisurf = get_surface(&layout->list_surface, id_surface);
+    ivisurf = get_surface(layout, id_surface);
     if (ivisurf != NULL) {
         if (ivisurf->surface != NULL) {
             weston_log("id_surface(%d) is already created\n", id_surface);
@@ -2993,8 +4622,16 @@ ivi_layout_surfaceCreate(struct weston_surface *wl_surface,
         return NULL;
     }
 
+    if (id_map_insert(&layout->surface_map, id_surface, ivisurf) < 0) {
+        weston_log("fails to allocate memory\n");
+        free(ivisurf);
+        return NULL;
+    }
+
     wl_list_init(&ivisurf->link);
     wl_signal_init(&ivisurf->property_changed);
+    wl_list_init(&ivisurf->notification.link);
+    pixman_region32_init(&ivisurf->culling.opaque);
     wl_list_init(&ivisurf->list_layer);
     ivisurf->id_surface = id_surface;
     ivisurf->layout = layout;
@@ -3004,6 +4641,7 @@ ivi_layout_surfaceCreate(struct weston_surface *wl_surface,
         westonsurface_destroy_from_ivisurface;
     wl_resource_add_destroy_listener(wl_surface->resource,
                                      &ivisurf->surface_destroy_listener);
+    watch_surface_commits(ivisurf);
 
     struct weston_view *tmpview = weston_view_create(wl_surface);
     if (tmpview == NULL) {
@@ -3013,17 +4651,12 @@ ivi_layout_surfaceCreate(struct weston_surface *wl_surface,
     ivisurf->surface->width_from_buffer  = 0;
     ivisurf->surface->height_from_buffer = 0;
 
-    weston_matrix_init(&ivisurf->surface_rotation.matrix);
-    weston_matrix_init(&ivisurf->layer_rotation.matrix);
-    weston_matrix_init(&ivisurf->surface_pos.matrix);
-    weston_matrix_init(&ivisurf->layer_pos.matrix);
-    weston_matrix_init(&ivisurf->scaling.matrix);
+    weston_matrix_init(&ivisurf->surface_rotation);
+    weston_matrix_init(&ivisurf->surface_pos);
+    weston_matrix_init(&ivisurf->scaling);
 
-    wl_list_init(&ivisurf->surface_rotation.link);
-    wl_list_init(&ivisurf->layer_rotation.link);
-    wl_list_init(&ivisurf->surface_pos.link);
-    wl_list_init(&ivisurf->layer_pos.link);
-    wl_list_init(&ivisurf->scaling.link);
+    weston_matrix_init(&ivisurf->transform.matrix);
+    wl_list_init(&ivisurf->transform.link);
 
     init_surfaceProperties(&ivisurf->prop);
     ivisurf->pixelformat = IVI_LAYOUT_SURFACE_PIXELFORMAT_RGBA_8888;
@@ -3036,12 +4669,37 @@ ivi_layout_surfaceCreate(struct weston_surface *wl_surface,
     wl_list_init(&ivisurf->order.list_layer);
 
     wl_list_insert(&layout->list_surface, &ivisurf->link);
+    layout->surface_count++;
 
     wl_signal_emit(&layout->surface_notification.created, ivisurf);
 
     return ivisurf;
 }
 
+static void
+frame_stats_debug_binding(struct weston_seat *seat, uint32_t time,
+                          uint32_t key, void *data)
+{
+    struct ivi_layout *layout = data;
+    struct ivi_layout_surface *ivisurf = NULL;
+    struct ivi_layout_surface_frame_statistics stats;
+
+    weston_log("ivi-layout: frame statistics of %d surfaces\n",
+               layout->surface_count);
+
+    wl_list_for_each(ivisurf, &layout->list_surface, link) {
+        ivi_layout_surfaceGetFrameStatistics(ivisurf, &stats);
+        weston_log_continue(STAMP_SPACE "surface %u: %.1f commits/s, "
+                            "%.0f pixels/s, latency usec p50 %u p90 %u "
+                            "p99 %u max %u, %u commits, %u updates\n",
+                            ivisurf->id_surface,
+                            stats.commit_rate, stats.damage_rate,
+                            stats.latency_p50, stats.latency_p90,
+                            stats.latency_p99, stats.latency_max,
+                            stats.commit_count, stats.update_count);
+    }
+}
+
 static void
 ivi_layout_initWithCompositor(struct weston_compositor *ec)
 {
@@ -3052,6 +4710,13 @@ ivi_layout_initWithCompositor(struct weston_compositor *ec)
     wl_list_init(&layout->list_surface);
     wl_list_init(&layout->list_layer);
     wl_list_init(&layout->list_screen);
+    layout->surface_count = 0;
+    layout->layer_count = 0;
+    layout->screen_count = 0;
+    layout->order_serial = 1;
+
+    id_map_init(&layout->surface_map);
+    id_map_init(&layout->layer_map);
 
     wl_signal_init(&layout->layer_notification.created);
     wl_signal_init(&layout->layer_notification.removed);
@@ -3062,11 +4727,20 @@ ivi_layout_initWithCompositor(struct weston_compositor *ec)
 
     wl_signal_init(&layout->warning_signal);
 
-    /* Add layout_layer at the last of weston_compositor.layer_list */
-    weston_layer_init(&layout->layout_layer, ec->layer_list.prev);
+    layout->optimization_mode[IVI_LAYOUT_OPTIMIZATION_HARDWARE_PLANE] =
+        IVI_LAYOUT_OPTIMIZATION_MODE_HEURISTIC;
+
+    wl_list_init(&layout->notification.list_layer);
+    wl_list_init(&layout->notification.list_surface);
+    layout->notification.idle = NULL;
+    wl_signal_init(&layout->notification.batch);
+    wl_array_init(&layout->notification.changes);
 
     create_screen(ec);
 
+    layout->output_moved_listener.notify = output_moved;
+    wl_signal_add(&ec->output_moved_signal, &layout->output_moved_listener);
+
     struct weston_config *config = weston_config_parse("weston.ini");
     struct weston_config_section *s =
             weston_config_get_section(config, "ivi-shell", NULL, NULL);
@@ -3078,11 +4752,24 @@ ivi_layout_initWithCompositor(struct weston_compositor *ec)
         free(cursor_theme);
     else
         wl_list_remove(&ec->cursor_layer.link);
+
+    weston_config_section_get_uint(s, "hidden-surface-release-delay",
+                                   &layout->hidden.delay, 0);
     weston_config_destroy(config);
 
+    /* surfaces start with serial 0, so they are hidden until a build */
+    layout->hidden.serial = 1;
+
+    layout->hidden.timer =
+        wl_event_loop_add_timer(wl_display_get_event_loop(ec->wl_display),
+                                release_hidden_surfaces, layout);
+
     layout->transitions = ivi_layout_transition_set_create(ec);
     wl_list_init(&layout->pending_transition_list);
 
+    weston_compositor_add_debug_binding(ec, KEY_I,
+                                        frame_stats_debug_binding, layout);
+
 }
 
 
@@ -65,6 +65,7 @@ struct ivi_shell_surface
 struct ivi_shell_setting
 {
     char *ivi_module;
+    char *ivi_layout;
 };
 
 static struct ivi_layout_interface *ivi_layout;
@@ -111,10 +112,13 @@ ivi_shell_surface_configure(struct weston_surface *surface,
         return;
     }
 
-    if (ivisurf->width != surface->width || ivisurf->height != surface->height) {
+    /* the size of surface is the size of its source rectangle, when
+     * ivi-layout crops the buffer, so the buffer size is compared */
+    if (ivisurf->width  != surface->width_from_buffer ||
+        ivisurf->height != surface->height_from_buffer) {
 
-        ivisurf->width  = surface->width;
-        ivisurf->height = surface->height;
+        ivisurf->width  = surface->width_from_buffer;
+        ivisurf->height = surface->height_from_buffer;
 
         weston_view_to_global_float(view, 0, 0, &from_x, &from_y);
         weston_view_to_global_float(view, sx, sy, &to_x, &to_y);
@@ -124,7 +128,9 @@ ivi_shell_surface_configure(struct weston_surface *surface,
                   view->geometry.y + to_y - from_y);
         weston_view_update_transform(view);
 
-        ivi_layout->surfaceConfigure(ivisurf->layout_surface, surface->width, surface->height);
+        ivi_layout->surfaceConfigure(ivisurf->layout_surface,
+                                     surface->width_from_buffer,
+                                     surface->height_from_buffer);
     }
 }
 
@@ -147,17 +153,9 @@ static const struct ivi_surface_interface surface_implementation = {
 };
 
 static struct ivi_shell_surface *
-is_surf_in_surfaces(struct wl_list *list_surf, uint32_t id_surface)
+is_surf_in_surfaces(struct ivi_shell *shell, uint32_t id_surface)
 {
-    struct ivi_shell_surface *ivisurf;
-
-    wl_list_for_each(ivisurf, list_surf, link) {
-        if (ivisurf->id_surface == id_surface) {
-            return ivisurf;
-        }
-    }
-
-    return NULL;
+    return id_map_lookup(&shell->ivi_surface_map, id_surface);
 }
 
 static const struct {
@@ -224,7 +222,7 @@ application_surface_create(struct wl_client *client,
         return;
     }
 
-    ivisurf = is_surf_in_surfaces(&shell->ivi_surface_list, id_surface);
+    ivisurf = is_surf_in_surfaces(shell, id_surface);
     if (ivisurf == NULL) {
         ivisurf = zalloc(sizeof *ivisurf);
         if (ivisurf == NULL) {
@@ -232,6 +230,12 @@ application_surface_create(struct wl_client *client,
             return;
         }
 
+        if (id_map_insert(&shell->ivi_surface_map, id_surface, ivisurf) < 0) {
+            free(ivisurf);
+            wl_resource_post_no_memory(res);
+            return;
+        }
+
         wl_list_init(&ivisurf->link);
         wl_list_insert(&shell->ivi_surface_list, &ivisurf->link);
 
@@ -308,6 +312,7 @@ shell_destroy(struct wl_listener *listener, void *data)
         wl_list_remove(&ivisurf->link);
         free(ivisurf);
     }
+    id_map_release(&shell->ivi_surface_map);
 
     free(shell);
 }
@@ -318,6 +323,7 @@ init_ivi_shell(struct weston_compositor *compositor, struct ivi_shell *shell)
     shell->compositor = compositor;
 
     wl_list_init(&shell->ivi_surface_list);
+    id_map_init(&shell->ivi_surface_map);
 
     weston_layer_init(&shell->panel_layer, &compositor->cursor_layer.link);
     weston_layer_init(&shell->input_panel_layer, NULL);
@@ -343,6 +349,10 @@ ivi_shell_setting_create(struct ivi_shell_setting *dest)
         result = -1;
     }
 
+    /* Optional path of ivi-layout, e.g. to run from the build tree. */
+    weston_config_section_get_string(
+        section, "ivi-layout", (char **)&dest->ivi_layout, NULL);
+
     weston_config_destroy(config);
     return result;
 }
@@ -411,7 +421,14 @@ module_init(struct weston_compositor *compositor,
 
     /*load module:ivi-layout*/
     /*ivi_layout_interface is referred by ivi-shell to use ivi-layout*/
-    snprintf(ivi_layout_path, sizeof ivi_layout_path, "%s/%s", MODULEDIR, "ivi-layout.so");
+    if (setting.ivi_layout != NULL) {
+        snprintf(ivi_layout_path, sizeof ivi_layout_path, "%s",
+                 setting.ivi_layout);
+    } else {
+        snprintf(ivi_layout_path, sizeof ivi_layout_path, "%s/%s",
+                 MODULEDIR, "ivi-layout.so");
+    }
+    free(setting.ivi_layout);
     module = dlopen(ivi_layout_path, RTLD_NOW | RTLD_NOLOAD);
     if (module) {
 	weston_log("ivi-shell: Module '%s' already loaded\n", ivi_layout_path);
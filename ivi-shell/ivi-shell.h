@@ -23,6 +23,7 @@
 #include <stdbool.h>
 
 #include "compositor.h"
+#include "id-map.h"
 
 struct ivi_shell
 {
@@ -32,6 +33,7 @@ struct ivi_shell
     struct weston_compositor *compositor;
 
     struct wl_list ivi_surface_list; /* struct ivi_shell_surface::link */
+    struct id_map ivi_surface_map;   /* id_surface -> ivi_shell_surface */
 
     struct wl_listener show_input_panel_listener;
     struct wl_listener hide_input_panel_listener;
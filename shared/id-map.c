@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#ifdef IN_WESTON
+#include <wayland-server.h>
+#else
+#define WL_EXPORT
+#endif
+
+#include "id-map.h"
+
+#define ID_MAP_MIN_SIZE 16
+
+static inline uint32_t
+id_map_hash(uint32_t id)
+{
+	/* Fibonacci hashing spreads sequential ids over the table */
+	return id * 2654435761u;
+}
+
+static int
+id_map_resize(struct id_map *map, uint32_t size)
+{
+	struct id_map_entry *old = map->entries;
+	uint32_t old_size = map->size;
+	uint32_t i, slot;
+
+	map->entries = calloc(size, sizeof *map->entries);
+	if (map->entries == NULL) {
+		map->entries = old;
+		return -1;
+	}
+	map->size = size;
+
+	for (i = 0; i < old_size; i++) {
+		if (old[i].data == NULL)
+			continue;
+
+		slot = id_map_hash(old[i].id) & (size - 1);
+		while (map->entries[slot].data != NULL)
+			slot = (slot + 1) & (size - 1);
+		map->entries[slot] = old[i];
+	}
+
+	free(old);
+
+	return 0;
+}
+
+WL_EXPORT void
+id_map_init(struct id_map *map)
+{
+	map->entries = NULL;
+	map->size = 0;
+	map->count = 0;
+}
+
+WL_EXPORT void
+id_map_release(struct id_map *map)
+{
+	free(map->entries);
+	id_map_init(map);
+}
+
+/* Returns 0 on success, -1 if the id is already present or on allocation
+ * failure. */
+WL_EXPORT int
+id_map_insert(struct id_map *map, uint32_t id, void *data)
+{
+	uint32_t slot;
+
+	if (data == NULL)
+		return -1;
+
+	/* keep the load factor below 3/4 */
+	if ((map->count + 1) * 4 > map->size * 3) {
+		if (id_map_resize(map, map->size ? map->size * 2 :
+					    ID_MAP_MIN_SIZE) < 0)
+			return -1;
+	}
+
+	slot = id_map_hash(id) & (map->size - 1);
+	while (map->entries[slot].data != NULL) {
+		if (map->entries[slot].id == id)
+			return -1;
+		slot = (slot + 1) & (map->size - 1);
+	}
+
+	map->entries[slot].id = id;
+	map->entries[slot].data = data;
+	map->count++;
+
+	return 0;
+}
+
+WL_EXPORT void *
+id_map_lookup(const struct id_map *map, uint32_t id)
+{
+	uint32_t slot;
+
+	if (map->count == 0)
+		return NULL;
+
+	slot = id_map_hash(id) & (map->size - 1);
+	while (map->entries[slot].data != NULL) {
+		if (map->entries[slot].id == id)
+			return map->entries[slot].data;
+		slot = (slot + 1) & (map->size - 1);
+	}
+
+	return NULL;
+}
+
+/* Returns the data which was stored for the id, or NULL. */
+WL_EXPORT void *
+id_map_remove(struct id_map *map, uint32_t id)
+{
+	uint32_t mask = map->size - 1;
+	uint32_t slot, next, home;
+	void *data;
+
+	if (map->count == 0)
+		return NULL;
+
+	slot = id_map_hash(id) & mask;
+	while (map->entries[slot].id != id) {
+		if (map->entries[slot].data == NULL)
+			return NULL;
+		slot = (slot + 1) & mask;
+	}
+
+	data = map->entries[slot].data;
+	if (data == NULL)
+		return NULL;
+
+	/* Shift back entries of the probe sequence so lookups still find
+	 * them without tombstones. */
+	next = (slot + 1) & mask;
+	while (map->entries[next].data != NULL) {
+		home = id_map_hash(map->entries[next].id) & mask;
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			map->entries[slot] = map->entries[next];
+			slot = next;
+		}
+		next = (next + 1) & mask;
+	}
+
+	map->entries[slot].id = 0;
+	map->entries[slot].data = NULL;
+	map->count--;
+
+	return data;
+}
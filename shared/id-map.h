@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef WESTON_ID_MAP_H
+#define WESTON_ID_MAP_H
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Open-addressing hash table mapping a 32-bit id to a pointer.
+ * Linear probing is used, and removal shifts the following entries back
+ * so that no tombstones are needed. NULL is not a valid value.
+ */
+
+struct id_map_entry {
+	uint32_t id;
+	void *data;
+};
+
+struct id_map {
+	struct id_map_entry *entries;
+	uint32_t size;		/* number of slots, a power of two or 0 */
+	uint32_t count;		/* number of occupied slots */
+};
+
+void
+id_map_init(struct id_map *map);
+
+void
+id_map_release(struct id_map *map);
+
+int
+id_map_insert(struct id_map *map, uint32_t id, void *data);
+
+void *
+id_map_lookup(const struct id_map *map, uint32_t id);
+
+void *
+id_map_remove(struct id_map *map, uint32_t id);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* WESTON_ID_MAP_H */
@@ -231,7 +231,7 @@ reset_alpha(struct weston_view_animation *animation)
 {
 	struct weston_view *view = animation->view;
 
-	view->alpha = animation->stop;
+	weston_view_set_alpha(view, animation->stop);
 }
 
 static void
@@ -252,9 +252,7 @@ zoom_frame(struct weston_view_animation *animation)
 				0.5f * es->surface->width,
 				0.5f * es->surface->height, 0);
 
-	es->alpha = animation->spring.current;
-	if (es->alpha > 1.0)
-		es->alpha = 1.0;
+	weston_view_set_alpha(es, fminf(animation->spring.current, 1.0));
 }
 
 WL_EXPORT struct weston_view_animation *
@@ -283,11 +281,12 @@ static void
 fade_frame(struct weston_view_animation *animation)
 {
 	if (animation->spring.current > 0.999)
-		animation->view->alpha = 1;
+		weston_view_set_alpha(animation->view, 1);
 	else if (animation->spring.current < 0.001 )
-		animation->view->alpha = 0;
+		weston_view_set_alpha(animation->view, 0);
 	else
-		animation->view->alpha = animation->spring.current;
+		weston_view_set_alpha(animation->view,
+				      animation->spring.current);
 }
 
 WL_EXPORT struct weston_view_animation *
@@ -308,7 +307,7 @@ weston_fade_run(struct weston_view *view,
 	fade->spring.friction = 4000;
 	fade->spring.previous = start - (end - start) * 0.1;
 
-	view->alpha = start;
+	weston_view_set_alpha(view, start);
 
 	weston_view_animation_run(fade);
 
@@ -327,16 +326,17 @@ stable_fade_frame(struct weston_view_animation *animation)
 	struct weston_view *back_view;
 
 	if (animation->spring.current > 0.999)
-		animation->view->alpha = 1;
+		weston_view_set_alpha(animation->view, 1);
 	else if (animation->spring.current < 0.001 )
-		animation->view->alpha = 0;
+		weston_view_set_alpha(animation->view, 0);
 	else
-		animation->view->alpha = animation->spring.current;
+		weston_view_set_alpha(animation->view,
+				      animation->spring.current);
 
 	back_view = (struct weston_view *) animation->private;
-	back_view->alpha =
+	weston_view_set_alpha(back_view,
 		(animation->spring.target - animation->view->alpha) /
-		(1.0 - animation->view->alpha);
+		(1.0 - animation->view->alpha));
 	weston_view_geometry_dirty(back_view);
 }
 
@@ -357,8 +357,8 @@ weston_stable_fade_run(struct weston_view *front_view, float start,
 	weston_spring_init(&fade->spring, 400, start, end);
 	fade->spring.friction = 1150;
 
-	front_view->alpha = start;
-	back_view->alpha = end;
+	weston_view_set_alpha(front_view, start);
+	weston_view_set_alpha(back_view, end);
 
 	weston_view_animation_run(fade);
 
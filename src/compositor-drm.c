@@ -50,6 +50,7 @@
 #include "udev-input.h"
 #include "launcher-util.h"
 #include "vaapi-recorder.h"
+#include "presentation_timing-server-protocol.h"
 
 #ifndef DRM_CAP_TIMESTAMP_MONOTONIC
 #define DRM_CAP_TIMESTAMP_MONOTONIC 0x6
@@ -106,7 +107,6 @@ struct drm_compositor {
 
 	uint32_t prev_state;
 
-	clockid_t clock;
 	struct udev_input input;
 };
 
@@ -188,6 +188,10 @@ struct drm_sprite {
 	uint32_t plane_id;
 	uint32_t count_formats;
 
+	/* id of the "colorkey" property of the plane, 0 if it has none */
+	uint32_t color_key_prop;
+	uint64_t color_key, next_color_key;
+
 	int32_t src_x, src_y;
 	uint32_t src_w, src_h;
 	uint32_t dest_x, dest_y;
@@ -196,6 +200,12 @@ struct drm_sprite {
 	uint32_t formats[];
 };
 
+/*
+ * Value of the "colorkey" plane property, as the rcar-du driver defines
+ * it: RGB888 of the key in the low 24 bits and the enable bit above.
+ */
+#define DRM_PLANE_COLOR_KEY_ENABLE (1 << 24)
+
 struct drm_parameters {
 	int connector;
 	int tty;
@@ -638,6 +648,20 @@ drm_output_repaint(struct weston_output *output_base,
 		if (s->next && !compositor->sprites_hidden)
 			fb_id = s->next->fb_id;
 
+		if (s->next && s->color_key_prop &&
+		    s->next_color_key != s->color_key) {
+			ret = drmModeObjectSetProperty(compositor->drm.fd,
+						       s->plane_id,
+						       DRM_MODE_OBJECT_PLANE,
+						       s->color_key_prop,
+						       s->next_color_key);
+			if (ret)
+				weston_log("setting color key failed: %d: %s\n",
+					   ret, strerror(errno));
+			else
+				s->color_key = s->next_color_key;
+		}
+
 		ret = drmModeSetPlane(compositor->drm.fd, s->plane_id,
 				      output->crtc_id, fb_id, flags,
 				      s->dest_x, s->dest_y,
@@ -685,7 +709,6 @@ drm_output_start_repaint_loop(struct weston_output *output_base)
 	struct drm_compositor *compositor = (struct drm_compositor *)
 		output_base->compositor;
 	uint32_t fb_id;
-	uint32_t msec;
 	struct timespec ts;
 
 	if (output->destroy_pending)
@@ -708,9 +731,23 @@ drm_output_start_repaint_loop(struct weston_output *output_base)
 
 finish_frame:
 	/* if we cannot page-flip, immediately finish frame */
-	clock_gettime(compositor->clock, &ts);
-	msec = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-	weston_output_finish_frame(output_base, msec);
+	weston_compositor_read_presentation_clock(&compositor->base, &ts);
+	weston_output_finish_frame(output_base, &ts, 0);
+}
+
+/* Extends the 32-bit vblank sequence of the kernel to output->base.msc.
+ * The frames finished without a page flip count on msc in between, so
+ * only a large step back is a wrap-around. */
+static void
+drm_output_update_msc(struct drm_output *output, unsigned int seq)
+{
+	uint64_t msc_hi = output->base.msc >> 32;
+	uint32_t msc_lo = output->base.msc & 0xffffffff;
+
+	if (seq < msc_lo && msc_lo - seq > 0x80000000)
+		msc_hi++;
+
+	output->base.msc = (msc_hi << 32) + seq;
 }
 
 static void
@@ -719,8 +756,12 @@ vblank_handler(int fd, unsigned int frame, unsigned int sec, unsigned int usec,
 {
 	struct drm_sprite *s = (struct drm_sprite *)data;
 	struct drm_output *output = s->output;
-	uint32_t msecs;
+	struct timespec ts;
+	uint32_t flags = PRESENTATION_FEEDBACK_KIND_VSYNC |
+			 PRESENTATION_FEEDBACK_KIND_HW_CLOCK |
+			 PRESENTATION_FEEDBACK_KIND_HW_COMPLETION;
 
+	drm_output_update_msc(output, frame);
 	output->vblank_pending = 0;
 
 	drm_output_release_fb(output, s->current);
@@ -728,8 +769,9 @@ vblank_handler(int fd, unsigned int frame, unsigned int sec, unsigned int usec,
 	s->next = NULL;
 
 	if (!output->page_flip_pending) {
-		msecs = sec * 1000 + usec / 1000;
-		weston_output_finish_frame(&output->base, msecs);
+		ts.tv_sec = sec;
+		ts.tv_nsec = usec * 1000;
+		weston_output_finish_frame(&output->base, &ts, flags);
 	}
 }
 
@@ -741,7 +783,12 @@ page_flip_handler(int fd, unsigned int frame,
 		  unsigned int sec, unsigned int usec, void *data)
 {
 	struct drm_output *output = (struct drm_output *) data;
-	uint32_t msecs;
+	struct timespec ts;
+	uint32_t flags = PRESENTATION_FEEDBACK_KIND_VSYNC |
+			 PRESENTATION_FEEDBACK_KIND_HW_CLOCK |
+			 PRESENTATION_FEEDBACK_KIND_HW_COMPLETION;
+
+	drm_output_update_msc(output, frame);
 
 	/* We don't set page_flip_pending on start_repaint_loop, in that case
 	 * we just want to page flip to the current buffer to get an accurate
@@ -757,8 +804,9 @@ page_flip_handler(int fd, unsigned int frame,
 	if (output->destroy_pending)
 		drm_output_destroy(&output->base);
 	else if (!output->vblank_pending) {
-		msecs = sec * 1000 + usec / 1000;
-		weston_output_finish_frame(&output->base, msecs);
+		ts.tv_sec = sec;
+		ts.tv_nsec = usec * 1000;
+		weston_output_finish_frame(&output->base, &ts, flags);
 
 		/* We can't call this from frame_notify, because the output's
 		 * repaint needed flag is cleared just after that */
@@ -827,7 +875,10 @@ drm_output_prepare_overlay_view(struct weston_output *output_base,
 	if (viewport->buffer.scale != output_base->current_scale)
 		return NULL;
 
-	if (c->sprites_are_broken)
+	/* Views the shell explicitly wants on a plane are tried even while
+	 * sprites are disabled by default, unless the kernel cannot take
+	 * the framebuffers. */
+	if (c->sprites_are_broken && (!ev->prefer_plane || c->no_addfb2))
 		return NULL;
 
 	if (ev->output_mask != (1u << output_base->id))
@@ -849,6 +900,10 @@ drm_output_prepare_overlay_view(struct weston_output *output_base,
 		if (!drm_sprite_crtc_supported(output_base, s->possible_crtcs))
 			continue;
 
+		/* keyed views only go to planes doing the keying */
+		if (ev->chroma_key.enabled && !s->color_key_prop)
+			continue;
+
 		if (!s->next) {
 			found = 1;
 			break;
@@ -879,6 +934,12 @@ drm_output_prepare_overlay_view(struct weston_output *output_base,
 
 	drm_fb_set_buffer(s->next, ev->surface->buffer_ref.buffer);
 
+	if (ev->chroma_key.enabled)
+		s->next_color_key = DRM_PLANE_COLOR_KEY_ENABLE |
+				    ev->chroma_key.color;
+	else
+		s->next_color_key = 0;
+
 	box = pixman_region32_extents(&ev->transform.boundingbox);
 	s->plane.x = box->x1;
 	s->plane.y = box->y1;
@@ -1089,7 +1150,7 @@ drm_assign_planes(struct weston_output *output)
 		next_plane = NULL;
 		if (pixman_region32_not_empty(&surface_overlap))
 			next_plane = primary;
-		if (next_plane == NULL)
+		if (next_plane == NULL && !ev->prefer_plane)
 			next_plane = drm_output_prepare_cursor_view(output, ev);
 		if (next_plane == NULL)
 			next_plane = drm_output_prepare_scanout_view(output, ev);
@@ -1267,6 +1328,7 @@ init_drm(struct drm_compositor *ec, struct udev_device *device)
 	const char *filename, *sysnum;
 	uint64_t cap;
 	int fd, ret;
+	clockid_t clk_id;
 
 	sysnum = udev_device_get_sysnum(device);
 	if (sysnum)
@@ -1290,11 +1352,18 @@ init_drm(struct drm_compositor *ec, struct udev_device *device)
 	ec->drm.fd = fd;
 	ec->drm.filename = strdup(filename);
 
+	/* page flip and vblank events carry timestamps of this clock */
 	ret = drmGetCap(fd, DRM_CAP_TIMESTAMP_MONOTONIC, &cap);
 	if (ret == 0 && cap == 1)
-		ec->clock = CLOCK_MONOTONIC;
+		clk_id = CLOCK_MONOTONIC;
 	else
-		ec->clock = CLOCK_REALTIME;
+		clk_id = CLOCK_REALTIME;
+
+	if (weston_compositor_set_presentation_clock(&ec->base, clk_id) < 0) {
+		weston_log("Error: failed to set presentation clock %d.\n",
+			   clk_id);
+		return -1;
+	}
 
 	return 0;
 }
@@ -1895,6 +1964,7 @@ create_output_for_connector(struct drm_compositor *ec,
 			    int x, int y, struct udev_device *drm_device)
 {
 	struct drm_output *output;
+	struct drm_sprite *sprite;
 	struct drm_mode *drm_mode, *next, *preferred, *current, *configured, *best;
 	struct weston_mode *m;
 	struct weston_config_section *section;
@@ -2091,6 +2161,12 @@ create_output_for_connector(struct drm_compositor *ec,
 	output->base.gamma_size = output->original_crtc->gamma_size;
 	output->base.set_gamma = drm_output_set_gamma;
 
+	wl_list_for_each(sprite, &ec->sprite_list, link) {
+		if (drm_sprite_crtc_supported(&output->base,
+					      sprite->possible_crtcs))
+			output->base.plane_count++;
+	}
+
 	weston_plane_init(&output->cursor_plane, &ec->base, 0, 0);
 	weston_plane_init(&output->fb_plane, &ec->base, 0, 0);
 
@@ -2129,6 +2205,35 @@ err_free:
 	return -1;
 }
 
+static uint32_t
+drm_plane_get_prop_id(int fd, uint32_t plane_id, const char *name)
+{
+	drmModeObjectPropertiesPtr props;
+	drmModePropertyPtr prop;
+	uint32_t prop_id = 0;
+	uint32_t i;
+
+	props = drmModeObjectGetProperties(fd, plane_id,
+					   DRM_MODE_OBJECT_PLANE);
+	if (!props)
+		return 0;
+
+	for (i = 0; i < props->count_props && prop_id == 0; i++) {
+		prop = drmModeGetProperty(fd, props->props[i]);
+		if (!prop)
+			continue;
+
+		if (!strcmp(prop->name, name))
+			prop_id = prop->prop_id;
+
+		drmModeFreeProperty(prop);
+	}
+
+	drmModeFreeObjectProperties(props);
+
+	return prop_id;
+}
+
 static void
 create_sprites(struct drm_compositor *ec)
 {
@@ -2167,6 +2272,11 @@ create_sprites(struct drm_compositor *ec)
 		memcpy(sprite->formats, plane->formats,
 		       plane->count_formats * sizeof(plane->formats[0]));
 		drmModeFreePlane(plane);
+		sprite->color_key_prop =
+			drm_plane_get_prop_id(ec->drm.fd, sprite->plane_id,
+					      "colorkey");
+		/* unknown until the first view is put on the plane */
+		sprite->color_key = ~0ULL;
 		weston_plane_init(&sprite->plane, &ec->base, 0, 0);
 		weston_compositor_stack_plane(&ec->base, &sprite->plane,
 					      &ec->base.primary_plane);
@@ -54,6 +54,7 @@
 
 #include "compositor.h"
 #include "scaler-server-protocol.h"
+#include "presentation_timing-server-protocol.h"
 #include "../shared/os-compatibility.h"
 #include "git-version.h"
 #include "version.h"
@@ -363,6 +364,7 @@ weston_view_create(struct weston_surface *surface)
 	wl_signal_init(&view->destroy_signal);
 	wl_list_init(&view->link);
 	wl_list_init(&view->layer_link);
+	wl_list_init(&view->plane_link);
 
 	view->plane = NULL;
 
@@ -394,6 +396,7 @@ weston_surface_create(struct weston_compositor *compositor)
 		return NULL;
 
 	wl_signal_init(&surface->destroy_signal);
+	wl_signal_init(&surface->commit_signal);
 
 	surface->resource = NULL;
 
@@ -417,6 +420,7 @@ weston_surface_create(struct weston_compositor *compositor)
 	wl_list_init(&surface->views);
 
 	wl_list_init(&surface->frame_callback_list);
+	wl_list_init(&surface->feedback_list);
 
 	surface->pending.buffer_destroy_listener.notify =
 		surface_handle_pending_buffer_destroy;
@@ -424,6 +428,7 @@ weston_surface_create(struct weston_compositor *compositor)
 	pixman_region32_init(&surface->pending.opaque);
 	region_init_infinite(&surface->pending.input);
 	wl_list_init(&surface->pending.frame_callback_list);
+	wl_list_init(&surface->pending.feedback_list);
 
 	wl_list_init(&surface->subsurface_list);
 	wl_list_init(&surface->subsurface_list_pending);
@@ -915,7 +920,7 @@ weston_view_update_transform_disable(struct weston_view *view)
 				  view->surface->width,
 				  view->surface->height);
 
-	if (view->alpha == 1.0) {
+	if (view->alpha == 1.0 && !view->chroma_key.enabled) {
 		pixman_region32_copy(&view->transform.opaque,
 				     &view->surface->opaque);
 		pixman_region32_translate(&view->transform.opaque,
@@ -924,6 +929,80 @@ weston_view_update_transform_disable(struct weston_view *view)
 	}
 }
 
+/* Whether the view transformation maps surface rectangles to global
+ * rectangles: scaling and translation, possibly with a multiple of 90
+ * degrees rotation or a flip, and no projection.
+ */
+static int
+view_transform_is_axis_aligned(struct weston_view *view)
+{
+	const float *d = view->transform.matrix.d;
+
+	if (d[3] != 0.0f || d[7] != 0.0f || d[15] != 1.0f)
+		return 0;
+
+	return (d[1] == 0.0f && d[4] == 0.0f) ||
+	       (d[0] == 0.0f && d[5] == 0.0f);
+}
+
+/* Round a transformed edge towards the inside of the rectangle, so the
+ * opaque region never grows, but keep edges that land on a pixel up to
+ * float error. */
+static int32_t
+opaque_edge(float v, int round_up)
+{
+	float r = roundf(v);
+
+	if (fabsf(v - r) < 1.0f / 256.0f)
+		return r;
+
+	return round_up ? ceilf(v) : floorf(v);
+}
+
+static void
+view_transform_opaque(struct weston_view *view)
+{
+	pixman_box32_t *rects;
+	pixman_box32_t *boxes;
+	pixman_box32_t box;
+	float x1, y1, x2, y2;
+	int i, n, count = 0;
+
+	rects = pixman_region32_rectangles(&view->surface->opaque, &n);
+	if (n == 0)
+		return;
+
+	/* opaque regions are mostly a single rectangle */
+	if (n == 1) {
+		boxes = &box;
+	} else {
+		boxes = malloc(n * sizeof *boxes);
+		if (boxes == NULL)
+			return;
+	}
+
+	for (i = 0; i < n; i++) {
+		weston_view_to_global_float(view, rects[i].x1, rects[i].y1,
+					    &x1, &y1);
+		weston_view_to_global_float(view, rects[i].x2, rects[i].y2,
+					    &x2, &y2);
+
+		boxes[count].x1 = opaque_edge(fminf(x1, x2), 1);
+		boxes[count].y1 = opaque_edge(fminf(y1, y2), 1);
+		boxes[count].x2 = opaque_edge(fmaxf(x1, x2), 0);
+		boxes[count].y2 = opaque_edge(fmaxf(y1, y2), 0);
+
+		if (boxes[count].x1 < boxes[count].x2 &&
+		    boxes[count].y1 < boxes[count].y2)
+			count++;
+	}
+
+	pixman_region32_fini(&view->transform.opaque);
+	pixman_region32_init_rects(&view->transform.opaque, boxes, count);
+	if (boxes != &box)
+		free(boxes);
+}
+
 static int
 weston_view_update_transform_enable(struct weston_view *view)
 {
@@ -957,9 +1036,22 @@ weston_view_update_transform_enable(struct weston_view *view)
 			  view->surface->width, view->surface->height,
 			  &view->transform.boundingbox);
 
+	if (view->alpha == 1.0 && !view->chroma_key.enabled &&
+	    view_transform_is_axis_aligned(view))
+		view_transform_opaque(view);
+
 	return 0;
 }
 
+/* Views without input are never picked, so cursors and drag icons
+ * moving around do not invalidate the pick grid. */
+static void
+view_pick_changed(struct weston_view *view)
+{
+	if (pixman_region32_not_empty(&view->surface->input))
+		view->surface->compositor->pick_index.generation++;
+}
+
 WL_EXPORT void
 weston_view_update_transform(struct weston_view *view)
 {
@@ -995,6 +1087,8 @@ weston_view_update_transform(struct weston_view *view)
 
 	weston_view_assign_output(view);
 
+	view_pick_changed(view);
+
 	wl_signal_emit(&view->surface->compositor->transform_signal,
 		       view->surface);
 }
@@ -1011,6 +1105,9 @@ weston_view_geometry_dirty(struct weston_view *view)
 	 * are not dirty.
 	 */
 
+	/* Untransformed views are picked by geometry.x and y already. */
+	view_pick_changed(view);
+
 	if (view->transform.dirty)
 		return;
 
@@ -1129,6 +1226,37 @@ weston_view_set_position(struct weston_view *view, float x, float y)
 	weston_view_geometry_dirty(view);
 }
 
+WL_EXPORT void
+weston_view_set_alpha(struct weston_view *view, float alpha)
+{
+	if (view->alpha == alpha)
+		return;
+
+	/* only an opaque view has an opaque region */
+	if (view->alpha == 1.0 || alpha == 1.0)
+		weston_view_geometry_dirty(view);
+
+	view->alpha = alpha;
+}
+
+WL_EXPORT void
+weston_view_set_chroma_key(struct weston_view *view, int enabled,
+			   uint32_t color)
+{
+	color &= 0xffffff;
+
+	if (view->chroma_key.enabled == enabled &&
+	    (!enabled || view->chroma_key.color == color))
+		return;
+
+	view->chroma_key.enabled = enabled;
+	view->chroma_key.color = color;
+
+	/* a keyed view has no opaque region */
+	weston_view_geometry_dirty(view);
+	weston_surface_damage(view->surface);
+}
+
 static void
 transform_parent_handle_parent_destroy(struct wl_listener *listener,
 				       void *data)
@@ -1257,6 +1385,61 @@ weston_surface_set_size_from_buffer(struct weston_surface *surface)
 	surface_set_size(surface, width, height);
 }
 
+/* Crop the buffer of a surface like wl_viewport.set_source does, on
+ * behalf of a shell. The crop is kept over later commits of the client.
+ * A src_width of wl_fixed_from_int(-1) removes the crop.
+ */
+WL_EXPORT void
+weston_surface_set_viewport_source(struct weston_surface *surface,
+				   wl_fixed_t src_x, wl_fixed_t src_y,
+				   wl_fixed_t src_width, wl_fixed_t src_height)
+{
+	struct weston_buffer_viewport *vp = &surface->buffer_viewport;
+
+	if (vp->buffer.src_x == src_x && vp->buffer.src_y == src_y &&
+	    vp->buffer.src_width == src_width &&
+	    vp->buffer.src_height == src_height)
+		return;
+
+	vp->buffer.src_x = src_x;
+	vp->buffer.src_y = src_y;
+	vp->buffer.src_width = src_width;
+	vp->buffer.src_height = src_height;
+	surface->pending.buffer_viewport.buffer.src_x = src_x;
+	surface->pending.buffer_viewport.buffer.src_y = src_y;
+	surface->pending.buffer_viewport.buffer.src_width = src_width;
+	surface->pending.buffer_viewport.buffer.src_height = src_height;
+
+	weston_surface_set_size_from_buffer(surface);
+	weston_surface_damage(surface);
+}
+
+/* Free what the renderer and the compositor keep for showing a surface
+ * which is not shown for a while. The content is back once the client
+ * attaches a new buffer. Until then the surface draws nothing, so it must
+ * not hide what is below it; its next commit sets the opaque region again.
+ * Returns the bytes freed by the renderer.
+ */
+WL_EXPORT size_t
+weston_surface_release_renderer_state(struct weston_surface *surface)
+{
+	struct weston_renderer *renderer = surface->compositor->renderer;
+	struct weston_view *view;
+
+	weston_buffer_reference(&surface->buffer_ref, NULL);
+
+	if (pixman_region32_not_empty(&surface->opaque)) {
+		empty_region(&surface->opaque);
+		wl_list_for_each(view, &surface->views, surface_link)
+			weston_view_geometry_dirty(view);
+	}
+
+	if (!renderer->surface_release)
+		return 0;
+
+	return renderer->surface_release(surface);
+}
+
 WL_EXPORT uint32_t
 weston_compositor_get_time(void)
 {
@@ -1267,10 +1450,301 @@ weston_compositor_get_time(void)
        return tv.tv_sec * 1000 + tv.tv_usec / 1000;
 }
 
-WL_EXPORT struct weston_view *
-weston_compositor_pick_view(struct weston_compositor *compositor,
-			    wl_fixed_t x, wl_fixed_t y,
-			    wl_fixed_t *vx, wl_fixed_t *vy)
+/** Set the clock presentation timestamps are taken in
+ *
+ * \param compositor The compositor.
+ * \param clk_id The clock the backend's frame timestamps are in.
+ * \return 0 on success, -1 if the clock cannot be read.
+ *
+ * Backends whose display hardware gives timestamps call this during
+ * initialization, before any client binds the presentation global.
+ */
+WL_EXPORT int
+weston_compositor_set_presentation_clock(struct weston_compositor *compositor,
+					 clockid_t clk_id)
+{
+	struct timespec ts;
+
+	if (clock_gettime(clk_id, &ts) < 0)
+		return -1;
+
+	compositor->presentation_clock = clk_id;
+
+	return 0;
+}
+
+/** Set CLOCK_MONOTONIC as the presentation clock, if available
+ *
+ * \param compositor The compositor.
+ * \return 0 on success, -1 if no clock could be read.
+ *
+ * Used for backends that take timestamps in software, with
+ * weston_compositor_read_presentation_clock().
+ */
+WL_EXPORT int
+weston_compositor_set_presentation_clock_software(
+					struct weston_compositor *compositor)
+{
+	static const clockid_t clocks[] = {
+		CLOCK_MONOTONIC,
+		CLOCK_REALTIME
+	};
+	unsigned i;
+
+	for (i = 0; i < ARRAY_LENGTH(clocks); i++)
+		if (weston_compositor_set_presentation_clock(compositor,
+							     clocks[i]) == 0)
+			return 0;
+
+	weston_log("Error: no suitable presentation clock available.\n");
+
+	return -1;
+}
+
+/** Read the current time of the presentation clock
+ *
+ * \param compositor The compositor.
+ * \param ts [out] The current time, zero if the clock cannot be read.
+ */
+WL_EXPORT void
+weston_compositor_read_presentation_clock(
+			const struct weston_compositor *compositor,
+			struct timespec *ts)
+{
+	static int warned;
+	int ret;
+
+	ret = clock_gettime(compositor->presentation_clock, ts);
+	if (ret < 0) {
+		ts->tv_sec = 0;
+		ts->tv_nsec = 0;
+
+		if (!warned)
+			weston_log("Error: failure to read "
+				   "the presentation clock %#x: %m\n",
+				   compositor->presentation_clock);
+		warned = 1;
+	}
+}
+
+/* Views are picked through a uniform grid over the global boxes of
+ * their input regions. Each cell lists the views touching it in view
+ * list order, so a pick only tests the views of one cell. The grid is
+ * built again on the first pick after pick_index.generation changed.
+ */
+
+#define PICK_GRID_MIN_SHIFT 6
+#define PICK_GRID_MAX_CELLS 1024
+#define PICK_MAX_INPUT_SIZE (1 << 16)
+#define PICK_MAX_INPUT_COORD (1 << 24)	/* exact in a float */
+
+struct pick_entry {
+	struct weston_view *view;
+	pixman_box32_t box;
+};
+
+struct pick_grid {
+	int unbounded;		/* a view has unbounded input; scan instead */
+	int32_t x, y;		/* global position of the first cell */
+	int shift;		/* log2 of the cell size */
+	int32_t width, height;	/* in cells */
+	struct wl_array entries;	/* struct pick_entry in view list order */
+	struct wl_array cell_start;	/* uint32_t index in cells per cell */
+	struct wl_array cells;		/* struct pick_entry * */
+};
+
+/* Returns 1 and the global box a pick of the view can hit, 0 if the view
+ * has no input, or -1 if its input is not bounded. Infinite input regions
+ * span INT32_MIN to INT32_MAX, so sizes are computed in 64 bits, and input
+ * too far away for the float math below counts as not bounded. */
+static int
+view_pick_box(struct weston_view *view, pixman_box32_t *box)
+{
+	pixman_region32_t *input = &view->surface->input;
+	pixman_box32_t *extents;
+	pixman_region32_t bbox;
+
+	if (!pixman_region32_not_empty(input))
+		return 0;
+
+	extents = pixman_region32_extents(input);
+	if ((int64_t) extents->x2 - extents->x1 > PICK_MAX_INPUT_SIZE ||
+	    (int64_t) extents->y2 - extents->y1 > PICK_MAX_INPUT_SIZE)
+		return -1;
+
+	if (extents->x1 < -PICK_MAX_INPUT_COORD ||
+	    extents->y1 < -PICK_MAX_INPUT_COORD ||
+	    extents->x2 > PICK_MAX_INPUT_COORD ||
+	    extents->y2 > PICK_MAX_INPUT_COORD)
+		return -1;
+
+	/* wl_fixed_to_int() truncates towards zero, so the pixel left of
+	 * and above the input region hits too. */
+	view_compute_bbox(view, extents->x1 - 1, extents->y1 - 1,
+			  extents->x2 - extents->x1 + 1,
+			  extents->y2 - extents->y1 + 1, &bbox);
+	*box = *pixman_region32_extents(&bbox);
+	pixman_region32_fini(&bbox);
+
+	/* and one more pixel against float error on the far edges */
+	box->x2++;
+	box->y2++;
+
+	return 1;
+}
+
+static int
+pick_grid_build(struct pick_grid *grid, struct weston_compositor *compositor)
+{
+	struct weston_view *view;
+	struct pick_entry *entry, *entries, **cells;
+	pixman_box32_t box, extents = { 0, 0, 0, 0 };
+	uint32_t *cell_start;
+	uint32_t count, n, i, total;
+	int32_t cx, cy, cx1, cy1, cx2, cy2;
+	int r;
+
+	grid->unbounded = 0;
+	grid->width = 0;
+	grid->height = 0;
+	grid->entries.size = 0;
+
+	wl_list_for_each(view, &compositor->view_list, link) {
+		r = view_pick_box(view, &box);
+		if (r == 0)
+			continue;
+		if (r < 0) {
+			grid->unbounded = 1;
+			return 0;
+		}
+
+		entry = wl_array_add(&grid->entries, sizeof *entry);
+		if (entry == NULL)
+			return -1;
+		entry->view = view;
+		entry->box = box;
+
+		if (grid->entries.size == sizeof *entry) {
+			extents = box;
+			continue;
+		}
+		if (box.x1 < extents.x1)
+			extents.x1 = box.x1;
+		if (box.y1 < extents.y1)
+			extents.y1 = box.y1;
+		if (box.x2 > extents.x2)
+			extents.x2 = box.x2;
+		if (box.y2 > extents.y2)
+			extents.y2 = box.y2;
+	}
+
+	n = grid->entries.size / sizeof *entry;
+	if (n == 0)
+		return 0;
+
+	grid->x = extents.x1;
+	grid->y = extents.y1;
+	grid->shift = PICK_GRID_MIN_SHIFT;
+	do {
+		grid->width = ((extents.x2 - extents.x1 - 1) >> grid->shift) + 1;
+		grid->height = ((extents.y2 - extents.y1 - 1) >> grid->shift) + 1;
+	} while ((int64_t) grid->width * grid->height > PICK_GRID_MAX_CELLS &&
+		 ++grid->shift);
+	count = grid->width * grid->height;
+
+	grid->cell_start.size = 0;
+	cell_start = wl_array_add(&grid->cell_start,
+				  (count + 1) * sizeof *cell_start);
+	if (cell_start == NULL)
+		return -1;
+	memset(cell_start, 0, (count + 1) * sizeof *cell_start);
+
+	/* Count the views per cell, and make cell_start the end of each. */
+	entries = grid->entries.data;
+	for (i = 0; i < n; i++) {
+		cx1 = (entries[i].box.x1 - grid->x) >> grid->shift;
+		cy1 = (entries[i].box.y1 - grid->y) >> grid->shift;
+		cx2 = (entries[i].box.x2 - 1 - grid->x) >> grid->shift;
+		cy2 = (entries[i].box.y2 - 1 - grid->y) >> grid->shift;
+		for (cy = cy1; cy <= cy2; cy++)
+			for (cx = cx1; cx <= cx2; cx++)
+				cell_start[cy * grid->width + cx]++;
+	}
+
+	total = 0;
+	for (i = 0; i < count; i++) {
+		total += cell_start[i];
+		cell_start[i] = total;
+	}
+	cell_start[count] = total;
+
+	grid->cells.size = 0;
+	cells = wl_array_add(&grid->cells, total * sizeof *cells);
+	if (cells == NULL && total > 0)
+		return -1;
+
+	/* Fill back to front, leaving cell_start at the start of each. */
+	for (i = n; i-- > 0; ) {
+		cx1 = (entries[i].box.x1 - grid->x) >> grid->shift;
+		cy1 = (entries[i].box.y1 - grid->y) >> grid->shift;
+		cx2 = (entries[i].box.x2 - 1 - grid->x) >> grid->shift;
+		cy2 = (entries[i].box.y2 - 1 - grid->y) >> grid->shift;
+		for (cy = cy1; cy <= cy2; cy++)
+			for (cx = cx1; cx <= cx2; cx++)
+				cells[--cell_start[cy * grid->width + cx]] =
+					&entries[i];
+	}
+
+	return 0;
+}
+
+static void
+pick_grid_destroy(struct pick_grid *grid)
+{
+	if (grid == NULL)
+		return;
+
+	wl_array_release(&grid->entries);
+	wl_array_release(&grid->cell_start);
+	wl_array_release(&grid->cells);
+	free(grid);
+}
+
+/* Called after the view list was built again: the grid stays valid if
+ * the views with input are still in the same order. */
+static void
+pick_grid_check_view_list(struct weston_compositor *compositor)
+{
+	struct pick_grid *grid = compositor->pick_index.grid;
+	struct pick_entry *entry, *end;
+	struct weston_view *view;
+
+	if (grid == NULL || grid->unbounded ||
+	    compositor->pick_index.built != compositor->pick_index.generation) {
+		compositor->pick_index.generation++;
+		return;
+	}
+
+	entry = grid->entries.data;
+	end = entry + grid->entries.size / sizeof *entry;
+	wl_list_for_each(view, &compositor->view_list, link) {
+		if (!pixman_region32_not_empty(&view->surface->input))
+			continue;
+		if (entry == end || entry->view != view) {
+			compositor->pick_index.generation++;
+			return;
+		}
+		entry++;
+	}
+
+	if (entry != end)
+		compositor->pick_index.generation++;
+}
+
+static struct weston_view *
+view_list_pick(struct weston_compositor *compositor,
+	       wl_fixed_t x, wl_fixed_t y,
+	       wl_fixed_t *vx, wl_fixed_t *vy)
 {
 	struct weston_view *view;
 
@@ -1286,16 +1760,105 @@ weston_compositor_pick_view(struct weston_compositor *compositor,
 	return NULL;
 }
 
+WL_EXPORT struct weston_view *
+weston_compositor_pick_view(struct weston_compositor *compositor,
+			    wl_fixed_t x, wl_fixed_t y,
+			    wl_fixed_t *vx, wl_fixed_t *vy)
+{
+	struct pick_grid *grid = compositor->pick_index.grid;
+	struct pick_entry **cells;
+	uint32_t *cell_start;
+	uint32_t i, cell;
+	int32_t px, py, cx, cy;
+
+	if (grid == NULL) {
+		grid = zalloc(sizeof *grid);
+		if (grid == NULL)
+			return view_list_pick(compositor, x, y, vx, vy);
+		wl_array_init(&grid->entries);
+		wl_array_init(&grid->cell_start);
+		wl_array_init(&grid->cells);
+		compositor->pick_index.grid = grid;
+		compositor->pick_index.built =
+			compositor->pick_index.generation - 1;
+	}
+
+	if (compositor->pick_index.built != compositor->pick_index.generation) {
+		if (pick_grid_build(grid, compositor) < 0)
+			return view_list_pick(compositor, x, y, vx, vy);
+		compositor->pick_index.built = compositor->pick_index.generation;
+	}
+
+	if (grid->unbounded)
+		return view_list_pick(compositor, x, y, vx, vy);
+
+	*vx = 0;
+	*vy = 0;
+
+	px = floor(wl_fixed_to_double(x));
+	py = floor(wl_fixed_to_double(y));
+	if (px < grid->x || py < grid->y)
+		return NULL;
+
+	cx = (px - grid->x) >> grid->shift;
+	cy = (py - grid->y) >> grid->shift;
+	if (cx >= grid->width || cy >= grid->height)
+		return NULL;
+
+	cell = cy * grid->width + cx;
+	cell_start = grid->cell_start.data;
+	cells = grid->cells.data;
+	for (i = cell_start[cell]; i < cell_start[cell + 1]; i++) {
+		if (px < cells[i]->box.x1 || px >= cells[i]->box.x2 ||
+		    py < cells[i]->box.y1 || py >= cells[i]->box.y2)
+			continue;
+
+		weston_view_from_global_fixed(cells[i]->view, x, y, vx, vy);
+		if (pixman_region32_contains_point(&cells[i]->view->surface->input,
+						   wl_fixed_to_int(*vx),
+						   wl_fixed_to_int(*vy),
+						   NULL))
+			return cells[i]->view;
+	}
+
+	*vx = 0;
+	*vy = 0;
+
+	return NULL;
+}
+
+/* Runs weston_seat_repick() for the seats whose pointer moved, changed
+ * grab or focus, or may pick differently since the last repick. */
 static void
 weston_compositor_repick(struct weston_compositor *compositor)
 {
 	struct weston_seat *seat;
+	struct weston_pointer *pointer;
 
 	if (!compositor->session_active)
 		return;
 
-	wl_list_for_each(seat, &compositor->seat_list, link)
+	wl_list_for_each(seat, &compositor->seat_list, link) {
+		pointer = seat->pointer;
+		if (pointer == NULL)
+			continue;
+
+		if (pointer->repick.generation ==
+		    compositor->pick_index.generation &&
+		    pointer->repick.x == pointer->x &&
+		    pointer->repick.y == pointer->y &&
+		    pointer->repick.grab == pointer->grab &&
+		    pointer->repick.focus == pointer->focus)
+			continue;
+
 		weston_seat_repick(seat);
+
+		pointer->repick.generation = compositor->pick_index.generation;
+		pointer->repick.x = pointer->x;
+		pointer->repick.y = pointer->y;
+		pointer->repick.grab = pointer->grab;
+		pointer->repick.focus = pointer->focus;
+	}
 }
 
 WL_EXPORT void
@@ -1313,6 +1876,7 @@ weston_view_unmap(struct weston_view *view)
 	wl_list_init(&view->layer_link);
 	wl_list_remove(&view->link);
 	wl_list_init(&view->link);
+	view->surface->compositor->pick_index.generation++;
 	view->output_mask = 0;
 	weston_surface_assign_output(view->surface);
 
@@ -1358,6 +1922,93 @@ struct weston_frame_callback {
 	struct wl_list link;
 };
 
+struct weston_presentation_feedback {
+	struct wl_resource *resource;
+	struct wl_list link;
+};
+
+static void
+weston_presentation_feedback_discard(
+		struct weston_presentation_feedback *feedback)
+{
+	presentation_feedback_send_discarded(feedback->resource);
+	wl_resource_destroy(feedback->resource);
+}
+
+static void
+weston_presentation_feedback_discard_list(struct wl_list *list)
+{
+	struct weston_presentation_feedback *feedback, *tmp;
+
+	wl_list_for_each_safe(feedback, tmp, list, link)
+		weston_presentation_feedback_discard(feedback);
+}
+
+/* Send the frame callbacks of a surface whose views a shell keeps out of
+ * the view list, e.g. because they are hidden below opaque views. Clients
+ * throttled on frame callbacks keep running while they are hidden. Their
+ * content is not presented, so presentation feedback is discarded.
+ */
+WL_EXPORT void
+weston_surface_send_frame_callbacks(struct weston_surface *surface,
+				    uint32_t msecs)
+{
+	struct weston_frame_callback *cb, *next;
+
+	wl_list_for_each_safe(cb, next, &surface->frame_callback_list, link) {
+		wl_callback_send_done(cb->resource, msecs);
+		wl_resource_destroy(cb->resource);
+	}
+
+	weston_presentation_feedback_discard_list(&surface->feedback_list);
+}
+
+static void
+weston_presentation_feedback_present(
+		struct weston_presentation_feedback *feedback,
+		struct weston_output *output,
+		uint32_t refresh_nsec,
+		const struct timespec *ts,
+		uint64_t seq,
+		uint32_t flags)
+{
+	struct wl_client *client = wl_resource_get_client(feedback->resource);
+	struct wl_resource *o;
+	uint64_t secs;
+
+	wl_resource_for_each(o, &output->resource_list) {
+		if (wl_resource_get_client(o) != client)
+			continue;
+
+		presentation_feedback_send_sync_output(feedback->resource, o);
+	}
+
+	secs = ts->tv_sec;
+	presentation_feedback_send_presented(feedback->resource,
+					     secs >> 32, secs & 0xffffffff,
+					     ts->tv_nsec,
+					     refresh_nsec,
+					     seq >> 32, seq & 0xffffffff,
+					     flags);
+	wl_resource_destroy(feedback->resource);
+}
+
+static void
+weston_presentation_feedback_present_list(struct wl_list *list,
+					  struct weston_output *output,
+					  uint32_t refresh_nsec,
+					  const struct timespec *ts,
+					  uint64_t seq,
+					  uint32_t flags)
+{
+	struct weston_presentation_feedback *feedback, *tmp;
+
+	wl_list_for_each_safe(feedback, tmp, list, link)
+		weston_presentation_feedback_present(feedback, output,
+						     refresh_nsec, ts, seq,
+						     flags);
+}
+
 WL_EXPORT void
 weston_view_destroy(struct weston_view *view)
 {
@@ -1372,6 +2023,7 @@ weston_view_destroy(struct weston_view *view)
 
 	wl_list_remove(&view->link);
 	wl_list_remove(&view->layer_link);
+	view->surface->compositor->pick_index.generation++;
 
 	pixman_region32_fini(&view->clip);
 	pixman_region32_fini(&view->transform.boundingbox);
@@ -1404,6 +2056,9 @@ weston_surface_destroy(struct weston_surface *surface)
 			      &surface->pending.frame_callback_list, link)
 		wl_resource_destroy(cb->resource);
 
+	weston_presentation_feedback_discard_list(
+					&surface->pending.feedback_list);
+
 	pixman_region32_fini(&surface->pending.input);
 	pixman_region32_fini(&surface->pending.opaque);
 	pixman_region32_fini(&surface->pending.damage);
@@ -1420,6 +2075,8 @@ weston_surface_destroy(struct weston_surface *surface)
 	wl_list_for_each_safe(cb, next, &surface->frame_callback_list, link)
 		wl_resource_destroy(cb->resource);
 
+	weston_presentation_feedback_discard_list(&surface->feedback_list);
+
 	free(surface);
 }
 
@@ -1595,17 +2252,24 @@ compositor_accumulate_damage(struct weston_compositor *ec)
 
 	pixman_region32_init(&clip);
 
+	/* Sort the views by plane in one pass, instead of walking the
+	 * whole view list once for every plane. */
+	wl_list_for_each(plane, &ec->plane_list, link)
+		wl_list_init(&plane->view_list);
+
+	wl_list_for_each(ev, &ec->view_list, link) {
+		if (ev->plane)
+			wl_list_insert(ev->plane->view_list.prev,
+				       &ev->plane_link);
+	}
+
 	wl_list_for_each(plane, &ec->plane_list, link) {
 		pixman_region32_copy(&plane->clip, &clip);
 
 		pixman_region32_init(&opaque);
 
-		wl_list_for_each(ev, &ec->view_list, link) {
-			if (ev->plane != plane)
-				continue;
-
+		wl_list_for_each(ev, &plane->view_list, plane_link)
 			view_accumulate_damage(ev, &opaque);
-		}
 
 		pixman_region32_union(&clip, &clip, &opaque);
 		pixman_region32_fini(&opaque);
@@ -1732,12 +2396,45 @@ view_list_add(struct weston_compositor *compositor,
 	}
 }
 
+/* The view list is what a build would give when no layer, no stacking
+ * and no transform was changed since the last build. Views of surfaces
+ * with subsurfaces are always rebuilt, for the subsurface order.
+ * Shells edit layers directly, so this is checked with one walk instead
+ * of tracking every change.
+ */
+static int
+view_list_is_current(struct weston_compositor *compositor)
+{
+	struct weston_view *view;
+	struct weston_layer *layer;
+	struct wl_list *next = compositor->view_list.next;
+
+	wl_list_for_each(layer, &compositor->layer_list, link) {
+		wl_list_for_each(view, &layer->view_list, layer_link) {
+			if (next != &view->link ||
+			    view->transform.dirty ||
+			    !wl_list_empty(&view->surface->subsurface_list))
+				return 0;
+			next = next->next;
+		}
+	}
+
+	return next == &compositor->view_list;
+}
+
 static void
 weston_compositor_build_view_list(struct weston_compositor *compositor)
 {
 	struct weston_view *view;
 	struct weston_layer *layer;
 
+	/* Outputs repainted in the same frame cycle share the list. */
+	if (view_list_is_current(compositor)) {
+		compositor->view_list_stats.kept++;
+		return;
+	}
+	compositor->view_list_stats.rebuilt++;
+
 	wl_list_for_each(layer, &compositor->layer_list, link)
 		wl_list_for_each(view, &layer->view_list, layer_link)
 			surface_stash_subsurface_views(view->surface);
@@ -1752,6 +2449,8 @@ weston_compositor_build_view_list(struct weston_compositor *compositor)
 	wl_list_for_each(layer, &compositor->layer_list, link)
 		wl_list_for_each(view, &layer->view_list, layer_link)
 			surface_free_unused_subsurface_views(view->surface);
+
+	pick_grid_check_view_list(compositor);
 }
 
 static int
@@ -1786,6 +2485,10 @@ weston_output_repaint(struct weston_output *output, uint32_t msecs)
 			wl_list_insert_list(&frame_callback_list,
 					    &ev->surface->frame_callback_list);
 			wl_list_init(&ev->surface->frame_callback_list);
+
+			wl_list_insert_list(&output->feedback_list,
+					    &ev->surface->feedback_list);
+			wl_list_init(&ev->surface->feedback_list);
 		}
 	}
 
@@ -1832,20 +2535,40 @@ weston_compositor_read_input(int fd, uint32_t mask, void *data)
 	return 1;
 }
 
+/* Called by the backend when the previous repaint hit the screen, or
+ * right away from start_repaint_loop. stamp is in the presentation clock
+ * of the compositor. Backends reporting PRESENTATION_FEEDBACK_KIND_VSYNC
+ * keep output->msc themselves; for the others it counts finished frames.
+ */
 WL_EXPORT void
-weston_output_finish_frame(struct weston_output *output, uint32_t msecs)
+weston_output_finish_frame(struct weston_output *output,
+			   const struct timespec *stamp,
+			   uint32_t presented_flags)
 {
 	struct weston_compositor *compositor = output->compositor;
 	struct wl_event_loop *loop =
 		wl_display_get_event_loop(compositor->wl_display);
+	uint32_t refresh_nsec = 0;
 	int fd, r;
 
-	output->frame_time = msecs;
+	if (!(presented_flags & PRESENTATION_FEEDBACK_KIND_VSYNC))
+		output->msc++;
+
+	/* mode refresh is in mHz */
+	if (output->current_mode && output->current_mode->refresh > 0)
+		refresh_nsec = 1000000000000ULL / output->current_mode->refresh;
+
+	weston_presentation_feedback_present_list(&output->feedback_list,
+						  output, refresh_nsec, stamp,
+						  output->msc, presented_flags);
+	wl_signal_emit(&output->present_signal, (void *) stamp);
+
+	output->frame_time = stamp->tv_sec * 1000 + stamp->tv_nsec / 1000000;
 
 	if (output->repaint_needed &&
 	    compositor->state != WESTON_COMPOSITOR_SLEEPING &&
 	    compositor->state != WESTON_COMPOSITOR_OFFSCREEN) {
-		r = weston_output_repaint(output, msecs);
+		r = weston_output_repaint(output, output->frame_time);
 		if (!r)
 			return;
 	}
@@ -2041,6 +2764,23 @@ weston_surface_commit_subsurface_order(struct weston_surface *surface)
 	}
 }
 
+static void
+surface_set_input(struct weston_surface *surface, pixman_region32_t *input)
+{
+	pixman_region32_t region;
+
+	pixman_region32_init_rect(&region, 0, 0,
+				  surface->width, surface->height);
+	pixman_region32_intersect(&region, &region, input);
+
+	if (!pixman_region32_equal(&region, &surface->input)) {
+		pixman_region32_copy(&surface->input, &region);
+		surface->compositor->pick_index.generation++;
+	}
+
+	pixman_region32_fini(&region);
+}
+
 static void
 weston_surface_commit(struct weston_surface *surface)
 {
@@ -2065,13 +2805,17 @@ weston_surface_commit(struct weston_surface *surface)
 	weston_surface_reset_pending_buffer(surface);
 
 	/* wl_surface.damage */
+	pixman_region32_intersect_rect(&surface->pending.damage,
+				       &surface->pending.damage,
+				       0, 0,
+				       surface->width,
+				       surface->height);
 	pixman_region32_union(&surface->damage, &surface->damage,
 			      &surface->pending.damage);
 	pixman_region32_intersect_rect(&surface->damage, &surface->damage,
 				       0, 0,
 				       surface->width,
 				       surface->height);
-	empty_region(&surface->pending.damage);
 
 	/* wl_surface.set_opaque_region */
 	pixman_region32_init_rect(&opaque, 0, 0,
@@ -2089,21 +2833,25 @@ weston_surface_commit(struct weston_surface *surface)
 	pixman_region32_fini(&opaque);
 
 	/* wl_surface.set_input_region */
-	pixman_region32_fini(&surface->input);
-	pixman_region32_init_rect(&surface->input, 0, 0,
-				  surface->width,
-				  surface->height);
-	pixman_region32_intersect(&surface->input,
-				  &surface->input, &surface->pending.input);
+	surface_set_input(surface, &surface->pending.input);
 
 	/* wl_surface.frame */
 	wl_list_insert_list(&surface->frame_callback_list,
 			    &surface->pending.frame_callback_list);
 	wl_list_init(&surface->pending.frame_callback_list);
 
+	/* presentation.feedback: content not yet presented is replaced */
+	weston_presentation_feedback_discard_list(&surface->feedback_list);
+	wl_list_insert_list(&surface->feedback_list,
+			    &surface->pending.feedback_list);
+	wl_list_init(&surface->pending.feedback_list);
+
 	weston_surface_commit_subsurface_order(surface);
 
 	weston_surface_schedule_repaint(surface);
+
+	wl_signal_emit(&surface->commit_signal, surface);
+	empty_region(&surface->pending.damage);
 }
 
 static void
@@ -2311,18 +3059,19 @@ weston_subsurface_commit_from_cache(struct weston_subsurface *sub)
 	pixman_region32_fini(&opaque);
 
 	/* wl_surface.set_input_region */
-	pixman_region32_fini(&surface->input);
-	pixman_region32_init_rect(&surface->input, 0, 0,
-				  surface->width,
-				  surface->height);
-	pixman_region32_intersect(&surface->input,
-				  &surface->input, &sub->cached.input);
+	surface_set_input(surface, &sub->cached.input);
 
 	/* wl_surface.frame */
 	wl_list_insert_list(&surface->frame_callback_list,
 			    &sub->cached.frame_callback_list);
 	wl_list_init(&sub->cached.frame_callback_list);
 
+	/* presentation.feedback */
+	weston_presentation_feedback_discard_list(&surface->feedback_list);
+	wl_list_insert_list(&surface->feedback_list,
+			    &sub->cached.feedback_list);
+	wl_list_init(&sub->cached.feedback_list);
+
 	weston_surface_commit_subsurface_order(surface);
 
 	weston_surface_schedule_repaint(surface);
@@ -2367,6 +3116,11 @@ weston_subsurface_commit_to_cache(struct weston_subsurface *sub)
 			    &surface->pending.frame_callback_list);
 	wl_list_init(&surface->pending.frame_callback_list);
 
+	weston_presentation_feedback_discard_list(&sub->cached.feedback_list);
+	wl_list_insert_list(&sub->cached.feedback_list,
+			    &surface->pending.feedback_list);
+	wl_list_init(&surface->pending.feedback_list);
+
 	sub->cached.has_data = 1;
 }
 
@@ -2635,6 +3389,7 @@ weston_subsurface_cache_init(struct weston_subsurface *sub)
 	pixman_region32_init(&sub->cached.opaque);
 	pixman_region32_init(&sub->cached.input);
 	wl_list_init(&sub->cached.frame_callback_list);
+	wl_list_init(&sub->cached.feedback_list);
 	sub->cached.buffer_ref.buffer = NULL;
 }
 
@@ -2646,6 +3401,8 @@ weston_subsurface_cache_fini(struct weston_subsurface *sub)
 	wl_list_for_each_safe(cb, tmp, &sub->cached.frame_callback_list, link)
 		wl_resource_destroy(cb->resource);
 
+	weston_presentation_feedback_discard_list(&sub->cached.feedback_list);
+
 	weston_buffer_reference(&sub->cached.buffer_ref, NULL);
 	pixman_region32_fini(&sub->cached.damage);
 	pixman_region32_fini(&sub->cached.opaque);
@@ -3005,6 +3762,7 @@ weston_plane_init(struct weston_plane *plane,
 	plane->x = x;
 	plane->y = y;
 	plane->compositor = ec;
+	wl_list_init(&plane->view_list);
 
 	/* Init the link so that the call to wl_list_remove() when releasing
 	 * the plane without ever stacking doesn't lead to a crash */
@@ -3118,6 +3876,8 @@ weston_output_destroy(struct weston_output *output)
 	wl_signal_emit(&output->compositor->output_destroyed_signal, output);
 	wl_signal_emit(&output->destroy_signal, output);
 
+	weston_presentation_feedback_discard_list(&output->feedback_list);
+
 	free(output->name);
 	pixman_region32_fini(&output->region);
 	pixman_region32_fini(&output->previous_damage);
@@ -3305,6 +4065,7 @@ weston_output_init(struct weston_output *output, struct weston_compositor *c,
 	output->mm_height = mm_height;
 	output->dirty = 1;
 	output->original_scale = scale;
+	output->plane_count = 1;
 
 	weston_output_transform_scale_init(output, transform, scale);
 	weston_output_init_zoom(output);
@@ -3313,9 +4074,11 @@ weston_output_init(struct weston_output *output, struct weston_compositor *c,
 	weston_output_damage(output);
 
 	wl_signal_init(&output->frame_signal);
+	wl_signal_init(&output->present_signal);
 	wl_signal_init(&output->destroy_signal);
 	wl_list_init(&output->animation_list);
 	wl_list_init(&output->resource_list);
+	wl_list_init(&output->feedback_list);
 
 	output->id = ffs(~output->compositor->output_id_pool) - 1;
 	output->compositor->output_id_pool |= 1 << output->id;
@@ -3585,6 +4348,82 @@ bind_scaler(struct wl_client *client,
 				       NULL, NULL);
 }
 
+static void
+presentation_destroy(struct wl_client *client, struct wl_resource *resource)
+{
+	wl_resource_destroy(resource);
+}
+
+static void
+destroy_presentation_feedback(struct wl_resource *feedback_resource)
+{
+	struct weston_presentation_feedback *feedback;
+
+	feedback = wl_resource_get_user_data(feedback_resource);
+
+	wl_list_remove(&feedback->link);
+	free(feedback);
+}
+
+static void
+presentation_feedback(struct wl_client *client,
+		      struct wl_resource *presentation_resource,
+		      struct wl_resource *surface_resource,
+		      uint32_t callback)
+{
+	struct weston_surface *surface;
+	struct weston_presentation_feedback *feedback;
+
+	surface = wl_resource_get_user_data(surface_resource);
+
+	feedback = zalloc(sizeof *feedback);
+	if (feedback == NULL)
+		goto err_calloc;
+
+	feedback->resource = wl_resource_create(client,
+					&presentation_feedback_interface,
+					1, callback);
+	if (!feedback->resource)
+		goto err_create;
+
+	wl_resource_set_implementation(feedback->resource, NULL, feedback,
+				       destroy_presentation_feedback);
+
+	wl_list_insert(&surface->pending.feedback_list, &feedback->link);
+
+	return;
+
+err_create:
+	free(feedback);
+
+err_calloc:
+	wl_client_post_no_memory(client);
+}
+
+static const struct presentation_interface presentation_implementation = {
+	presentation_destroy,
+	presentation_feedback
+};
+
+static void
+bind_presentation(struct wl_client *client,
+		  void *data, uint32_t version, uint32_t id)
+{
+	struct weston_compositor *compositor = data;
+	struct wl_resource *resource;
+
+	resource = wl_resource_create(client, &presentation_interface,
+				      MIN(version, 1), id);
+	if (resource == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(resource, &presentation_implementation,
+				       compositor, NULL);
+	presentation_send_clock_id(resource, compositor->presentation_clock);
+}
+
 static void
 compositor_bind(struct wl_client *client,
 		void *data, uint32_t version, uint32_t id)
@@ -3680,6 +4519,14 @@ weston_compositor_init(struct weston_compositor *ec,
 			      ec, bind_scaler))
 		return -1;
 
+	if (!wl_global_create(ec->wl_display, &presentation_interface, 1,
+			      ec, bind_presentation))
+		return -1;
+
+	/* Backends with hardware timestamps override this. */
+	if (weston_compositor_set_presentation_clock_software(ec) < 0)
+		return -1;
+
 	wl_list_init(&ec->view_list);
 	wl_list_init(&ec->plane_list);
 	wl_list_init(&ec->layer_list);
@@ -3754,6 +4601,8 @@ weston_compositor_shutdown(struct weston_compositor *ec)
 
 	weston_plane_release(&ec->primary_plane);
 
+	pick_grid_destroy(ec->pick_index.grid);
+
 	wl_event_loop_destroy(ec->input_loop);
 
 	weston_config_destroy(ec->config);
@@ -28,6 +28,7 @@
 extern "C" {
 #endif
 
+#include <time.h>
 #include <pixman.h>
 #include <xkbcommon/xkbcommon.h>
 
@@ -60,6 +61,7 @@ struct shell_surface;
 struct weston_seat;
 struct weston_output;
 struct input_method;
+struct pick_grid;
 
 enum weston_keyboard_modifier {
 	MODIFIER_CTRL = (1 << 0),
@@ -194,13 +196,20 @@ struct weston_output {
 	struct weston_output_zoom zoom;
 	int dirty;
 	struct wl_signal frame_signal;
+	struct wl_signal present_signal; /* data is the struct timespec stamp */
 	struct wl_signal destroy_signal;
 	struct wl_signal move_signal;
+	struct wl_list feedback_list; /* presentation feedback of the repaint */
 	int move_x, move_y;
-	uint32_t frame_time;
+	uint32_t frame_time; /* presentation timestamp in milliseconds */
+	uint64_t msc;        /* media stream counter */
 	int disable_planes;
 	int destroying;
 
+	/* number of hardware planes views can be put on, including the
+	 * primary plane; maintained by the backend */
+	uint32_t plane_count;
+
 	char *make, *model, *serial_number;
 	uint32_t subpixel;
 	uint32_t transform;
@@ -334,6 +343,14 @@ struct weston_pointer {
 	uint32_t button_count;
 
 	struct wl_listener output_destroy_listener;
+
+	/* state at the last compositor repick, to skip unchanged ones */
+	struct {
+		uint32_t generation;
+		wl_fixed_t x, y;
+		struct weston_pointer_grab *grab;
+		struct weston_view *focus;
+	} repick;
 };
 
 
@@ -537,6 +554,10 @@ struct weston_plane {
 	pixman_region32_t clip;
 	int32_t x, y;
 	struct wl_list link;
+
+	/* Views on this plane in view_list order, sorted out once per
+	 * repaint for damage accumulation; not valid outside it. */
+	struct wl_list view_list;
 };
 
 struct weston_renderer {
@@ -552,6 +573,9 @@ struct weston_renderer {
 			       float red, float green,
 			       float blue, float alpha);
 	void (*destroy)(struct weston_compositor *ec);
+	/* Optional. Frees the state of a surface with a buffer and returns
+	 * the bytes it allocated. It is created again at the next attach. */
+	size_t (*surface_release)(struct weston_surface *surface);
 };
 
 enum weston_capability {
@@ -606,6 +630,15 @@ struct weston_compositor {
 	struct wl_list seat_list;
 	struct wl_list layer_list;
 	struct wl_list view_list;
+	struct {
+		uint32_t rebuilt;	/* builds of view_list */
+		uint32_t kept;		/* builds finding view_list current */
+	} view_list_stats;
+	struct {
+		uint32_t generation;	/* bumped when a pick may change */
+		uint32_t built;		/* generation of the grid */
+		struct pick_grid *grid;
+	} pick_index;
 	struct wl_list plane_list;
 	struct wl_list key_binding_list;
 	struct wl_list modifier_binding_list;
@@ -637,6 +670,8 @@ struct weston_compositor {
 
 	uint32_t output_id_pool;
 
+	clockid_t presentation_clock;
+
 	struct xkb_rule_names xkb_names;
 	struct xkb_context *xkb_context;
 	struct weston_xkb_info *xkb_info;
@@ -733,6 +768,9 @@ struct weston_subsurface {
 		/* wl_surface.frame */
 		struct wl_list frame_callback_list;
 
+		/* presentation.feedback */
+		struct wl_list feedback_list;
+
 		/* wl_surface.set_buffer_transform */
 		/* wl_surface.set_buffer_scale */
 		struct weston_buffer_viewport buffer_viewport;
@@ -782,9 +820,10 @@ struct weston_view {
 	struct wl_list link;
 	struct wl_list layer_link;
 	struct weston_plane *plane;
+	struct wl_list plane_link;	/* weston_plane::view_list */
 
 	pixman_region32_t clip;
-	float alpha;                     /* part of geometry, see below */
+	float alpha;                     /* set with weston_view_set_alpha() */
 
 	void *renderer_state;
 
@@ -836,11 +875,29 @@ struct weston_view {
 	 * displayed on.
 	 */
 	uint32_t output_mask;
+
+	/*
+	 * Set by the shell to ask the backend to put this view on a
+	 * hardware plane whenever the buffer and transform allow it.
+	 */
+	int prefer_plane;
+
+	/*
+	 * Pixels of the key color are not drawn, so views below show
+	 * through them. Set with weston_view_set_chroma_key().
+	 */
+	struct {
+		int enabled;
+		uint32_t color; /* 0xRRGGBB */
+	} chroma_key;
 };
 
 struct weston_surface {
 	struct wl_resource *resource;
 	struct wl_signal destroy_signal;
+	/* Emitted at the end of weston_surface_commit(), while
+	 * pending.damage still holds the damage of the commit. */
+	struct wl_signal commit_signal;
 	struct weston_compositor *compositor;
 	pixman_region32_t damage;
 	pixman_region32_t opaque;        /* part of geometry, see below */
@@ -871,6 +928,7 @@ struct weston_surface {
 	uint32_t output_mask;
 
 	struct wl_list frame_callback_list;
+	struct wl_list feedback_list;
 
 	struct weston_buffer_reference buffer_ref;
 	struct weston_buffer_viewport buffer_viewport;
@@ -902,6 +960,9 @@ struct weston_surface {
 		/* wl_surface.frame */
 		struct wl_list frame_callback_list;
 
+		/* presentation.feedback */
+		struct wl_list feedback_list;
+
 		/* wl_surface.set_buffer_transform */
 		/* wl_surface.set_scaling_factor */
 		/* wl_viewport.set */
@@ -1030,7 +1091,9 @@ weston_compositor_stack_plane(struct weston_compositor *ec,
 			      struct weston_plane *above);
 
 void
-weston_output_finish_frame(struct weston_output *output, uint32_t msecs);
+weston_output_finish_frame(struct weston_output *output,
+			   const struct timespec *stamp,
+			   uint32_t presented_flags);
 void
 weston_output_schedule_repaint(struct weston_output *output);
 void
@@ -1167,6 +1230,13 @@ void
 weston_view_set_position(struct weston_view *view,
 			 float x, float y);
 
+void
+weston_view_set_alpha(struct weston_view *view, float alpha);
+
+void
+weston_view_set_chroma_key(struct weston_view *view, int enabled,
+			   uint32_t color);
+
 void
 weston_view_set_transform_parent(struct weston_view *view,
 				 struct weston_view *parent);
@@ -1184,6 +1254,18 @@ WL_EXPORT void
 weston_surface_set_size(struct weston_surface *surface,
 			int32_t width, int32_t height);
 
+void
+weston_surface_set_viewport_source(struct weston_surface *surface,
+				   wl_fixed_t src_x, wl_fixed_t src_y,
+				   wl_fixed_t src_width, wl_fixed_t src_height);
+
+size_t
+weston_surface_release_renderer_state(struct weston_surface *surface);
+
+void
+weston_surface_send_frame_callbacks(struct weston_surface *surface,
+				    uint32_t msecs);
+
 void
 weston_surface_schedule_repaint(struct weston_surface *surface);
 
@@ -1215,6 +1297,17 @@ weston_buffer_reference(struct weston_buffer_reference *ref,
 uint32_t
 weston_compositor_get_time(void);
 
+int
+weston_compositor_set_presentation_clock(struct weston_compositor *compositor,
+					 clockid_t clk_id);
+int
+weston_compositor_set_presentation_clock_software(
+					struct weston_compositor *compositor);
+void
+weston_compositor_read_presentation_clock(
+			const struct weston_compositor *compositor,
+			struct timespec *ts);
+
 int
 weston_compositor_init(struct weston_compositor *ec, struct wl_display *display,
 		       int *argc, char *argv[], struct weston_config *config);
@@ -45,7 +45,10 @@ struct gl_shader {
 	GLint tex_uniforms[3];
 	GLint alpha_uniform;
 	GLint color_uniform;
+	GLint chroma_key_uniform;
 	const char *vertex_source, *fragment_source;
+	int chroma_key;			/* variant discarding the key color */
+	struct gl_shader *keyed;	/* the chroma_key variant of this */
 };
 
 #define BUFFER_DAMAGE_COUNT 2
@@ -153,6 +156,12 @@ struct gl_renderer {
 	struct gl_shader texture_shader_y_uv;
 	struct gl_shader texture_shader_y_u_v;
 	struct gl_shader texture_shader_y_xuxv;
+	struct gl_shader texture_shader_rgba_keyed;
+	struct gl_shader texture_shader_rgbx_keyed;
+	struct gl_shader texture_shader_egl_external_keyed;
+	struct gl_shader texture_shader_y_uv_keyed;
+	struct gl_shader texture_shader_y_u_v_keyed;
+	struct gl_shader texture_shader_y_xuxv_keyed;
 	struct gl_shader invert_color_shader;
 	struct gl_shader solid_shader;
 	struct gl_shader *current_shader;
@@ -516,6 +525,12 @@ shader_uniforms(struct gl_shader *shader,
 	glUniform4fv(shader->color_uniform, 1, gs->color);
 	glUniform1f(shader->alpha_uniform, view->alpha);
 
+	if (shader->chroma_key)
+		glUniform3f(shader->chroma_key_uniform,
+			    ((view->chroma_key.color >> 16) & 0xff) / 255.0f,
+			    ((view->chroma_key.color >> 8) & 0xff) / 255.0f,
+			    (view->chroma_key.color & 0xff) / 255.0f);
+
 	for (i = 0; i < gs->num_textures; i++)
 		glUniform1i(shader->tex_uniforms[i], i);
 }
@@ -527,6 +542,7 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 	struct weston_compositor *ec = ev->surface->compositor;
 	struct gl_renderer *gr = get_renderer(ec);
 	struct gl_surface_state *gs = get_surface_state(ev->surface);
+	struct gl_shader *shader = gs->shader;
 	/* repaint bounding region in global coordinates: */
 	pixman_region32_t repaint;
 	/* non-opaque region in surface coordinates: */
@@ -537,9 +553,12 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 	/* In case of a runtime switch of renderers, we may not have received
 	 * an attach for this surface since the switch. In that case we don't
 	 * have a valid buffer or a proper shader set up so skip rendering. */
-	if (!gs->shader)
+	if (!shader)
 		return;
 
+	if (ev->chroma_key.enabled && shader->keyed)
+		shader = shader->keyed;
+
 	pixman_region32_init(&repaint);
 	pixman_region32_intersect(&repaint,
 				  &ev->transform.boundingbox, damage);
@@ -555,8 +574,8 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 		shader_uniforms(&gr->solid_shader, ev, output);
 	}
 
-	use_shader(gr, gs->shader);
-	shader_uniforms(gs->shader, ev, output);
+	use_shader(gr, shader);
+	shader_uniforms(shader, ev, output);
 
 	if (ev->transform.enabled || output->zoom.active ||
 	    output->current_scale != ev->surface->buffer_viewport.buffer.scale)
@@ -574,10 +593,13 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 	/* blended region is whole surface minus opaque region: */
 	pixman_region32_init_rect(&surface_blend, 0, 0,
 				  ev->surface->width, ev->surface->height);
-	pixman_region32_subtract(&surface_blend, &surface_blend, &ev->surface->opaque);
+	if (!ev->chroma_key.enabled)
+		pixman_region32_subtract(&surface_blend, &surface_blend,
+					 &ev->surface->opaque);
 
 	/* XXX: Should we be using ev->transform.opaque here? */
-	if (pixman_region32_not_empty(&ev->surface->opaque)) {
+	if (!ev->chroma_key.enabled &&
+	    pixman_region32_not_empty(&ev->surface->opaque)) {
 		if (gs->shader == &gr->texture_shader_rgba) {
 			/* Special case for RGBA textures with possibly
 			 * bad data in alpha channel: use the shader
@@ -597,7 +619,7 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 	}
 
 	if (pixman_region32_not_empty(&surface_blend)) {
-		use_shader(gr, gs->shader);
+		use_shader(gr, shader);
 		glEnable(GL_BLEND);
 		repaint_region(ev, &repaint, &surface_blend);
 	}
@@ -1053,6 +1075,28 @@ gl_renderer_flush_damage(struct weston_surface *surface)
 	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, gs->pitch);
 	data = wl_shm_buffer_get_data(buffer->shm_buffer);
 
+	if (gs->needs_full_upload &&
+	    surface->buffer_viewport.buffer.src_width != wl_fixed_from_int(-1)) {
+		/* Only the cropped part of the buffer is ever sampled, so
+		 * allocate the texture and upload that part alone. Texels
+		 * coming into the crop later are damaged by the crop change,
+		 * and uploaded from the buffer kept below. */
+		pixman_box32_t all = { 0, 0, surface->width, surface->height };
+		pixman_box32_t r = weston_surface_to_buffer_rect(surface, all);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, gs->gl_format,
+			     gs->pitch, buffer->height, 0,
+			     gs->gl_format, gs->gl_pixel_type, NULL);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, r.x1);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, r.y1);
+		wl_shm_buffer_begin_access(buffer->shm_buffer);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, r.x1, r.y1,
+				r.x2 - r.x1, r.y2 - r.y1,
+				gs->gl_format, gs->gl_pixel_type, data);
+		wl_shm_buffer_end_access(buffer->shm_buffer);
+		goto done;
+	}
+
 	if (gs->needs_full_upload) {
 		glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0);
 		glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0);
@@ -1085,6 +1129,12 @@ done:
 	pixman_region32_init(&gs->texture_damage);
 	gs->needs_full_upload = 0;
 
+	/* The texture may lack texels outside of the crop, and clients
+	 * need not commit again when the crop moves. */
+	if (gs->buffer_type == BUFFER_TYPE_SHM && gr->has_unpack_subimage &&
+	    surface->buffer_viewport.buffer.src_width != wl_fixed_from_int(-1))
+		return;
+
 	weston_buffer_reference(&gs->buffer_ref, NULL);
 }
 
@@ -1349,6 +1399,26 @@ surface_state_handle_renderer_destroy(struct wl_listener *listener, void *data)
 	surface_state_destroy(gs, gr);
 }
 
+static size_t
+gl_renderer_surface_release(struct weston_surface *surface)
+{
+	struct gl_surface_state *gs = surface->renderer_state;
+	size_t size = 0;
+
+	/* Solid color surfaces keep their state, it holds no texture. */
+	if (!gs || gs->buffer_type == BUFFER_TYPE_NULL)
+		return 0;
+
+	/* EGL images are the memory of the client's buffer. */
+	if (gs->buffer_type == BUFFER_TYPE_SHM)
+		size = gs->pitch * gs->height *
+			(gs->gl_pixel_type == GL_UNSIGNED_SHORT_5_6_5 ? 2 : 4);
+
+	surface_state_destroy(gs, get_renderer(surface->compositor));
+
+	return size;
+}
+
 static int
 gl_renderer_create_surface(struct weston_surface *surface)
 {
@@ -1413,6 +1483,15 @@ static const char vertex_shader[] =
 static const char fragment_debug[] =
 	"  gl_FragColor = vec4(0.0, 0.3, 0.0, 0.2) + gl_FragColor * 0.8;\n";
 
+/* Keyed pixels are made fully transparent. The key is compared to the
+ * color before it is multiplied by alpha, with a tolerance of about one
+ * step of 8 bit color channels. */
+static const char fragment_chroma_key[] =
+	"  if (all(lessThan(abs(gl_FragColor.rgb -\n"
+	"                       chroma_key * gl_FragColor.a),\n"
+	"                   vec3(0.006 * gl_FragColor.a))))\n"
+	"     gl_FragColor = vec4(0.0);\n";
+
 static const char fragment_brace[] =
 	"}\n";
 
@@ -1421,6 +1500,7 @@ static const char texture_fragment_shader_rgba[] =
 	"varying vec2 v_texcoord;\n"
 	"uniform sampler2D tex;\n"
 	"uniform float alpha;\n"
+	"uniform vec3 chroma_key;\n"
 	"void main()\n"
 	"{\n"
 	"   gl_FragColor = alpha * texture2D(tex, v_texcoord)\n;"
@@ -1431,6 +1511,7 @@ static const char texture_fragment_shader_rgbx[] =
 	"varying vec2 v_texcoord;\n"
 	"uniform sampler2D tex;\n"
 	"uniform float alpha;\n"
+	"uniform vec3 chroma_key;\n"
 	"void main()\n"
 	"{\n"
 	"   gl_FragColor.rgb = alpha * texture2D(tex, v_texcoord).rgb\n;"
@@ -1443,6 +1524,7 @@ static const char texture_fragment_shader_egl_external[] =
 	"varying vec2 v_texcoord;\n"
 	"uniform samplerExternalOES tex;\n"
 	"uniform float alpha;\n"
+	"uniform vec3 chroma_key;\n"
 	"void main()\n"
 	"{\n"
 	"   gl_FragColor = alpha * texture2D(tex, v_texcoord)\n;"
@@ -1454,6 +1536,7 @@ static const char texture_fragment_shader_y_uv[] =
 	"uniform sampler2D tex1;\n"
 	"varying vec2 v_texcoord;\n"
 	"uniform float alpha;\n"
+	"uniform vec3 chroma_key;\n"
 	"void main() {\n"
 	"  float y = 1.16438356 * (texture2D(tex, v_texcoord).x - 0.0625);\n"
 	"  float u = texture2D(tex1, v_texcoord).r - 0.5;\n"
@@ -1468,6 +1551,7 @@ static const char texture_fragment_shader_y_u_v[] =
 	"uniform sampler2D tex2;\n"
 	"varying vec2 v_texcoord;\n"
 	"uniform float alpha;\n"
+	"uniform vec3 chroma_key;\n"
 	"void main() {\n"
 	"  float y = 1.16438356 * (texture2D(tex, v_texcoord).x - 0.0625);\n"
 	"  float u = texture2D(tex1, v_texcoord).x - 0.5;\n"
@@ -1481,6 +1565,7 @@ static const char texture_fragment_shader_y_xuxv[] =
 	"uniform sampler2D tex1;\n"
 	"varying vec2 v_texcoord;\n"
 	"uniform float alpha;\n"
+	"uniform vec3 chroma_key;\n"
 	"void main() {\n"
 	"  float y = 1.16438356 * (texture2D(tex, v_texcoord).x - 0.0625);\n"
 	"  float u = texture2D(tex1, v_texcoord).g - 0.5;\n"
@@ -1523,22 +1608,18 @@ shader_init(struct gl_shader *shader, struct gl_renderer *renderer,
 {
 	char msg[512];
 	GLint status;
-	int count;
-	const char *sources[3];
+	int count = 0;
+	const char *sources[4];
 
 	shader->vertex_shader =
 		compile_shader(GL_VERTEX_SHADER, 1, &vertex_source);
 
-	if (renderer->fragment_shader_debug) {
-		sources[0] = fragment_source;
-		sources[1] = fragment_debug;
-		sources[2] = fragment_brace;
-		count = 3;
-	} else {
-		sources[0] = fragment_source;
-		sources[1] = fragment_brace;
-		count = 2;
-	}
+	sources[count++] = fragment_source;
+	if (shader->chroma_key)
+		sources[count++] = fragment_chroma_key;
+	if (renderer->fragment_shader_debug)
+		sources[count++] = fragment_debug;
+	sources[count++] = fragment_brace;
 
 	shader->fragment_shader =
 		compile_shader(GL_FRAGMENT_SHADER, count, sources);
@@ -1563,6 +1644,8 @@ shader_init(struct gl_shader *shader, struct gl_renderer *renderer,
 	shader->tex_uniforms[2] = glGetUniformLocation(shader->program, "tex2");
 	shader->alpha_uniform = glGetUniformLocation(shader->program, "alpha");
 	shader->color_uniform = glGetUniformLocation(shader->program, "color");
+	shader->chroma_key_uniform =
+		glGetUniformLocation(shader->program, "chroma_key");
 
 	return 0;
 }
@@ -1932,6 +2015,7 @@ gl_renderer_create(struct weston_compositor *ec, EGLNativeDisplayType display,
 	gr->base.attach = gl_renderer_attach;
 	gr->base.surface_set_color = gl_renderer_surface_set_color;
 	gr->base.destroy = gl_renderer_destroy;
+	gr->base.surface_release = gl_renderer_surface_release;
 
 	gr->egl_display = eglGetDisplay(display);
 	if (gr->egl_display == EGL_NO_DISPLAY) {
@@ -1974,6 +2058,15 @@ gl_renderer_display(struct weston_compositor *ec)
 	return get_renderer(ec)->egl_display;
 }
 
+static void
+init_keyed_shader(struct gl_shader *shader, struct gl_shader *keyed)
+{
+	keyed->vertex_source = shader->vertex_source;
+	keyed->fragment_source = shader->fragment_source;
+	keyed->chroma_key = 1;
+	shader->keyed = keyed;
+}
+
 static int
 compile_shaders(struct weston_compositor *ec)
 {
@@ -2003,6 +2096,19 @@ compile_shaders(struct weston_compositor *ec)
 	gr->solid_shader.vertex_source = vertex_shader;
 	gr->solid_shader.fragment_source = solid_fragment_shader;
 
+	init_keyed_shader(&gr->texture_shader_rgba,
+			  &gr->texture_shader_rgba_keyed);
+	init_keyed_shader(&gr->texture_shader_rgbx,
+			  &gr->texture_shader_rgbx_keyed);
+	init_keyed_shader(&gr->texture_shader_egl_external,
+			  &gr->texture_shader_egl_external_keyed);
+	init_keyed_shader(&gr->texture_shader_y_uv,
+			  &gr->texture_shader_y_uv_keyed);
+	init_keyed_shader(&gr->texture_shader_y_u_v,
+			  &gr->texture_shader_y_u_v_keyed);
+	init_keyed_shader(&gr->texture_shader_y_xuxv,
+			  &gr->texture_shader_y_xuxv_keyed);
+
 	return 0;
 }
 
@@ -2022,6 +2128,12 @@ fragment_debug_binding(struct weston_seat *seat, uint32_t time, uint32_t key,
 	shader_release(&gr->texture_shader_y_uv);
 	shader_release(&gr->texture_shader_y_u_v);
 	shader_release(&gr->texture_shader_y_xuxv);
+	shader_release(&gr->texture_shader_rgba_keyed);
+	shader_release(&gr->texture_shader_rgbx_keyed);
+	shader_release(&gr->texture_shader_egl_external_keyed);
+	shader_release(&gr->texture_shader_y_uv_keyed);
+	shader_release(&gr->texture_shader_y_u_v_keyed);
+	shader_release(&gr->texture_shader_y_xuxv_keyed);
 	shader_release(&gr->solid_shader);
 
 	/* Force use_shader() to call glUseProgram(), since we need to use
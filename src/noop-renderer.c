@@ -112,6 +112,7 @@ noop_renderer_init(struct weston_compositor *ec)
 	renderer->attach = noop_renderer_attach;
 	renderer->surface_set_color = noop_renderer_surface_set_color;
 	renderer->destroy = noop_renderer_destroy;
+	renderer->surface_release = NULL;
 	ec->renderer = renderer;
 
 	return 0;
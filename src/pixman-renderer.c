@@ -42,6 +42,12 @@ struct pixman_surface_state {
 	pixman_image_t *image;
 	struct weston_buffer_reference buffer_ref;
 
+	/* a8 mask of the buffer, 0 on pixels of the chroma key */
+	pixman_image_t *chroma_key_mask;
+	uint32_t chroma_key_color;
+	uint8_t chroma_key_alpha;
+	int chroma_key_dirty;
+
 	struct wl_listener buffer_destroy_listener;
 	struct wl_listener surface_destroy_listener;
 	struct wl_listener renderer_destroy_listener;
@@ -167,6 +173,63 @@ transform_apply_viewport(pixman_transform_t *transform,
 	pixman_transform_translate(transform, NULL, D2F(src_x), D2F(src_y));
 }
 
+/* Build, or reuse if the buffer content, key and alpha are the same, the
+ * mask which punches the chroma key of the view out of its buffer. Only
+ * 32 bit formats are supported. Must be called with the shm buffer
+ * accessed. */
+static pixman_image_t *
+get_chroma_key_mask(struct pixman_surface_state *ps, struct weston_view *ev)
+{
+	const uint32_t key = ev->chroma_key.color & 0xffffff;
+	const uint8_t alpha = 0xff * ev->alpha;
+	int width = pixman_image_get_width(ps->image);
+	int height = pixman_image_get_height(ps->image);
+	int stride = pixman_image_get_stride(ps->image);
+	uint8_t *bits = (uint8_t *) pixman_image_get_data(ps->image);
+	uint32_t *src;
+	uint8_t *dst;
+	int mask_stride;
+	int x, y;
+
+	if (PIXMAN_FORMAT_BPP(pixman_image_get_format(ps->image)) != 32)
+		return NULL;
+
+	if (ps->chroma_key_mask &&
+	    (pixman_image_get_width(ps->chroma_key_mask) != width ||
+	     pixman_image_get_height(ps->chroma_key_mask) != height)) {
+		pixman_image_unref(ps->chroma_key_mask);
+		ps->chroma_key_mask = NULL;
+	}
+
+	if (ps->chroma_key_mask && !ps->chroma_key_dirty &&
+	    ps->chroma_key_color == key && ps->chroma_key_alpha == alpha)
+		return ps->chroma_key_mask;
+
+	if (!ps->chroma_key_mask) {
+		ps->chroma_key_mask = pixman_image_create_bits(PIXMAN_a8,
+							       width, height,
+							       NULL, 0);
+		if (!ps->chroma_key_mask)
+			return NULL;
+	}
+
+	dst = (uint8_t *) pixman_image_get_data(ps->chroma_key_mask);
+	mask_stride = pixman_image_get_stride(ps->chroma_key_mask);
+
+	for (y = 0; y < height; y++) {
+		src = (uint32_t *) (bits + y * stride);
+		for (x = 0; x < width; x++)
+			dst[x] = (src[x] & 0xffffff) == key ? 0 : alpha;
+		dst += mask_stride;
+	}
+
+	ps->chroma_key_color = key;
+	ps->chroma_key_alpha = alpha;
+	ps->chroma_key_dirty = 0;
+
+	return ps->chroma_key_mask;
+}
+
 static void
 repaint_region(struct weston_view *ev, struct weston_output *output,
 	       pixman_region32_t *region, pixman_region32_t *surf_region,
@@ -180,6 +243,7 @@ repaint_region(struct weston_view *ev, struct weston_output *output,
 	pixman_region32_t final_region;
 	float view_x, view_y;
 	pixman_transform_t transform;
+	pixman_filter_t filter;
 	pixman_fixed_t fw, fh;
 	pixman_image_t *mask_image;
 	pixman_color_t mask = { 0, };
@@ -335,18 +399,27 @@ repaint_region(struct weston_view *ev, struct weston_output *output,
 	pixman_image_set_transform(ps->image, &transform);
 
 	if (ev->transform.enabled || output->current_scale != vp->buffer.scale)
-		pixman_image_set_filter(ps->image, PIXMAN_FILTER_BILINEAR, NULL, 0);
+		filter = PIXMAN_FILTER_BILINEAR;
 	else
-		pixman_image_set_filter(ps->image, PIXMAN_FILTER_NEAREST, NULL, 0);
+		filter = PIXMAN_FILTER_NEAREST;
+	pixman_image_set_filter(ps->image, filter, NULL, 0);
 
 	if (ps->buffer_ref.buffer)
 		wl_shm_buffer_begin_access(ps->buffer_ref.buffer->shm_buffer);
 
-	if (ev->alpha < 1.0) {
+	mask_image = NULL;
+	if (ev->chroma_key.enabled) {
+		mask_image = get_chroma_key_mask(ps, ev);
+		if (mask_image) {
+			pixman_image_ref(mask_image);
+			pixman_image_set_transform(mask_image, &transform);
+			pixman_image_set_filter(mask_image, filter, NULL, 0);
+		}
+	}
+
+	if (!mask_image && ev->alpha < 1.0) {
 		mask.alpha = 0xffff * ev->alpha;
 		mask_image = pixman_image_create_solid_fill(&mask);
-	} else {
-		mask_image = NULL;
 	}
 
 	pixman_image_composite32(pixman_op,
@@ -409,7 +482,7 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 	}
 
 	/* TODO: Implement repaint_region_complex() using pixman_composite_trapezoids() */
-	if (ev->alpha != 1.0 ||
+	if (ev->alpha != 1.0 || ev->chroma_key.enabled ||
 	    (ev->transform.enabled &&
 	     ev->transform.matrix.type != WESTON_MATRIX_TRANSFORM_TRANSLATE)) {
 		repaint_region(ev, output, &repaint, NULL, PIXMAN_OP_OVER);
@@ -491,7 +564,10 @@ pixman_renderer_repaint_output(struct weston_output *output,
 static void
 pixman_renderer_flush_damage(struct weston_surface *surface)
 {
-	/* No-op for pixman renderer */
+	struct pixman_surface_state *ps = get_surface_state(surface);
+
+	/* Nothing is uploaded, but the chroma key mask follows the buffer */
+	ps->chroma_key_dirty = 1;
 }
 
 static void
@@ -588,6 +664,8 @@ pixman_renderer_surface_state_destroy(struct pixman_surface_state *ps)
 		pixman_image_unref(ps->image);
 		ps->image = NULL;
 	}
+	if (ps->chroma_key_mask)
+		pixman_image_unref(ps->chroma_key_mask);
 	weston_buffer_reference(&ps->buffer_ref, NULL);
 	free(ps);
 }
@@ -641,6 +719,26 @@ pixman_renderer_create_surface(struct weston_surface *surface)
 	return 0;
 }
 
+static size_t
+pixman_renderer_surface_release(struct weston_surface *surface)
+{
+	struct pixman_surface_state *ps = surface->renderer_state;
+	size_t size = 0;
+
+	/* Solid color surfaces keep their state, it has no buffer. */
+	if (!ps || !ps->buffer_ref.buffer)
+		return 0;
+
+	/* The image is the memory of the client's buffer. */
+	if (ps->chroma_key_mask)
+		size = pixman_image_get_stride(ps->chroma_key_mask) *
+			pixman_image_get_height(ps->chroma_key_mask);
+
+	pixman_renderer_surface_state_destroy(ps);
+
+	return size;
+}
+
 static void
 pixman_renderer_surface_set_color(struct weston_surface *es,
 		 float red, float green, float blue, float alpha)
@@ -711,6 +809,7 @@ pixman_renderer_init(struct weston_compositor *ec)
 	renderer->base.attach = pixman_renderer_attach;
 	renderer->base.surface_set_color = pixman_renderer_surface_set_color;
 	renderer->base.destroy = pixman_renderer_destroy;
+	renderer->base.surface_release = pixman_renderer_surface_release;
 	ec->renderer = &renderer->base;
 	ec->capabilities |= WESTON_CAP_ROTATION_ANY;
 	ec->capabilities |= WESTON_CAP_CAPTURE_YFLIP;
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+#include "bench-helper.h"
+
+static struct bench_output *bench_output_hooked;
+
+uint64_t
+bench_cpu_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int
+compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+void
+bench_report_field(FILE *out, const char *name, uint64_t *samples, int n)
+{
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < n; i++)
+		sum += samples[i];
+	qsort(samples, n, sizeof *samples, compare_u64);
+
+	fprintf(out, ", \"%s_mean\": %llu, \"%s_p50\": %llu"
+		", \"%s_p99\": %llu, \"%s_max\": %llu",
+		name, (unsigned long long) (sum / n),
+		name, (unsigned long long) samples[n / 2],
+		name, (unsigned long long) samples[(n * 99) / 100],
+		name, (unsigned long long) samples[n - 1]);
+}
+
+int
+bench_output_hook(struct bench_output *hook,
+		  struct weston_compositor *compositor,
+		  int (*repaint)(struct weston_output *output,
+				 pixman_region32_t *damage),
+		  void (*assign_planes)(struct weston_output *output),
+		  void *data)
+{
+	struct weston_output *output;
+
+	assert(bench_output_hooked == NULL);
+
+	if (wl_list_empty(&compositor->output_list))
+		return -1;
+
+	output = container_of(compositor->output_list.next,
+			      struct weston_output, link);
+
+	hook->output = output;
+	hook->data = data;
+	hook->repaint = output->repaint;
+	output->repaint = repaint;
+	hook->assign_planes = output->assign_planes;
+	if (assign_planes)
+		output->assign_planes = assign_planes;
+	bench_output_hooked = hook;
+
+	return 0;
+}
+
+void
+bench_output_unhook(struct bench_output *hook)
+{
+	assert(bench_output_hooked == hook);
+
+	hook->output->repaint = hook->repaint;
+	hook->output->assign_planes = hook->assign_planes;
+	bench_output_hooked = NULL;
+}
+
+void *
+bench_output_data(struct weston_output *output)
+{
+	assert(bench_output_hooked && bench_output_hooked->output == output);
+
+	return bench_output_hooked->data;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef _BENCH_HELPER_H_
+#define _BENCH_HELPER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "../src/compositor.h"
+
+/* Helpers shared by the benchmarks running as compositor modules. */
+
+struct bench_output {
+	struct weston_output *output;
+	int (*repaint)(struct weston_output *output,
+		       pixman_region32_t *damage);
+	void (*assign_planes)(struct weston_output *output);
+	void *data;
+};
+
+uint64_t
+bench_cpu_time_ns(void);
+
+/* Sorts the n samples, and writes "<name>_mean", "_p50", "_p99" and
+ * "_max" of them as members of a JSON object. */
+void
+bench_report_field(FILE *out, const char *name, uint64_t *samples, int n);
+
+/* Replaces repaint and, unless assign_planes is NULL, assign_planes of
+ * the first output of the compositor. The replacements call the saved
+ * hooks, and get data through bench_output_data(), since output hooks
+ * have no user data. Only one output is hooked at a time.
+ * Returns -1 if the compositor has no output. */
+int
+bench_output_hook(struct bench_output *hook,
+		  struct weston_compositor *compositor,
+		  int (*repaint)(struct weston_output *output,
+				 pixman_region32_t *damage),
+		  void (*assign_planes)(struct weston_output *output),
+		  void *data);
+
+void
+bench_output_unhook(struct bench_output *hook);
+
+void *
+bench_output_data(struct weston_output *output);
+
+#endif
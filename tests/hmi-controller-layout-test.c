@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include "../ivi-shell/hmi-controller-layout.h"
+
+/*
+ * Correctness test of the hmi-controller layout geometry, run by make
+ * check. With --speed it also compares mode switches through the
+ * per-surface loop which looked every surface up in the list of UI
+ * widgets to the flagged surface list and the single geometry pass.
+ */
+
+#define WIDGET_COUNT 24
+#define LAYER_WIDTH 1920
+#define LAYER_HEIGHT 1080
+
+struct surface {
+	uint32_t id;
+	int32_t is_ui_widget;
+	int32_t x, y, width, height, visible;
+};
+
+static struct timespec begin_time;
+
+static void
+reset_timer(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &begin_time);
+}
+
+static double
+read_timer(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)(t.tv_sec - begin_time.tv_sec) +
+	       1e-9 * (t.tv_nsec - begin_time.tv_nsec);
+}
+
+static volatile sig_atomic_t running;
+
+static void
+stopme(int n)
+{
+	running = 0;
+}
+
+static int
+is_widget(const uint32_t *widgets, uint32_t id)
+{
+	int i;
+
+	for (i = 0; i < WIDGET_COUNT; i++)
+		if (widgets[i] == id)
+			return 1;
+
+	return 0;
+}
+
+/* the tiling mode as it was written before hmi_layout_compute_tiling */
+static void __attribute__((noinline))
+switch_tiling_scan(struct surface *surfaces, uint32_t n,
+		   const uint32_t *widgets)
+{
+	const float surface_width  = (float)LAYER_WIDTH * 0.25;
+	const float surface_height = (float)LAYER_HEIGHT * 0.5;
+	struct surface *s;
+	uint32_t num = 1;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		s = &surfaces[i];
+		if (is_widget(widgets, s->id))
+			continue;
+
+		if (num <= 8) {
+			if (num < 5) {
+				s->x = (int32_t)((num - 1) * surface_width);
+				s->y = 0;
+			} else {
+				s->x = (int32_t)((num - 5) * surface_width);
+				s->y = (int32_t)surface_height;
+			}
+			s->width = (int32_t)surface_width;
+			s->height = (int32_t)surface_height;
+			s->visible = 1;
+			num++;
+			continue;
+		}
+		s->visible = 0;
+	}
+}
+
+static void __attribute__((noinline))
+switch_tiling_pass(struct surface *surfaces, uint32_t n,
+		   struct surface **order, struct hmi_layout_geometry *geometry)
+{
+	int32_t count = 0;
+	int32_t i;
+
+	for (i = 0; i < (int32_t)n; i++)
+		if (!surfaces[i].is_ui_widget)
+			order[count++] = &surfaces[i];
+
+	if (hmi_layout_geometry_reserve(geometry, count) != 0)
+		abort();
+	hmi_layout_compute_tiling(geometry, LAYER_WIDTH, LAYER_HEIGHT);
+
+	for (i = 0; i < count; i++) {
+		order[i]->visible = geometry->visible[i];
+		if (!geometry->visible[i])
+			continue;
+		order[i]->x = geometry->x[i];
+		order[i]->y = geometry->y[i];
+		order[i]->width = geometry->width[i];
+		order[i]->height = geometry->height[i];
+	}
+}
+
+static void
+test_correctness(void)
+{
+	struct hmi_layout_geometry geometry;
+	int32_t i;
+	int ret;
+
+	hmi_layout_geometry_init(&geometry);
+	ret = hmi_layout_geometry_reserve(&geometry, 10);
+	assert(ret == 0);
+	assert(geometry.count == 10);
+
+	hmi_layout_compute_tiling(&geometry, LAYER_WIDTH, LAYER_HEIGHT);
+	for (i = 0; i < 10; i++) {
+		assert(geometry.visible[i] == (i < 8));
+		if (i >= 8)
+			continue;
+		assert(geometry.x[i] == (i % 4) * LAYER_WIDTH / 4);
+		assert(geometry.y[i] == (i / 4) * LAYER_HEIGHT / 2);
+		assert(geometry.width[i] == LAYER_WIDTH / 4);
+		assert(geometry.height[i] == LAYER_HEIGHT / 2);
+	}
+
+	hmi_layout_compute_sidebyside(&geometry, LAYER_WIDTH, LAYER_HEIGHT);
+	assert(geometry.visible[0] && geometry.visible[1]);
+	assert(geometry.x[0] == 0 && geometry.x[1] == LAYER_WIDTH / 2);
+	for (i = 2; i < 10; i++)
+		assert(!geometry.visible[i]);
+
+	hmi_layout_compute_fullscreen(&geometry, LAYER_WIDTH, LAYER_HEIGHT);
+	for (i = 0; i < 10; i++) {
+		assert(geometry.visible[i]);
+		assert(geometry.x[i] == 0 && geometry.y[i] == 0);
+		assert(geometry.width[i] == LAYER_WIDTH);
+		assert(geometry.height[i] == LAYER_HEIGHT);
+	}
+
+	hmi_layout_compute_random(&geometry, LAYER_WIDTH, LAYER_HEIGHT);
+	for (i = 0; i < 10; i++) {
+		assert(geometry.x[i] >= 0 &&
+		       geometry.x[i] + geometry.width[i] <= LAYER_WIDTH);
+		assert(geometry.y[i] >= 0 &&
+		       geometry.y[i] + geometry.height[i] <= LAYER_HEIGHT);
+	}
+
+	/* growing keeps working, shrinking keeps the memory */
+	ret = hmi_layout_geometry_reserve(&geometry, 1000);
+	assert(ret == 0);
+	assert(geometry.capacity >= 1000);
+	ret = hmi_layout_geometry_reserve(&geometry, 3);
+	assert(ret == 0);
+	assert(geometry.count == 3 && geometry.capacity >= 1000);
+
+	hmi_layout_geometry_release(&geometry);
+	assert(geometry.capacity == 0);
+
+	printf("hmi layout correctness: ok\n");
+}
+
+static void __attribute__((noinline))
+test_loop_speed(uint32_t n)
+{
+	struct surface *surfaces = calloc(n, sizeof *surfaces);
+	struct surface **order = calloc(n, sizeof *order);
+	struct hmi_layout_geometry geometry;
+	uint32_t widgets[WIDGET_COUNT];
+	unsigned long count;
+	uint32_t i;
+	double t;
+
+	assert(surfaces && order);
+	hmi_layout_geometry_init(&geometry);
+
+	for (i = 0; i < WIDGET_COUNT; i++)
+		widgets[i] = 1000 + i;
+
+	for (i = 0; i < n; i++) {
+		/* a widget among every eight surfaces */
+		surfaces[i].id = (i % 8) ? 0x10000 + i : 1000 + i / 8 % WIDGET_COUNT;
+		surfaces[i].is_ui_widget = is_widget(widgets, surfaces[i].id);
+	}
+
+	count = 0;
+	running = 1;
+	alarm(1);
+	reset_timer();
+	while (running) {
+		switch_tiling_scan(surfaces, n, widgets);
+		count++;
+	}
+	t = read_timer();
+	printf("%5u surfaces: widget scan %9.1f ns/switch, ",
+	       n, 1e9 * t / count);
+
+	count = 0;
+	running = 1;
+	alarm(1);
+	reset_timer();
+	while (running) {
+		switch_tiling_pass(surfaces, n, order, &geometry);
+		count++;
+	}
+	t = read_timer();
+	printf("geometry pass %9.1f ns/switch\n", 1e9 * t / count);
+
+	hmi_layout_geometry_release(&geometry);
+	free(order);
+	free(surfaces);
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t sizes[] = { 8, 64, 512, 4096 };
+	struct sigaction ding;
+	unsigned i;
+
+	test_correctness();
+
+	if (argc < 2 || strcmp(argv[1], "--speed") != 0)
+		return 0;
+
+	ding.sa_handler = stopme;
+	sigemptyset(&ding.sa_mask);
+	ding.sa_flags = 0;
+	sigaction(SIGALRM, &ding, NULL);
+
+	printf("\nRunning 1 s mode switch loops per size...\n");
+	for (i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+		test_loop_speed(sizes[i]);
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include "../shared/id-map.h"
+
+/*
+ * Correctness test of id_map, run by make check. With --speed it also
+ * compares lookups to the linear list scan which ivi-layout used to
+ * resolve surface and layer ids.
+ */
+
+struct object {
+	uint32_t id;
+	struct object *next;
+};
+
+static struct timespec begin_time;
+
+static void
+reset_timer(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &begin_time);
+}
+
+static double
+read_timer(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)(t.tv_sec - begin_time.tv_sec) +
+	       1e-9 * (t.tv_nsec - begin_time.tv_nsec);
+}
+
+static volatile sig_atomic_t running;
+
+static void
+stopme(int n)
+{
+	running = 0;
+}
+
+static struct object *
+list_lookup(struct object *head, uint32_t id)
+{
+	struct object *obj;
+
+	for (obj = head; obj; obj = obj->next)
+		if (obj->id == id)
+			return obj;
+
+	return NULL;
+}
+
+static void
+test_correctness(void)
+{
+	struct id_map map;
+	struct object objs[1000];
+	void *found;
+	uint32_t i;
+	int ret;
+
+	id_map_init(&map);
+
+	for (i = 0; i < 1000; i++) {
+		objs[i].id = i * 7 + 1000;
+		ret = id_map_insert(&map, objs[i].id, &objs[i]);
+		assert(ret == 0);
+	}
+	assert(map.count == 1000);
+	ret = id_map_insert(&map, objs[10].id, &objs[10]);
+	assert(ret < 0);
+
+	for (i = 0; i < 1000; i++) {
+		found = id_map_lookup(&map, objs[i].id);
+		assert(found == &objs[i]);
+	}
+	found = id_map_lookup(&map, 1);
+	assert(found == NULL);
+
+	/* remove every other entry, the rest must still be reachable */
+	for (i = 0; i < 1000; i += 2) {
+		found = id_map_remove(&map, objs[i].id);
+		assert(found == &objs[i]);
+	}
+	found = id_map_remove(&map, objs[0].id);
+	assert(found == NULL);
+
+	for (i = 0; i < 1000; i++) {
+		found = id_map_lookup(&map, objs[i].id);
+		assert(found == (i % 2 ? &objs[i] : NULL));
+	}
+
+	id_map_release(&map);
+	found = id_map_lookup(&map, objs[1].id);
+	assert(found == NULL);
+
+	printf("id_map correctness: ok\n");
+}
+
+static void __attribute__((noinline))
+test_loop_speed(uint32_t n)
+{
+	struct object *objs = calloc(n, sizeof *objs);
+	struct object *head = NULL;
+	struct id_map map;
+	unsigned long count;
+	uint32_t i;
+	double t;
+
+	assert(objs);
+	id_map_init(&map);
+
+	for (i = 0; i < n; i++) {
+		/* ivi ids are sparse, e.g. 0x10000 + n */
+		objs[i].id = 0x10000 * (i % 16) + i;
+		objs[i].next = head;
+		head = &objs[i];
+		id_map_insert(&map, objs[i].id, &objs[i]);
+	}
+
+	count = 0;
+	running = 1;
+	alarm(1);
+	reset_timer();
+	while (running) {
+		if (list_lookup(head, objs[count % n].id) == NULL)
+			abort();
+		count++;
+	}
+	t = read_timer();
+	printf("%6u objects: list scan %10.1f ns/lookup, ",
+	       n, 1e9 * t / count);
+
+	count = 0;
+	running = 1;
+	alarm(1);
+	reset_timer();
+	while (running) {
+		if (id_map_lookup(&map, objs[count % n].id) == NULL)
+			abort();
+		count++;
+	}
+	t = read_timer();
+	printf("id_map %6.1f ns/lookup\n", 1e9 * t / count);
+
+	id_map_release(&map);
+	free(objs);
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t sizes[] = { 10, 100, 1000, 10000 };
+	struct sigaction ding;
+	unsigned i;
+
+	test_correctness();
+
+	if (argc < 2 || strcmp(argv[1], "--speed") != 0)
+		return 0;
+
+	ding.sa_handler = stopme;
+	sigemptyset(&ding.sa_mask);
+	ding.sa_flags = 0;
+	sigaction(SIGALRM, &ding, NULL);
+
+	printf("\nRunning 1 s lookup loops per size...\n");
+	for (i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+		test_loop_speed(sizes[i]);
+
+	return 0;
+}
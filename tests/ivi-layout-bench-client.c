@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Client of ivi-layout-bench. It creates IVI_BENCH_SURFACE_COUNT ivi
+ * surfaces with consecutive ids from IVI_BENCH_SURFACE_ID_BASE, all showing
+ * one synthetic shm buffer, and stays connected until the compositor quits.
+ * With IVI_BENCH_OPAQUE set, the surfaces are opaque. With
+ * IVI_BENCH_FRAME_CALLBACKS set, each surface commits again whenever its
+ * frame callback is done, like a client throttled on frame callbacks.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <wayland-client.h>
+#include "../shared/os-compatibility.h"
+#include "ivi-application-client-protocol.h"
+
+#define BUFFER_WIDTH 256
+#define BUFFER_HEIGHT 256
+
+struct display {
+	struct wl_display *display;
+	struct wl_registry *registry;
+	struct wl_compositor *compositor;
+	struct wl_shm *shm;
+	struct ivi_application *ivi_application;
+};
+
+static void
+registry_handle_global(void *data, struct wl_registry *registry,
+		       uint32_t id, const char *interface, uint32_t version)
+{
+	struct display *d = data;
+
+	if (strcmp(interface, "wl_compositor") == 0) {
+		d->compositor =
+			wl_registry_bind(registry,
+					 id, &wl_compositor_interface, 1);
+	} else if (strcmp(interface, "wl_shm") == 0) {
+		d->shm = wl_registry_bind(registry,
+					  id, &wl_shm_interface, 1);
+	} else if (strcmp(interface, "ivi_application") == 0) {
+		d->ivi_application =
+			wl_registry_bind(registry, id,
+					 &ivi_application_interface, 1);
+	}
+}
+
+static void
+registry_handle_global_remove(void *data, struct wl_registry *registry,
+			      uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+	registry_handle_global,
+	registry_handle_global_remove
+};
+
+static const struct wl_callback_listener frame_listener;
+
+static void
+request_frame(struct wl_surface *surface)
+{
+	struct wl_callback *callback;
+
+	callback = wl_surface_frame(surface);
+	wl_callback_add_listener(callback, &frame_listener, surface);
+}
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct wl_surface *surface = data;
+
+	wl_callback_destroy(callback);
+	request_frame(surface);
+	wl_surface_commit(surface);
+}
+
+static const struct wl_callback_listener frame_listener = {
+	frame_done
+};
+
+static struct wl_buffer *
+create_buffer(struct display *display)
+{
+	struct wl_shm_pool *pool;
+	struct wl_buffer *buffer;
+	int fd, size, stride;
+	uint32_t *pixels;
+	int x, y;
+
+	stride = BUFFER_WIDTH * 4;
+	size = stride * BUFFER_HEIGHT;
+
+	fd = os_create_anonymous_file(size);
+	if (fd < 0) {
+		fprintf(stderr, "creating a buffer file for %d B failed: %m\n",
+			size);
+		return NULL;
+	}
+
+	pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (pixels == MAP_FAILED) {
+		fprintf(stderr, "mmap failed: %m\n");
+		close(fd);
+		return NULL;
+	}
+
+	/* Checkerboard, so that renderers have to sample something. */
+	for (y = 0; y < BUFFER_HEIGHT; y++)
+		for (x = 0; x < BUFFER_WIDTH; x++)
+			pixels[y * BUFFER_WIDTH + x] =
+				((x ^ y) & 16) ? 0xff3060a0 : 0xffc0c0c0;
+	munmap(pixels, size);
+
+	pool = wl_shm_create_pool(display->shm, fd, size);
+	buffer = wl_shm_pool_create_buffer(pool, 0,
+					   BUFFER_WIDTH, BUFFER_HEIGHT,
+					   stride, WL_SHM_FORMAT_XRGB8888);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+
+	return buffer;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct display display = { 0 };
+	struct wl_buffer *buffer;
+	struct wl_surface *surface;
+	struct wl_region *region;
+	const char *s;
+	uint32_t id_base;
+	int count, i;
+	int opaque, frames;
+
+	s = getenv("IVI_BENCH_SURFACE_COUNT");
+	count = s ? atoi(s) : 0;
+	s = getenv("IVI_BENCH_SURFACE_ID_BASE");
+	id_base = s ? strtoul(s, NULL, 0) : 0;
+	opaque = getenv("IVI_BENCH_OPAQUE") != NULL;
+	frames = getenv("IVI_BENCH_FRAME_CALLBACKS") != NULL;
+	if (count <= 0 || id_base == 0) {
+		fprintf(stderr, "ivi-layout-bench-client: run by "
+			"ivi-layout-bench\n");
+		return EXIT_FAILURE;
+	}
+
+	display.display = wl_display_connect(NULL);
+	if (display.display == NULL) {
+		fprintf(stderr, "failed to connect: %m\n");
+		return EXIT_FAILURE;
+	}
+
+	display.registry = wl_display_get_registry(display.display);
+	wl_registry_add_listener(display.registry, &registry_listener,
+				 &display);
+	wl_display_roundtrip(display.display);
+
+	if (!display.compositor || !display.shm || !display.ivi_application) {
+		fprintf(stderr, "ivi-layout-bench-client: missing globals\n");
+		return EXIT_FAILURE;
+	}
+
+	buffer = create_buffer(&display);
+	if (buffer == NULL)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < count; i++) {
+		surface = wl_compositor_create_surface(display.compositor);
+		ivi_application_surface_create(display.ivi_application,
+					       id_base + i, surface);
+		wl_surface_attach(surface, buffer, 0, 0);
+		wl_surface_damage(surface, 0, 0, BUFFER_WIDTH, BUFFER_HEIGHT);
+		if (opaque) {
+			region = wl_compositor_create_region(
+				display.compositor);
+			wl_region_add(region, 0, 0,
+				      BUFFER_WIDTH, BUFFER_HEIGHT);
+			wl_surface_set_opaque_region(surface, region);
+			wl_region_destroy(region);
+		}
+		if (frames)
+			request_frame(surface);
+		wl_surface_commit(surface);
+	}
+
+	while (wl_display_dispatch(display.display) != -1)
+		;
+
+	return EXIT_SUCCESS;
+}
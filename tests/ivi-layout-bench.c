@@ -0,0 +1,572 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Benchmark of ivi-layout on the headless backend, loaded by ivi-shell as
+ * an ivi-module. It launches ivi-layout-bench-client, which creates
+ * layers * surfaces-per-layer ivi surfaces with shm buffers, puts them on
+ * the layers and runs scripted controller workloads, one commit and one
+ * repaint per frame. One line of JSON is written per workload.
+ *
+ * Run by tests/ivi-layout-bench-env, configured by environment:
+ *   IVI_BENCH_CLIENT             path of ivi-layout-bench-client
+ *   IVI_BENCH_LAYERS             number of layers (4)
+ *   IVI_BENCH_SURFACES           surfaces per layer (16)
+ *   IVI_BENCH_FRAMES             frames per workload (120)
+ *   IVI_BENCH_RESULTS            output file (stdout)
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <malloc.h>
+#include <sys/wait.h>
+
+#include "../src/compositor.h"
+#include "../ivi-shell/ivi-layout-export.h"
+#include "../ivi-shell/hmi-controller-layout.h"
+#include "bench-helper.h"
+
+#define BENCH_SURFACE_ID_BASE 0x10000
+#define BENCH_LAYER_ID_BASE 0x20000
+
+struct bench;
+
+struct bench_workload {
+	const char *name;
+	void (*frame)(struct bench *bench, int32_t frame);
+};
+
+struct bench_sample {
+	uint64_t apply_ns;	/* property setters of the frame */
+	uint64_t commit_ns;	/* ivi_layout_commitChanges */
+	uint64_t repaint_ns;	/* from the commit to the end of repaint */
+	int64_t commit_heap;	/* heap growth by setters and commit */
+	int64_t repaint_heap;	/* heap growth until the end of repaint */
+};
+
+struct bench {
+	struct weston_compositor *compositor;
+	struct wl_event_loop *loop;
+	struct weston_process process;
+	struct wl_client *client;
+	FILE *results;
+
+	struct weston_output *output;
+	struct bench_output hook;
+
+	int32_t layer_count;
+	int32_t surfaces_per_layer;
+	int32_t surface_count;
+	int32_t frame_count;
+
+	struct ivi_layout_screen *iviscrn;
+	int32_t screen_width;
+	int32_t screen_height;
+	struct ivi_layout_layer **layers;
+	struct ivi_layout_surface **surfaces;	/* by surface id */
+	struct ivi_layout_surface **order;	/* scratch render orders */
+	struct ivi_layout_layer **layer_order;
+	int32_t configured;
+
+	struct hmi_layout_geometry geometry;
+	struct ivi_layout_SurfaceProperties *properties;
+
+	const struct bench_workload *workload;
+	int32_t frame;
+	struct bench_sample *samples;
+	uint64_t *sorted;
+	struct ivi_layout_commit_statistics statistics;
+	uint32_t view_list_rebuilt;	/* compositor counters at start */
+	uint32_t view_list_kept;
+	uint64_t repaint_begin;
+	int64_t heap_begin;
+	int waiting_repaint;
+	int done;
+};
+
+/* mallinfo() is deprecated since glibc 2.33, and its int counters wrap
+ * with large heaps. */
+static int64_t
+heap_in_use(void)
+{
+#ifdef HAVE_MALLINFO2
+	return (int64_t) mallinfo2().uordblks;
+#else
+	return mallinfo().uordblks;
+#endif
+}
+
+static int32_t
+getenv_int(const char *name, int32_t value)
+{
+	const char *s = getenv(name);
+	char *end;
+	long l;
+
+	if (s == NULL)
+		return value;
+
+	l = strtol(s, &end, 10);
+	if (*end != '\0' || l <= 0 || l > 100000) {
+		weston_log("ivi-layout-bench: ignoring %s=%s\n", name, s);
+		return value;
+	}
+
+	return l;
+}
+
+static void
+mode_switch_frame(struct bench *bench, int32_t frame)
+{
+	struct hmi_layout_geometry *geometry = &bench->geometry;
+	struct ivi_layout_SurfaceProperties *prop;
+	int32_t l, i;
+
+	switch (frame % 4) {
+	case 0:
+		hmi_layout_compute_tiling(geometry, bench->screen_width,
+					  bench->screen_height);
+		break;
+	case 1:
+		hmi_layout_compute_sidebyside(geometry, bench->screen_width,
+					      bench->screen_height);
+		break;
+	case 2:
+		hmi_layout_compute_fullscreen(geometry, bench->screen_width,
+					      bench->screen_height);
+		break;
+	default:
+		hmi_layout_compute_random(geometry, bench->screen_width,
+					  bench->screen_height);
+		break;
+	}
+
+	for (l = 0; l < bench->layer_count; l++) {
+		prop = bench->properties + l * bench->surfaces_per_layer;
+		for (i = 0; i < geometry->count; i++) {
+			prop[i].destX = geometry->x[i];
+			prop[i].destY = geometry->y[i];
+			prop[i].destWidth = geometry->width[i];
+			prop[i].destHeight = geometry->height[i];
+			prop[i].visibility = geometry->visible[i];
+		}
+	}
+
+	ivi_layout_surfaceSetPropertiesArray(bench->surfaces,
+					     bench->properties,
+					     bench->surface_count,
+					     IVI_NOTIFICATION_DEST_RECT |
+					     IVI_NOTIFICATION_VISIBILITY);
+}
+
+static void
+workspace_swipe_frame(struct bench *bench, int32_t frame)
+{
+	/* Swipe over one screen width in 30 frames, then back. */
+	int32_t step = frame % 60;
+	int32_t pos[2] = { 0, 0 };
+	int32_t l;
+
+	if (step >= 30)
+		step = 60 - step;
+	pos[0] = -bench->screen_width * step / 30;
+
+	for (l = 0; l < bench->layer_count; l++)
+		ivi_layout_layerSetPosition(bench->layers[l], pos);
+}
+
+static void
+fade_frame(struct bench *bench, int32_t frame)
+{
+	/* Fade out in 20 frames, then in again. */
+	int32_t step = frame % 40;
+	float opacity;
+	int32_t l;
+
+	if (step >= 20)
+		step = 40 - step;
+	opacity = 1.0f - step / 20.0f;
+
+	for (l = 0; l < bench->layer_count; l++)
+		ivi_layout_layerSetOpacity(bench->layers[l], opacity);
+}
+
+static void
+shuffle_frame(struct bench *bench, int32_t frame)
+{
+	struct ivi_layout_surface **surfaces;
+	int32_t n = bench->surfaces_per_layer;
+	int32_t l, i;
+
+	for (l = 0; l < bench->layer_count; l++) {
+		surfaces = bench->surfaces + l * n;
+		for (i = 0; i < n; i++)
+			bench->order[i] = surfaces[(i + frame + 1) % n];
+		ivi_layout_layerSetRenderOrder(bench->layers[l],
+					       bench->order, n);
+	}
+
+	for (l = 0; l < bench->layer_count; l++) {
+		bench->layer_order[l] =
+			bench->layers[(l + frame + 1) % bench->layer_count];
+	}
+	ivi_layout_screenSetRenderOrder(bench->iviscrn, bench->layer_order,
+					bench->layer_count);
+}
+
+static const struct bench_workload workloads[] = {
+	{ "mode-switch", mode_switch_frame },
+	{ "workspace-swipe", workspace_swipe_frame },
+	{ "fade", fade_frame },
+	{ "render-order-shuffle", shuffle_frame },
+	{ NULL, NULL }
+};
+
+/* Reports one field of the samples of the workload. */
+static void
+report_field(struct bench *bench, const char *name, size_t offset)
+{
+	int32_t i;
+
+	for (i = 0; i < bench->frame_count; i++)
+		bench->sorted[i] = *(uint64_t *)
+			((char *) &bench->samples[i] + offset);
+
+	bench_report_field(bench->results, name, bench->sorted,
+			   bench->frame_count);
+}
+
+static void
+bench_begin_statistics(struct bench *bench)
+{
+	ivi_layout_getCommitStatistics(&bench->statistics);
+	bench->view_list_rebuilt = bench->compositor->view_list_stats.rebuilt;
+	bench->view_list_kept = bench->compositor->view_list_stats.kept;
+}
+
+static void
+report_workload(struct bench *bench)
+{
+	struct ivi_layout_commit_statistics statistics;
+	int64_t commit_heap = 0, repaint_heap = 0;
+	int32_t i;
+
+	ivi_layout_getCommitStatistics(&statistics);
+
+	for (i = 0; i < bench->frame_count; i++) {
+		commit_heap += bench->samples[i].commit_heap;
+		repaint_heap += bench->samples[i].repaint_heap;
+	}
+
+	fprintf(bench->results,
+		"{\"benchmark\": \"ivi-layout\", \"version\": \"%s\""
+		", \"workload\": \"%s\", \"layers\": %d"
+		", \"surfaces_per_layer\": %d, \"frames\": %d",
+		PACKAGE_VERSION, bench->workload->name, bench->layer_count,
+		bench->surfaces_per_layer, bench->frame_count);
+	report_field(bench, "apply_ns",
+		     offsetof(struct bench_sample, apply_ns));
+	report_field(bench, "commit_ns",
+		     offsetof(struct bench_sample, commit_ns));
+	report_field(bench, "repaint_ns",
+		     offsetof(struct bench_sample, repaint_ns));
+	fprintf(bench->results,
+		", \"commit_heap_bytes_per_frame\": %lld"
+		", \"repaint_heap_bytes_per_frame\": %lld"
+		", \"commits_executed\": %u, \"commits_skipped\": %u"
+		", \"view_list_rebuilt\": %u, \"view_list_kept\": %u",
+		(long long) (commit_heap / bench->frame_count),
+		(long long) (repaint_heap / bench->frame_count),
+		statistics.executed - bench->statistics.executed,
+		statistics.skipped - bench->statistics.skipped,
+		statistics.view_list_rebuilt -
+		bench->statistics.view_list_rebuilt,
+		statistics.view_list_kept - bench->statistics.view_list_kept);
+	fprintf(bench->results,
+		", \"compositor_view_list_rebuilt\": %u"
+		", \"compositor_view_list_kept\": %u}\n",
+		bench->compositor->view_list_stats.rebuilt -
+		bench->view_list_rebuilt,
+		bench->compositor->view_list_stats.kept -
+		bench->view_list_kept);
+	fflush(bench->results);
+}
+
+static void
+bench_finish(struct bench *bench)
+{
+	bench->done = 1;
+	if (bench->results != stdout)
+		fclose(bench->results);
+	bench->results = NULL;
+
+	wl_display_terminate(bench->compositor->wl_display);
+}
+
+static void
+run_frame(void *data)
+{
+	struct bench *bench = data;
+	struct bench_sample *sample;
+	uint64_t begin, applied;
+	int64_t heap;
+
+	if (bench->frame == bench->frame_count) {
+		report_workload(bench);
+		bench->workload++;
+		bench->frame = 0;
+		if (bench->workload->name == NULL) {
+			bench_finish(bench);
+			return;
+		}
+		bench_begin_statistics(bench);
+	}
+
+	sample = &bench->samples[bench->frame];
+
+	heap = heap_in_use();
+	begin = bench_cpu_time_ns();
+	bench->workload->frame(bench, bench->frame);
+	applied = bench_cpu_time_ns();
+	ivi_layout_commitChanges();
+	bench->repaint_begin = bench_cpu_time_ns();
+	bench->heap_begin = heap_in_use();
+
+	sample->apply_ns = applied - begin;
+	sample->commit_ns = bench->repaint_begin - applied;
+	sample->commit_heap = bench->heap_begin - heap;
+
+	bench->waiting_repaint = 1;
+	weston_output_schedule_repaint(bench->output);
+}
+
+static int
+bench_output_repaint(struct weston_output *output,
+		     pixman_region32_t *damage)
+{
+	struct bench *bench = bench_output_data(output);
+	struct bench_sample *sample;
+	int ret;
+
+	ret = bench->hook.repaint(output, damage);
+
+	if (bench->waiting_repaint) {
+		sample = &bench->samples[bench->frame];
+		sample->repaint_ns =
+			bench_cpu_time_ns() - bench->repaint_begin;
+		sample->repaint_heap = heap_in_use() - bench->heap_begin;
+
+		bench->waiting_repaint = 0;
+		bench->frame++;
+		wl_event_loop_add_idle(bench->loop, run_frame, bench);
+	}
+
+	return ret;
+}
+
+static void
+setup_scene(void *data)
+{
+	struct bench *bench = data;
+	struct ivi_layout_screen **screens = NULL;
+	struct ivi_layout_surface **surfaces;
+	int32_t screen_count = 0;
+	int32_t l;
+
+	ivi_layout_getScreens(&screen_count, &screens);
+	if (screen_count < 1) {
+		weston_log("ivi-layout-bench: no screen\n");
+		free(screens);
+		bench_finish(bench);
+		return;
+	}
+	bench->iviscrn = screens[0];
+	free(screens);
+
+	ivi_layout_getScreenResolution(bench->iviscrn, &bench->screen_width,
+				       &bench->screen_height);
+
+	for (l = 0; l < bench->layer_count; l++) {
+		bench->layers[l] = ivi_layout_layerCreateWithDimension(
+					BENCH_LAYER_ID_BASE + l,
+					bench->screen_width,
+					bench->screen_height);
+		if (bench->layers[l] == NULL) {
+			weston_log("ivi-layout-bench: failed to create layer\n");
+			bench_finish(bench);
+			return;
+		}
+
+		surfaces = bench->surfaces + l * bench->surfaces_per_layer;
+		ivi_layout_layerSetRenderOrder(bench->layers[l], surfaces,
+					       bench->surfaces_per_layer);
+		ivi_layout_layerSetVisibility(bench->layers[l], 1);
+		ivi_layout_screenAddLayer(bench->iviscrn, bench->layers[l]);
+	}
+
+	/* Start from tiles, as hmi-controller does. */
+	mode_switch_frame(bench, 0);
+	ivi_layout_commitChanges();
+
+	bench_begin_statistics(bench);
+	bench->workload = workloads;
+	bench->frame = 0;
+	wl_event_loop_add_idle(bench->loop, run_frame, bench);
+}
+
+static void
+surface_configured(struct ivi_layout_surface *ivisurf, void *userdata)
+{
+	struct bench *bench = userdata;
+	uint32_t id = ivi_layout_getIdOfSurface(ivisurf);
+	uint32_t index = id - BENCH_SURFACE_ID_BASE;
+
+	if (id < BENCH_SURFACE_ID_BASE ||
+	    index >= (uint32_t) bench->surface_count ||
+	    bench->surfaces[index] != NULL)
+		return;
+
+	bench->surfaces[index] = ivisurf;
+	if (++bench->configured == bench->surface_count)
+		wl_event_loop_add_idle(bench->loop, setup_scene, bench);
+}
+
+static void
+client_sigchld(struct weston_process *process, int status)
+{
+	struct bench *bench = container_of(process, struct bench, process);
+
+	bench->client = NULL;
+	if (bench->done)
+		return;
+
+	weston_log("ivi-layout-bench: client exited early, status %d\n",
+		   WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+	bench_finish(bench);
+}
+
+static void
+launch_client(void *data)
+{
+	struct bench *bench = data;
+	const char *path = getenv("IVI_BENCH_CLIENT");
+	char buf[32];
+
+	if (path == NULL) {
+		weston_log("ivi-layout-bench: IVI_BENCH_CLIENT is not set\n");
+		bench_finish(bench);
+		return;
+	}
+
+	/* Inherited by the client. */
+	snprintf(buf, sizeof buf, "%d", bench->surface_count);
+	setenv("IVI_BENCH_SURFACE_COUNT", buf, 1);
+	snprintf(buf, sizeof buf, "%d", BENCH_SURFACE_ID_BASE);
+	setenv("IVI_BENCH_SURFACE_ID_BASE", buf, 1);
+
+	bench->client = weston_client_launch(bench->compositor,
+					     &bench->process, path,
+					     client_sigchld);
+	if (bench->client == NULL)
+		bench_finish(bench);
+}
+
+static int
+bench_init_arrays(struct bench *bench)
+{
+	int32_t i;
+
+	bench->layers = calloc(bench->layer_count, sizeof *bench->layers);
+	bench->surfaces = calloc(bench->surface_count,
+				 sizeof *bench->surfaces);
+	bench->order = calloc(bench->surfaces_per_layer,
+			      sizeof *bench->order);
+	bench->layer_order = calloc(bench->layer_count,
+				    sizeof *bench->layer_order);
+	bench->properties = calloc(bench->surface_count,
+				   sizeof *bench->properties);
+	bench->samples = calloc(bench->frame_count, sizeof *bench->samples);
+	bench->sorted = calloc(bench->frame_count, sizeof *bench->sorted);
+
+	hmi_layout_geometry_init(&bench->geometry);
+
+	if (!bench->layers || !bench->surfaces || !bench->order ||
+	    !bench->layer_order ||
+	    !bench->properties || !bench->samples || !bench->sorted ||
+	    hmi_layout_geometry_reserve(&bench->geometry,
+					bench->surfaces_per_layer) < 0)
+		return -1;
+
+	for (i = 0; i < bench->surface_count; i++)
+		bench->properties[i].opacity = 1.0;
+
+	return 0;
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct bench *bench;
+	const char *path;
+
+	bench = zalloc(sizeof *bench);
+	if (bench == NULL)
+		return -1;
+
+	bench->compositor = compositor;
+	bench->loop = wl_display_get_event_loop(compositor->wl_display);
+	bench->layer_count = getenv_int("IVI_BENCH_LAYERS", 4);
+	bench->surfaces_per_layer = getenv_int("IVI_BENCH_SURFACES", 16);
+	bench->surface_count = bench->layer_count * bench->surfaces_per_layer;
+	bench->frame_count = getenv_int("IVI_BENCH_FRAMES", 120);
+
+	if (bench_init_arrays(bench) < 0)
+		return -1;
+
+	bench->results = stdout;
+	path = getenv("IVI_BENCH_RESULTS");
+	if (path != NULL) {
+		bench->results = fopen(path, "w");
+		if (bench->results == NULL) {
+			weston_log("ivi-layout-bench: cannot open %s: %m\n",
+				   path);
+			return -1;
+		}
+	}
+
+	if (bench_output_hook(&bench->hook, compositor, bench_output_repaint,
+			      NULL, bench) < 0) {
+		weston_log("ivi-layout-bench: no output\n");
+		return -1;
+	}
+	bench->output = bench->hook.output;
+
+	ivi_layout_addNotificationConfigureSurface(surface_configured, bench);
+
+	wl_event_loop_add_idle(bench->loop, launch_client, bench);
+
+	return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * ivi-module run by tests/weston-tests-env under ivi-shell. Two opaque
+ * surfaces of ivi-layout-bench-client are stacked on one layer, so that the
+ * lower one is culled. The client commits each surface again whenever its
+ * frame callback is done, so the lower one must keep committing while it
+ * is covered.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sys/wait.h>
+
+#include "../src/compositor.h"
+#include "../ivi-shell/ivi-layout-export.h"
+#include "../ivi-shell/ivi-layout-private.h"
+
+#define CULLED_SURFACE_ID_BASE 0x10000
+#define CULLED_LAYER_ID 0x20000
+#define CULLED_FRAME_COUNT 5
+#define CULLED_TIMEOUT_MSEC 5000
+
+struct culled_test {
+	struct weston_compositor *compositor;
+	struct wl_event_loop *loop;
+	struct weston_process process;
+	struct wl_event_source *timer;
+
+	struct ivi_layout_surface *surfaces[2];	/* lower, upper */
+	int32_t configured;
+	struct wl_listener commit_listener;	/* of the lower surface */
+	int32_t commit_count;
+	int done;
+};
+
+static struct weston_view *
+test_view(struct culled_test *test, int32_t index)
+{
+	struct weston_surface *surface = test->surfaces[index]->surface;
+
+	assert(surface && !wl_list_empty(&surface->views));
+
+	return container_of(surface->views.next,
+			    struct weston_view, surface_link);
+}
+
+static void
+lower_committed(struct wl_listener *listener, void *data)
+{
+	struct culled_test *test =
+		container_of(listener, struct culled_test, commit_listener);
+
+	/* each commit follows a frame callback sent while culled */
+	assert(wl_list_empty(&test_view(test, 0)->layer_link));
+
+	if (++test->commit_count < CULLED_FRAME_COUNT)
+		return;
+
+	wl_list_remove(&test->commit_listener.link);
+	test->done = 1;
+	wl_display_terminate(test->compositor->wl_display);
+}
+
+static int
+timeout(void *data)
+{
+	struct culled_test *test = data;
+
+	/* the lower surface stalled without frame callbacks */
+	assert(test->done);
+
+	return 0;
+}
+
+static void
+setup_scene(void *data)
+{
+	struct culled_test *test = data;
+	struct ivi_layout_screen **screens = NULL;
+	struct ivi_layout_layer *ivilayer;
+	struct weston_view *lower;
+	int32_t screen_count = 0;
+	int32_t width, height;
+	int32_t culled = 0;
+	int32_t i;
+
+	ivi_layout_getScreens(&screen_count, &screens);
+	assert(screen_count > 0);
+	ivi_layout_getScreenResolution(screens[0], &width, &height);
+
+	ivilayer = ivi_layout_layerCreateWithDimension(CULLED_LAYER_ID,
+						       width, height);
+	assert(ivilayer);
+	ivi_layout_layerSetRenderOrder(ivilayer, test->surfaces, 2);
+	ivi_layout_layerSetVisibility(ivilayer, 1);
+	ivi_layout_screenAddLayer(screens[0], ivilayer);
+	free(screens);
+
+	for (i = 0; i < 2; i++) {
+		struct weston_surface *surface = test_view(test, i)->surface;
+
+		ivi_layout_surfaceSetDestinationRectangle(test->surfaces[i],
+							  0, 0,
+							  surface->width,
+							  surface->height);
+		ivi_layout_surfaceSetVisibility(test->surfaces[i], 1);
+	}
+
+	ivi_layout_commitChanges();
+
+	lower = test_view(test, 0);
+	ivi_layout_getNumberOfCulledViews(&culled);
+	assert(culled == 1);
+	assert(wl_list_empty(&lower->layer_link));
+
+	test->commit_listener.notify = lower_committed;
+	wl_signal_add(&lower->surface->commit_signal, &test->commit_listener);
+
+	test->timer = wl_event_loop_add_timer(test->loop, timeout, test);
+	wl_event_source_timer_update(test->timer, CULLED_TIMEOUT_MSEC);
+}
+
+static void
+surface_configured(struct ivi_layout_surface *ivisurf, void *userdata)
+{
+	struct culled_test *test = userdata;
+	uint32_t index = ivi_layout_getIdOfSurface(ivisurf) -
+			 CULLED_SURFACE_ID_BASE;
+
+	if (index >= 2 || test->surfaces[index] != NULL)
+		return;
+
+	test->surfaces[index] = ivisurf;
+	if (++test->configured == 2)
+		wl_event_loop_add_idle(test->loop, setup_scene, test);
+}
+
+static void
+client_sigchld(struct weston_process *process, int status)
+{
+	struct culled_test *test =
+		container_of(process, struct culled_test, process);
+
+	/* the client only exits on its own when something went wrong */
+	assert(test->done);
+}
+
+static void
+launch_client(void *data)
+{
+	struct culled_test *test = data;
+	const char *path = getenv("WESTON_TEST_CLIENT_PATH");
+	struct wl_client *client;
+	char buf[32];
+
+	assert(path);
+
+	/* Inherited by the client. */
+	setenv("IVI_BENCH_SURFACE_COUNT", "2", 1);
+	snprintf(buf, sizeof buf, "%d", CULLED_SURFACE_ID_BASE);
+	setenv("IVI_BENCH_SURFACE_ID_BASE", buf, 1);
+	setenv("IVI_BENCH_OPAQUE", "1", 1);
+	setenv("IVI_BENCH_FRAME_CALLBACKS", "1", 1);
+
+	client = weston_client_launch(test->compositor, &test->process,
+				      path, client_sigchld);
+	assert(client);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct culled_test *test;
+
+	test = zalloc(sizeof *test);
+	if (test == NULL)
+		return -1;
+
+	test->compositor = compositor;
+	test->loop = wl_display_get_event_loop(compositor->wl_display);
+
+	ivi_layout_addNotificationConfigureSurface(surface_configured, test);
+
+	wl_event_loop_add_idle(test->loop, launch_client, test);
+
+	return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * ivi-module run by tests/weston-tests-env under ivi-shell. Two surfaces of
+ * ivi-layout-bench-client are stacked on one layer, the upper one opaque.
+ * Fading the upper one must put the lower one back into the view list and
+ * let its damage reach the output.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sys/wait.h>
+
+#include "../src/compositor.h"
+#include "../ivi-shell/ivi-layout-export.h"
+#include "../ivi-shell/ivi-layout-private.h"
+
+#define FADE_SURFACE_ID_BASE 0x10000
+#define FADE_LAYER_ID 0x20000
+
+enum fade_state {
+	FADE_CONFIGURING,
+	FADE_FADED,
+	FADE_DAMAGED,
+	FADE_DONE
+};
+
+struct fade_test {
+	struct weston_compositor *compositor;
+	struct wl_event_loop *loop;
+	struct weston_process process;
+
+	struct weston_output *output;
+	int (*output_repaint)(struct weston_output *output,
+			      pixman_region32_t *damage);
+
+	struct ivi_layout_surface *surfaces[2];	/* lower, upper */
+	int32_t configured;
+	enum fade_state state;
+};
+
+/* output->repaint has no user data. */
+static struct fade_test *fade_instance;
+
+static struct weston_view *
+test_view(struct fade_test *test, int32_t index)
+{
+	struct weston_surface *surface = test->surfaces[index]->surface;
+
+	assert(surface && !wl_list_empty(&surface->views));
+
+	return container_of(surface->views.next,
+			    struct weston_view, surface_link);
+}
+
+static void
+damage_lower(void *data)
+{
+	struct fade_test *test = data;
+
+	weston_surface_damage(test_view(test, 0)->surface);
+}
+
+static int
+fade_output_repaint(struct weston_output *output, pixman_region32_t *damage)
+{
+	struct fade_test *test = fade_instance;
+	struct weston_view *lower;
+
+	switch (test->state) {
+	case FADE_FADED:
+		/* the first repaint flushes the damage of the fade itself */
+		test->state = FADE_DAMAGED;
+		wl_event_loop_add_idle(test->loop, damage_lower, test);
+		break;
+	case FADE_DAMAGED:
+		lower = test_view(test, 0);
+		assert(pixman_region32_contains_rectangle(damage,
+			pixman_region32_extents(&lower->transform.boundingbox)) ==
+		       PIXMAN_REGION_IN);
+
+		test->state = FADE_DONE;
+		wl_display_terminate(test->compositor->wl_display);
+		break;
+	default:
+		break;
+	}
+
+	return test->output_repaint(output, damage);
+}
+
+static void
+setup_scene(void *data)
+{
+	struct fade_test *test = data;
+	struct ivi_layout_screen **screens = NULL;
+	struct ivi_layout_layer *ivilayer;
+	struct weston_view *lower, *upper;
+	int32_t screen_count = 0;
+	int32_t width, height;
+	int32_t culled = 0;
+	int32_t i;
+
+	ivi_layout_getScreens(&screen_count, &screens);
+	assert(screen_count > 0);
+	ivi_layout_getScreenResolution(screens[0], &width, &height);
+
+	ivilayer = ivi_layout_layerCreateWithDimension(FADE_LAYER_ID,
+						       width, height);
+	assert(ivilayer);
+	ivi_layout_layerSetRenderOrder(ivilayer, test->surfaces, 2);
+	ivi_layout_layerSetVisibility(ivilayer, 1);
+	ivi_layout_screenAddLayer(screens[0], ivilayer);
+	free(screens);
+
+	for (i = 0; i < 2; i++) {
+		struct weston_surface *surface = test_view(test, i)->surface;
+
+		ivi_layout_surfaceSetSourceRectangle(test->surfaces[i], 0, 0,
+						     surface->width,
+						     surface->height);
+		ivi_layout_surfaceSetDestinationRectangle(test->surfaces[i],
+							  0, 0,
+							  surface->width,
+							  surface->height);
+		ivi_layout_surfaceSetVisibility(test->surfaces[i], 1);
+	}
+
+	/* the client does not set an opaque region */
+	upper = test_view(test, 1);
+	pixman_region32_fini(&upper->surface->opaque);
+	pixman_region32_init_rect(&upper->surface->opaque, 0, 0,
+				  upper->surface->width,
+				  upper->surface->height);
+
+	ivi_layout_commitChanges();
+
+	lower = test_view(test, 0);
+	ivi_layout_getNumberOfCulledViews(&culled);
+	assert(culled == 1);
+	assert(wl_list_empty(&lower->layer_link));
+
+	/* one step of a fade, as ivi-layout-transition does it */
+	ivi_layout_surfaceSetOpacity(test->surfaces[1], 0.5);
+	ivi_layout_commitChanges();
+
+	ivi_layout_getNumberOfCulledViews(&culled);
+	assert(culled == 0);
+	assert(!wl_list_empty(&lower->layer_link));
+	assert(!pixman_region32_not_empty(&upper->transform.opaque));
+
+	test->state = FADE_FADED;
+	weston_output_schedule_repaint(test->output);
+}
+
+static void
+surface_configured(struct ivi_layout_surface *ivisurf, void *userdata)
+{
+	struct fade_test *test = userdata;
+	uint32_t index = ivi_layout_getIdOfSurface(ivisurf) -
+			 FADE_SURFACE_ID_BASE;
+
+	if (index >= 2 || test->surfaces[index] != NULL)
+		return;
+
+	test->surfaces[index] = ivisurf;
+	if (++test->configured == 2)
+		wl_event_loop_add_idle(test->loop, setup_scene, test);
+}
+
+static void
+client_sigchld(struct weston_process *process, int status)
+{
+	struct fade_test *test =
+		container_of(process, struct fade_test, process);
+
+	/* the client only exits on its own when something went wrong */
+	assert(test->state == FADE_DONE);
+}
+
+static void
+launch_client(void *data)
+{
+	struct fade_test *test = data;
+	const char *path = getenv("WESTON_TEST_CLIENT_PATH");
+	struct wl_client *client;
+	char buf[32];
+
+	assert(path);
+
+	/* Inherited by the client. */
+	setenv("IVI_BENCH_SURFACE_COUNT", "2", 1);
+	snprintf(buf, sizeof buf, "%d", FADE_SURFACE_ID_BASE);
+	setenv("IVI_BENCH_SURFACE_ID_BASE", buf, 1);
+
+	client = weston_client_launch(test->compositor, &test->process,
+				      path, client_sigchld);
+	assert(client);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct fade_test *test;
+
+	test = zalloc(sizeof *test);
+	if (test == NULL)
+		return -1;
+
+	test->compositor = compositor;
+	test->loop = wl_display_get_event_loop(compositor->wl_display);
+
+	assert(!wl_list_empty(&compositor->output_list));
+	test->output = container_of(compositor->output_list.next,
+				    struct weston_output, link);
+	test->output_repaint = test->output->repaint;
+	test->output->repaint = fade_output_repaint;
+	fade_instance = test;
+
+	ivi_layout_addNotificationConfigureSurface(surface_configured, test);
+
+	wl_event_loop_add_idle(test->loop, launch_client, test);
+
+	return 0;
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * ivi-module run by tests/weston-tests-env under ivi-shell. A surface of
+ * ivi-layout-bench-client is shown on a layer, then the render order of
+ * the layer and of the screen are cleared. Each clear must be applied by
+ * the next commit.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <sys/wait.h>
+
+#include "../src/compositor.h"
+#include "../ivi-shell/ivi-layout-export.h"
+#include "../ivi-shell/ivi-layout-private.h"
+
+#define ORDER_SURFACE_ID_BASE 0x10000
+#define ORDER_LAYER_ID 0x20000
+
+struct order_test {
+	struct weston_compositor *compositor;
+	struct wl_event_loop *loop;
+	struct weston_process process;
+	struct ivi_layout_surface *surface;
+	int done;
+};
+
+static struct weston_view *
+test_view(struct order_test *test)
+{
+	struct weston_surface *surface = test->surface->surface;
+
+	assert(surface && !wl_list_empty(&surface->views));
+
+	return container_of(surface->views.next,
+			    struct weston_view, surface_link);
+}
+
+static int32_t
+surfaces_on_layer(struct ivi_layout_layer *ivilayer)
+{
+	struct ivi_layout_surface **surfaces = NULL;
+	int32_t length = 0;
+	int32_t ret;
+
+	ret = ivi_layout_getSurfacesOnLayer(ivilayer, &length, &surfaces);
+	assert(ret == 0);
+	free(surfaces);
+
+	return length;
+}
+
+static int32_t
+layers_on_screen(struct ivi_layout_screen *iviscrn)
+{
+	struct ivi_layout_layer **layers = NULL;
+	int32_t length = 0;
+	int32_t ret;
+
+	ret = ivi_layout_getLayersOnScreen(iviscrn, &length, &layers);
+	assert(ret == 0);
+	free(layers);
+
+	return length;
+}
+
+static void
+show_surface(struct order_test *test, struct ivi_layout_screen *iviscrn,
+	     struct ivi_layout_layer *ivilayer)
+{
+	ivi_layout_layerSetRenderOrder(ivilayer, &test->surface, 1);
+	ivi_layout_screenSetRenderOrder(iviscrn, &ivilayer, 1);
+	ivi_layout_commitChanges();
+
+	assert(surfaces_on_layer(ivilayer) == 1);
+	assert(layers_on_screen(iviscrn) == 1);
+	assert(!wl_list_empty(&test_view(test)->layer_link));
+}
+
+static void
+run_test(void *data)
+{
+	struct order_test *test = data;
+	struct ivi_layout_screen **screens = NULL;
+	struct ivi_layout_screen *iviscrn;
+	struct ivi_layout_layer *ivilayer;
+	struct weston_surface *surface = test_view(test)->surface;
+	int32_t screen_count = 0;
+	int32_t width, height;
+
+	ivi_layout_getScreens(&screen_count, &screens);
+	assert(screen_count > 0);
+	iviscrn = screens[0];
+	free(screens);
+	ivi_layout_getScreenResolution(iviscrn, &width, &height);
+
+	ivilayer = ivi_layout_layerCreateWithDimension(ORDER_LAYER_ID,
+						       width, height);
+	assert(ivilayer);
+	ivi_layout_layerSetVisibility(ivilayer, 1);
+	ivi_layout_surfaceSetDestinationRectangle(test->surface, 0, 0,
+						  surface->width,
+						  surface->height);
+	ivi_layout_surfaceSetVisibility(test->surface, 1);
+
+	/* clearing the surfaces of the layer */
+	show_surface(test, iviscrn, ivilayer);
+	ivi_layout_layerSetRenderOrder(ivilayer, NULL, 0);
+	ivi_layout_commitChanges();
+
+	assert(surfaces_on_layer(ivilayer) == 0);
+	assert(wl_list_empty(&test_view(test)->layer_link));
+
+	/* clearing the layers of the screen */
+	show_surface(test, iviscrn, ivilayer);
+	ivi_layout_screenSetRenderOrder(iviscrn, NULL, 0);
+	ivi_layout_commitChanges();
+
+	assert(layers_on_screen(iviscrn) == 0);
+	assert(wl_list_empty(&test_view(test)->layer_link));
+
+	test->done = 1;
+	wl_display_terminate(test->compositor->wl_display);
+}
+
+static void
+surface_configured(struct ivi_layout_surface *ivisurf, void *userdata)
+{
+	struct order_test *test = userdata;
+
+	if (ivi_layout_getIdOfSurface(ivisurf) != ORDER_SURFACE_ID_BASE ||
+	    test->surface != NULL)
+		return;
+
+	test->surface = ivisurf;
+	wl_event_loop_add_idle(test->loop, run_test, test);
+}
+
+static void
+client_sigchld(struct weston_process *process, int status)
+{
+	struct order_test *test =
+		container_of(process, struct order_test, process);
+
+	/* the client only exits on its own when something went wrong */
+	assert(test->done);
+}
+
+static void
+launch_client(void *data)
+{
+	struct order_test *test = data;
+	const char *path = getenv("WESTON_TEST_CLIENT_PATH");
+	struct wl_client *client;
+	char buf[32];
+
+	assert(path);
+
+	/* Inherited by the client. */
+	setenv("IVI_BENCH_SURFACE_COUNT", "1", 1);
+	snprintf(buf, sizeof buf, "%d", ORDER_SURFACE_ID_BASE);
+	setenv("IVI_BENCH_SURFACE_ID_BASE", buf, 1);
+
+	client = weston_client_launch(test->compositor, &test->process,
+				      path, client_sigchld);
+	assert(client);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct order_test *test;
+
+	test = zalloc(sizeof *test);
+	if (test == NULL)
+		return -1;
+
+	test->compositor = compositor;
+	test->loop = wl_display_get_event_loop(compositor->wl_display);
+
+	ivi_layout_addNotificationConfigureSurface(surface_configured, test);
+
+	wl_event_loop_add_idle(test->loop, launch_client, test);
+
+	return 0;
+}
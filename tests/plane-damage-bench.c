@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Benchmark of the repaint path with many views spread over several
+ * planes, run as a module on the headless backend:
+ *
+ *   tests/weston-tests-env plane-damage-bench.la
+ *
+ * BENCH_VIEWS surfaces without buffers are stacked in a layer of their
+ * own, and assign_planes of the output puts them on BENCH_PLANES planes
+ * in turn. Every frame damages all surfaces. For each frame the CPU time
+ * from the end of plane assignment to output->repaint (damage
+ * accumulation) and of the whole repaint are taken, and one line of JSON
+ * is written to stdout.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "../src/compositor.h"
+#include "bench-helper.h"
+
+#define BENCH_VIEWS 500
+#define BENCH_PLANES 6
+#define BENCH_FRAMES 120
+#define BENCH_SIZE 64
+
+struct bench {
+	struct weston_compositor *compositor;
+	struct weston_output *output;
+	struct bench_output hook;
+	struct wl_event_loop *loop;
+	struct weston_layer layer;
+	struct weston_plane planes[BENCH_PLANES - 1];
+	struct weston_plane *plane_order[BENCH_PLANES];
+	struct weston_surface *surfaces[BENCH_VIEWS];
+
+	uint64_t repaint_begin;
+	uint64_t planes_assigned;
+	uint64_t damage_ns[BENCH_FRAMES];
+	uint64_t repaint_ns[BENCH_FRAMES];
+	int frame;
+	int waiting_repaint;
+};
+
+static void
+bench_finish(struct bench *bench)
+{
+	int i;
+
+	printf("{\"benchmark\": \"plane-damage\", \"version\": \"%s\""
+	       ", \"views\": %d, \"planes\": %d, \"frames\": %d",
+	       PACKAGE_VERSION, BENCH_VIEWS, BENCH_PLANES, BENCH_FRAMES);
+	bench_report_field(stdout, "damage_ns", bench->damage_ns,
+			   BENCH_FRAMES);
+	bench_report_field(stdout, "repaint_ns", bench->repaint_ns,
+			   BENCH_FRAMES);
+	printf("}\n");
+	fflush(stdout);
+
+	bench_output_unhook(&bench->hook);
+
+	for (i = 0; i < BENCH_VIEWS; i++) {
+		if (bench->surfaces[i])
+			weston_surface_destroy(bench->surfaces[i]);
+	}
+	for (i = 0; i < BENCH_PLANES - 1; i++)
+		weston_plane_release(&bench->planes[i]);
+	wl_list_remove(&bench->layer.link);
+
+	wl_display_terminate(bench->compositor->wl_display);
+	free(bench);
+}
+
+static void
+run_frame(void *data)
+{
+	struct bench *bench = data;
+	int i;
+
+	if (bench->frame == BENCH_FRAMES) {
+		bench_finish(bench);
+		return;
+	}
+
+	for (i = 0; i < BENCH_VIEWS; i++)
+		weston_surface_damage(bench->surfaces[i]);
+
+	bench->waiting_repaint = 1;
+	weston_output_schedule_repaint(bench->output);
+}
+
+static void
+bench_assign_planes(struct weston_output *output)
+{
+	struct bench *bench = bench_output_data(output);
+	struct weston_view *view;
+	int i = 0;
+
+	bench->repaint_begin = bench_cpu_time_ns();
+
+	wl_list_for_each(view, &output->compositor->view_list, link)
+		weston_view_move_to_plane(view,
+					  bench->plane_order[i++ % BENCH_PLANES]);
+
+	bench->planes_assigned = bench_cpu_time_ns();
+}
+
+static int
+bench_output_repaint(struct weston_output *output,
+		     pixman_region32_t *damage)
+{
+	struct bench *bench = bench_output_data(output);
+	uint64_t begin = bench_cpu_time_ns();
+	int ret;
+
+	ret = bench->hook.repaint(output, damage);
+
+	if (bench->waiting_repaint) {
+		bench->damage_ns[bench->frame] =
+			begin - bench->planes_assigned;
+		bench->repaint_ns[bench->frame] =
+			bench_cpu_time_ns() - bench->repaint_begin;
+
+		bench->waiting_repaint = 0;
+		bench->frame++;
+		wl_event_loop_add_idle(bench->loop, run_frame, bench);
+	}
+
+	return ret;
+}
+
+static int
+setup_scene(struct bench *bench)
+{
+	struct weston_compositor *compositor = bench->compositor;
+	struct weston_surface *surface;
+	struct weston_view *view;
+	int i;
+
+	weston_layer_init(&bench->layer, &compositor->cursor_layer.link);
+
+	bench->plane_order[0] = &compositor->primary_plane;
+	for (i = 0; i < BENCH_PLANES - 1; i++) {
+		weston_plane_init(&bench->planes[i], compositor, 0, 0);
+		weston_compositor_stack_plane(compositor, &bench->planes[i],
+					      &compositor->primary_plane);
+		bench->plane_order[i + 1] = &bench->planes[i];
+	}
+
+	/* Overlapping tiles, every other one opaque. */
+	for (i = 0; i < BENCH_VIEWS; i++) {
+		surface = weston_surface_create(compositor);
+		if (surface == NULL)
+			return -1;
+		view = weston_view_create(surface);
+		if (view == NULL) {
+			weston_surface_destroy(surface);
+			return -1;
+		}
+		bench->surfaces[i] = surface;
+
+		surface->width = BENCH_SIZE;
+		surface->height = BENCH_SIZE;
+		if (i % 2 == 0) {
+			pixman_region32_fini(&surface->opaque);
+			pixman_region32_init_rect(&surface->opaque, 0, 0,
+						  BENCH_SIZE, BENCH_SIZE);
+		}
+
+		weston_view_set_position(view,
+					 (i % 25) * BENCH_SIZE / 2,
+					 (i / 25) * BENCH_SIZE / 2);
+		wl_list_insert(bench->layer.view_list.prev,
+			       &view->layer_link);
+		weston_view_update_transform(view);
+	}
+
+	return 0;
+}
+
+static void
+bench_start(void *data)
+{
+	struct bench *bench = data;
+
+	if (setup_scene(bench) < 0) {
+		weston_log("plane-damage-bench: creating views failed\n");
+		bench->frame = BENCH_FRAMES;
+	}
+
+	run_frame(bench);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct bench *bench;
+
+	bench = calloc(1, sizeof *bench);
+	if (bench == NULL)
+		return -1;
+
+	bench->compositor = compositor;
+	bench->loop = wl_display_get_event_loop(compositor->wl_display);
+
+	if (bench_output_hook(&bench->hook, compositor, bench_output_repaint,
+			      bench_assign_planes, bench) < 0) {
+		weston_log("plane-damage-bench: no output\n");
+		free(bench);
+		return -1;
+	}
+	bench->output = bench->hook.output;
+
+	wl_event_loop_add_idle(bench->loop, bench_start, bench);
+
+	return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "weston-test-client-helper.h"
+#include "presentation_timing-client-protocol.h"
+
+struct presentation_client {
+	struct presentation *presentation;
+	uint32_t clk_id;
+};
+
+enum feedback_result {
+	FB_PENDING = 0,
+	FB_PRESENTED,
+	FB_DISCARDED
+};
+
+struct feedback {
+	struct presentation_feedback *obj;
+	enum feedback_result result;
+	struct wl_output *sync_output;
+	struct timespec time;
+	uint32_t refresh_nsec;
+	uint64_t seq;
+	uint32_t flags;
+};
+
+static void
+presentation_handle_clock_id(void *data, struct presentation *presentation,
+			     uint32_t clk_id)
+{
+	struct presentation_client *pres = data;
+
+	pres->clk_id = clk_id;
+}
+
+static const struct presentation_listener presentation_listener = {
+	presentation_handle_clock_id
+};
+
+static struct presentation_client *
+get_presentation(struct client *client)
+{
+	struct global *g;
+	struct global *global_pres = NULL;
+	struct presentation_client *pres;
+
+	wl_list_for_each(g, &client->global_list, link) {
+		if (strcmp(g->interface, "presentation"))
+			continue;
+
+		if (global_pres)
+			assert(0 && "multiple presentation objects");
+
+		global_pres = g;
+	}
+
+	assert(global_pres && "no presentation found");
+
+	assert(global_pres->version == 1);
+
+	pres = calloc(1, sizeof *pres);
+	assert(pres);
+	pres->presentation = wl_registry_bind(client->wl_registry,
+					      global_pres->name,
+					      &presentation_interface, 1);
+	assert(pres->presentation);
+	presentation_add_listener(pres->presentation,
+				  &presentation_listener, pres);
+
+	client_roundtrip(client);
+
+	return pres;
+}
+
+static void
+feedback_sync_output(void *data,
+		     struct presentation_feedback *presentation_feedback,
+		     struct wl_output *output)
+{
+	struct feedback *fb = data;
+
+	assert(fb->result == FB_PENDING);
+	fb->sync_output = output;
+}
+
+static void
+feedback_presented(void *data,
+		   struct presentation_feedback *presentation_feedback,
+		   uint32_t tv_sec_hi,
+		   uint32_t tv_sec_lo,
+		   uint32_t tv_nsec,
+		   uint32_t refresh_nsec,
+		   uint32_t seq_hi,
+		   uint32_t seq_lo,
+		   uint32_t flags)
+{
+	struct feedback *fb = data;
+
+	assert(fb->result == FB_PENDING);
+	fb->result = FB_PRESENTED;
+	fb->time.tv_sec = ((uint64_t)tv_sec_hi << 32) + tv_sec_lo;
+	fb->time.tv_nsec = tv_nsec;
+	fb->refresh_nsec = refresh_nsec;
+	fb->seq = ((uint64_t)seq_hi << 32) + seq_lo;
+	fb->flags = flags;
+}
+
+static void
+feedback_discarded(void *data,
+		   struct presentation_feedback *presentation_feedback)
+{
+	struct feedback *fb = data;
+
+	assert(fb->result == FB_PENDING);
+	fb->result = FB_DISCARDED;
+}
+
+static const struct presentation_feedback_listener feedback_listener = {
+	feedback_sync_output,
+	feedback_presented,
+	feedback_discarded
+};
+
+static void
+feedback_request(struct feedback *fb, struct presentation_client *pres,
+		 struct surface *surface)
+{
+	memset(fb, 0, sizeof *fb);
+	fb->obj = presentation_feedback(pres->presentation,
+					surface->wl_surface);
+	presentation_feedback_add_listener(fb->obj, &feedback_listener, fb);
+}
+
+static void
+feedback_wait(struct client *client, struct feedback *fb)
+{
+	while (fb->result == FB_PENDING)
+		assert(wl_display_dispatch(client->wl_display) >= 0);
+
+	presentation_feedback_destroy(fb->obj);
+}
+
+static void
+commit_frame(struct surface *surface)
+{
+	wl_surface_attach(surface->wl_surface, surface->wl_buffer, 0, 0);
+	wl_surface_damage(surface->wl_surface, 0, 0,
+			  surface->width, surface->height);
+	wl_surface_commit(surface->wl_surface);
+}
+
+static uint64_t
+timespec_to_nsec(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+TEST(test_presentation_feedback_simple)
+{
+	struct client *client;
+	struct presentation_client *pres;
+	struct feedback fb;
+	struct timespec now;
+
+	client = client_create(100, 50, 123, 77);
+	assert(client);
+	pres = get_presentation(client);
+
+	/* the headless backend stamps frames in software */
+	assert(pres->clk_id == CLOCK_MONOTONIC);
+
+	feedback_request(&fb, pres, client->surface);
+	commit_frame(client->surface);
+	feedback_wait(client, &fb);
+
+	assert(clock_gettime(pres->clk_id, &now) == 0);
+
+	assert(fb.result == FB_PRESENTED);
+	assert(fb.sync_output == client->output->wl_output);
+	assert(timespec_to_nsec(&fb.time) <= timespec_to_nsec(&now));
+	assert(timespec_to_nsec(&now) - timespec_to_nsec(&fb.time) <
+	       1000000000);
+	assert(fb.time.tv_nsec < 1000000000);
+	assert(fb.seq > 0);
+
+	presentation_destroy(pres->presentation);
+	free(pres);
+}
+
+TEST(test_presentation_feedback_replaced)
+{
+	struct client *client;
+	struct presentation_client *pres;
+	struct feedback fb[2];
+
+	client = client_create(100, 50, 123, 77);
+	assert(client);
+	pres = get_presentation(client);
+
+	/* Both commits reach the compositor before it repaints, so the
+	 * first content update is never shown. */
+	feedback_request(&fb[0], pres, client->surface);
+	commit_frame(client->surface);
+	feedback_request(&fb[1], pres, client->surface);
+	commit_frame(client->surface);
+
+	feedback_wait(client, &fb[0]);
+	feedback_wait(client, &fb[1]);
+
+	assert(fb[0].result == FB_DISCARDED);
+	assert(fb[1].result == FB_PRESENTED);
+
+	presentation_destroy(pres->presentation);
+	free(pres);
+}
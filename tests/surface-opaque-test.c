@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/compositor.h"
+
+static void
+check_region(struct weston_view *view, int x1, int y1, int x2, int y2)
+{
+	pixman_box32_t *box;
+	int n;
+
+	weston_view_update_transform(view);
+
+	box = pixman_region32_rectangles(&view->transform.opaque, &n);
+	if (x1 == x2) {
+		assert(n == 0);
+		return;
+	}
+
+	assert(n == 1);
+	assert(box[0].x1 == x1 && box[0].y1 == y1);
+	assert(box[0].x2 == x2 && box[0].y2 == y2);
+}
+
+static void
+check_opaque(struct weston_view *view, int x1, int y1, int x2, int y2)
+{
+	weston_view_geometry_dirty(view);
+	check_region(view, x1, y1, x2, y2);
+}
+
+static void
+surface_opaque_transform(void *data)
+{
+	struct weston_compositor *compositor = data;
+	struct weston_surface *surface;
+	struct weston_view *view;
+	struct weston_transform transform;
+
+	surface = weston_surface_create(compositor);
+	assert(surface);
+	view = weston_view_create(surface);
+	assert(view);
+	surface->width = 200;
+	surface->height = 100;
+	pixman_region32_fini(&surface->opaque);
+	pixman_region32_init_rect(&surface->opaque, 0, 0, 200, 100);
+	weston_view_set_position(view, 100, 100);
+
+	/* translation only */
+	check_opaque(view, 100, 100, 300, 200);
+
+	/* scaling, applied before the position */
+	weston_matrix_init(&transform.matrix);
+	weston_matrix_scale(&transform.matrix, 0.5, 0.5, 1);
+	wl_list_insert(&view->geometry.transformation_list, &transform.link);
+	check_opaque(view, 100, 100, 200, 150);
+
+	/* fractional edges are rounded inwards */
+	weston_matrix_init(&transform.matrix);
+	weston_matrix_scale(&transform.matrix, 1.0 / 3.0, 1.0 / 3.0, 1);
+	check_opaque(view, 100, 100, 166, 133);
+
+	/* 90 degrees rotation maps (x, y) to (-y, x) */
+	weston_matrix_init(&transform.matrix);
+	weston_matrix_rotate_xy(&transform.matrix, 0, 1);
+	check_opaque(view, 0, 100, 100, 300);
+
+	/* no occlusion through translucent views, and a change of alpha
+	 * alone recomputes the opaque region */
+	weston_view_set_alpha(view, 0.5);
+	check_region(view, 0, 0, 0, 0);
+	weston_view_set_alpha(view, 0.75);
+	check_region(view, 0, 0, 0, 0);
+	weston_view_set_alpha(view, 1.0);
+	check_region(view, 0, 100, 100, 300);
+
+	/* nor through arbitrary rotation */
+	weston_matrix_init(&transform.matrix);
+	weston_matrix_rotate_xy(&transform.matrix, 0.6, 0.8);
+	check_opaque(view, 0, 0, 0, 0);
+
+	wl_list_remove(&transform.link);
+	weston_view_destroy(view);
+	weston_surface_destroy(surface);
+
+	wl_display_terminate(compositor->wl_display);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct wl_event_loop *loop;
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+
+	wl_event_loop_add_idle(loop, surface_opaque_transform, compositor);
+
+	return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2014 DENSO CORPORATION
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "../src/compositor.h"
+
+#define VIEW_COUNT 40
+
+struct pick_test {
+	struct weston_compositor *compositor;
+	struct weston_output *output;
+	struct weston_layer layer;
+	struct weston_transform transform;
+	struct wl_listener frame_listener;
+};
+
+/* What weston_compositor_pick_view() returns without the grid. */
+static struct weston_view *
+scan_view_list(struct weston_compositor *compositor,
+	       wl_fixed_t x, wl_fixed_t y, wl_fixed_t *vx, wl_fixed_t *vy)
+{
+	struct weston_view *view;
+
+	wl_list_for_each(view, &compositor->view_list, link) {
+		weston_view_from_global_fixed(view, x, y, vx, vy);
+		if (pixman_region32_contains_point(&view->surface->input,
+						   wl_fixed_to_int(*vx),
+						   wl_fixed_to_int(*vy),
+						   NULL))
+			return view;
+	}
+
+	return NULL;
+}
+
+static void
+check_picks(struct weston_compositor *compositor)
+{
+	struct weston_view *view, *expected;
+	wl_fixed_t x, y, vx, vy, ex, ey;
+	int hits = 0;
+
+	for (y = wl_fixed_from_int(-20); y < wl_fixed_from_int(700);
+	     y += wl_fixed_from_double(6.75)) {
+		for (x = wl_fixed_from_int(-20); x < wl_fixed_from_int(1100);
+		     x += wl_fixed_from_double(6.75)) {
+			view = weston_compositor_pick_view(compositor, x, y,
+							   &vx, &vy);
+			expected = scan_view_list(compositor, x, y, &ex, &ey);
+
+			assert(view == expected);
+			if (view) {
+				assert(vx == ex && vy == ey);
+				hits++;
+			}
+		}
+	}
+
+	fprintf(stderr, "%d hits\n", hits);
+	assert(hits > 0);
+}
+
+static void
+frame_handler(struct wl_listener *listener, void *data)
+{
+	struct pick_test *test =
+		container_of(listener, struct pick_test, frame_listener);
+	struct weston_view *view;
+
+	wl_list_remove(&test->frame_listener.link);
+
+	check_picks(test->compositor);
+
+	/* moving a view without a repaint must move its picks as well */
+	view = container_of(test->layer.view_list.next,
+			    struct weston_view, layer_link);
+	weston_view_set_position(view, view->geometry.x + 33,
+				 view->geometry.y + 17);
+	check_picks(test->compositor);
+
+	/* input far from the origin is picked without the grid */
+	view = container_of(test->layer.view_list.prev,
+			    struct weston_view, layer_link);
+	pixman_region32_fini(&view->surface->input);
+	pixman_region32_init_rect(&view->surface->input,
+				  INT32_MIN, INT32_MIN, 100, 100);
+	test->compositor->pick_index.generation++;
+	check_picks(test->compositor);
+
+	/* the default input region of a surface is infinite, which must not
+	 * overflow into a small pick box */
+	pixman_region32_fini(&view->surface->input);
+	pixman_region32_init_rect(&view->surface->input,
+				  INT32_MIN, INT32_MIN, UINT32_MAX, UINT32_MAX);
+	test->compositor->pick_index.generation++;
+	check_picks(test->compositor);
+
+	wl_display_terminate(test->compositor->wl_display);
+}
+
+static void
+setup_views(void *data)
+{
+	struct pick_test *test = data;
+	struct weston_surface *surface;
+	struct weston_view *view;
+	int i;
+
+	weston_layer_init(&test->layer, &test->compositor->cursor_layer.link);
+
+	for (i = 0; i < VIEW_COUNT; i++) {
+		surface = weston_surface_create(test->compositor);
+		assert(surface);
+		view = weston_view_create(surface);
+		assert(view);
+
+		surface->width = 60 + (i * 37) % 200;
+		surface->height = 40 + (i * 53) % 150;
+
+		pixman_region32_fini(&surface->input);
+		switch (i % 4) {
+		case 0:
+			/* input on part of the surface */
+			pixman_region32_init_rect(&surface->input, 10, 10,
+						  surface->width / 2,
+						  surface->height / 2);
+			break;
+		case 1:
+			/* no input, never picked */
+			pixman_region32_init(&surface->input);
+			break;
+		default:
+			pixman_region32_init_rect(&surface->input, 0, 0,
+						  surface->width,
+						  surface->height);
+			break;
+		}
+
+		weston_view_set_position(view, (i * 97) % 900 + 0.5,
+					 (i * 61) % 550);
+		wl_list_insert(test->layer.view_list.prev, &view->layer_link);
+	}
+
+	/* and one scaled view */
+	weston_matrix_init(&test->transform.matrix);
+	weston_matrix_scale(&test->transform.matrix, 1.5, 0.75, 1);
+	wl_list_insert(&view->geometry.transformation_list,
+		       &test->transform.link);
+	weston_view_geometry_dirty(view);
+
+	test->frame_listener.notify = frame_handler;
+	wl_signal_add(&test->output->frame_signal, &test->frame_listener);
+	weston_output_schedule_repaint(test->output);
+}
+
+WL_EXPORT int
+module_init(struct weston_compositor *compositor, int *argc, char *argv[])
+{
+	struct wl_event_loop *loop;
+	struct pick_test *test;
+
+	test = calloc(1, sizeof *test);
+	assert(test);
+	assert(!wl_list_empty(&compositor->output_list));
+
+	test->compositor = compositor;
+	test->output = container_of(compositor->output_list.next,
+				    struct weston_output, link);
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+	wl_event_loop_add_idle(loop, setup_views, test);
+
+	return 0;
+}